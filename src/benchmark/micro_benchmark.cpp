@@ -0,0 +1,217 @@
+// SYSCORE
+#define SYSCORE_LOG_IMPLEMENTATION 1
+#include "../syscore/sc_log.h"
+#include "../syscore/sc_seqlock.h"
+
+#define SYSCORE_BENCHMARK_IMPLEMENTATION 1
+#include "../syscore/sc_benchmark.h"
+
+#define SYSCORE_TRACE_IMPLEMENTATION 1
+#include "../syscore/sc_trace.h"
+
+// COMPONENTS
+#define KC_PROCESS_BACKEND_IMPLEMENTATION 1
+#include "../ko_client/kc_process_backend.h"
+
+#define KC_MEMUTILS_IMPLEMENTATION 1
+#include "../ko_client/kc_memutils.h"
+#include "../ko_client/config/ardream_world_memory_config.h"
+
+#define KC_SKILL_TABLE_IMPLEMENTATION 1
+#include "../ko_client/kc_skill_table.h"
+
+#define KC_VALUE_SCANNER_IMPLEMENTATION 1
+#include "../ko_client/kc_value_scanner.h"
+
+#include "synthetic_heap.h"
+
+#include <fstream>
+#include <iostream>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Micro benchmarks of the scanner and of the getter read path, with BENCHMARK_SUITE.
+ *
+ * Times memmem on every engine, find_pattern_in_memory and find_patterns_in_memory over a synthetic 1 GB heap (and the
+ * single pass of find_patterns_in_memory against one find_pattern_in_memory pass per pattern), the
+ * value scanner on every engine over the same heap, and the three ways a getter reads the player state: one read per value, one REMOTE_GATHER read, and the snapshot of the
+ * state poller. The results are printed as a table, and saved as JSON or CSV to compare them from one change to the next:
+ *   micro_benchmark [--json <path>] [--csv <path>] [--heap-mb <size>]
+ */
+
+namespace bench
+{
+     const uint64_t memmem_haystack_size = MB_TO_BYTES(64);
+     const size_t   shard_size           = MB_TO_BYTES(16);
+
+     // The values a getter reads, laid out in the fixture like the cooldowns and the health and mana of the KO heap.
+     struct GETTER_STATE
+     {
+          float    cooldowns[9];
+          uint32_t max_hp, cur_hp, max_mp, cur_mp;
+     };
+
+     void memmem_benchmarks(BENCHMARK_SUITE& suite, const uint8_t* haystack)
+     {
+          // Never found, so that the whole haystack is searched.
+          const uint8_t needle[] = {0xFE, 0x7F, 0x01, 0xC3, 0x55, 0x9A, 0x3E, 0xB1, 0x42, 0xE7, 0x0D, 0x68, 0xAF, 0x21, 0xD4, 0x8C};
+
+          const struct
+          {
+               const char*   name;
+               MEMMEM_ENGINE engine;
+          } engines[] = {{"scalar", MEMMEM_ENGINE::SCALAR}, {"sse2", MEMMEM_ENGINE::SSE2}, {"avx2", MEMMEM_ENGINE::AVX2}};
+
+          for(const auto& engine : engines)
+          {
+               suite.run(std::string("memmem/") + engine.name, [&]( ) { benchmark_do_not_optimize(memmem_with_engine(engine.engine, haystack, memmem_haystack_size, needle, sizeof(needle))); },
+                         memmem_haystack_size);
+          }
+
+          const MASKED_PATTERN& pattern = spike_pattern( );
+          suite.run("memmem_masked/spike", [&]( ) { benchmark_do_not_optimize(memmem_masked(haystack, memmem_haystack_size, pattern.value.data( ), pattern.mask.data( ), pattern.size( ))); },
+                    memmem_haystack_size);
+
+          // Same search with the anchors and the shift table of the parsed pattern.
+          suite.run("memmem_compiled/spike", [&]( ) { benchmark_do_not_optimize(memmem_compiled(haystack, memmem_haystack_size, pattern)); }, memmem_haystack_size);
+     }
+
+     void scan_benchmarks(BENCHMARK_SUITE& suite, HANDLE own_process, uint8_t* heap, uint64_t heap_size, const KO_MEMORY_CONFIG& conf)
+     {
+          PROCESS_MEMORY memory {own_process, heap, heap_size};
+
+          const std::vector<COMPILED_PATTERN> patterns = heap_patterns(conf);
+          std::vector<PATTERN_SCAN_TARGET> targets;
+          for(const COMPILED_PATTERN& pattern : patterns) targets.emplace_back(pattern, 2);
+
+          const uint32_t max_workers = std::max(1u, std::thread::hardware_concurrency( ));
+          for(uint32_t workers : {1u, max_workers})
+          {
+               memory.set_parallel_scan({workers, shard_size});
+               const std::string suffix = "/" + std::to_string(workers) + "_workers";
+
+               suite.run("find_pattern_in_memory" + suffix, [&]( ) { benchmark_do_not_optimize(memory.find_pattern_in_memory(spike_pattern( ))); }, heap_size);
+               suite.run("find_patterns_in_memory" + suffix, [&]( ) { memory.find_patterns_in_memory(targets); }, heap_size);
+
+               // What the single pass replaces: one memmem pass per pattern and per match, for the same two matches per pattern.
+               suite.run("find_pattern_in_memory_per_pattern" + suffix, [&]( ) {
+                    for(const COMPILED_PATTERN& pattern : patterns)
+                    {
+                         const OTHER_PROCESS_PTR first_match = memory.find_pattern_in_memory(pattern);
+                         if(first_match) benchmark_do_not_optimize(memory.find_pattern_in_memory(pattern, first_match + 1));
+                    }
+               }, heap_size);
+               if(max_workers == 1) break;
+          }
+     }
+
+     void value_scan_benchmarks(BENCHMARK_SUITE& suite, HANDLE own_process, uint8_t* heap, uint64_t heap_size)
+     {
+          PROCESS_MEMORY memory {own_process, heap, heap_size};
+
+          const struct
+          {
+               const char*   name;
+               MEMMEM_ENGINE engine;
+          } engines[] = {{"scalar", MEMMEM_ENGINE::SCALAR}, {"sse2", MEMMEM_ENGINE::SSE2}, {"avx2", MEMMEM_ENGINE::AVX2}};
+
+          // The small integers of the synthetic heap leave millions of candidates, like a first scan for an HP value would.
+          for(const auto& engine : engines)
+          {
+               VALUE_SCANNER scanner {SCAN_VALUE_TYPE::UINT32, engine.engine};
+               suite.run(std::string("value_scan/first/") + engine.name, [&]( ) { benchmark_do_not_optimize(scanner.first_scan(memory, VALUE_PREDICATE::between(1, 1000))); }, heap_size);
+               suite.run(std::string("value_scan/next_unchanged/") + engine.name, [&]( ) { benchmark_do_not_optimize(scanner.next_scan(own_process, VALUE_PREDICATE::unchanged( ))); });
+               SYSLOG_INFO("value_scan/" << engine.name << ": " << scanner.size( ) << " candidates" << std::endl);
+          }
+     }
+
+     void getter_benchmarks(BENCHMARK_SUITE& suite, HANDLE own_process)
+     {
+          // The cooldowns are close to each other, the health and mana are in another block, as in the KO heap.
+          std::vector<uint8_t> fixture(KB_TO_BYTES(64), 0);
+          std::vector<OTHER_PROCESS_PTR> addresses;
+          for(size_t i = 0; i < 9; i++) addresses.push_back(fixture.data( ) + 0x400 + i * 0x40);
+          for(size_t i = 0; i < 4; i++) addresses.push_back(fixture.data( ) + 0x8000 + i * 4);
+
+          const size_t field_offsets[] = {offsetof(GETTER_STATE, cooldowns[0]), offsetof(GETTER_STATE, cooldowns[1]), offsetof(GETTER_STATE, cooldowns[2]),
+                                          offsetof(GETTER_STATE, cooldowns[3]), offsetof(GETTER_STATE, cooldowns[4]), offsetof(GETTER_STATE, cooldowns[5]),
+                                          offsetof(GETTER_STATE, cooldowns[6]), offsetof(GETTER_STATE, cooldowns[7]), offsetof(GETTER_STATE, cooldowns[8]),
+                                          offsetof(GETTER_STATE, max_hp),       offsetof(GETTER_STATE, cur_hp),       offsetof(GETTER_STATE, max_mp),
+                                          offsetof(GETTER_STATE, cur_mp)};
+
+          GETTER_STATE state;
+          suite.run("getter/process_read_per_value", [&]( ) {
+               for(size_t i = 0; i < addresses.size( ); i++) process_read(own_process, addresses[i], (uint8_t*) &state + field_offsets[i], 4);
+               benchmark_do_not_optimize(state);
+          }, 0, 16);
+
+          REMOTE_GATHER gather {own_process};
+          for(size_t i = 0; i < addresses.size( ); i++) gather.add(addresses[i], field_offsets[i], 4);
+          suite.run("getter/remote_gather", [&]( ) {
+               gather.read(&state);
+               benchmark_do_not_optimize(state);
+          }, 0, 16);
+
+          // What the getters read while the state poller runs: a copy out of the seqlock, no system call.
+          SEQLOCK<GETTER_STATE> snapshot;
+          snapshot.store(state);
+          suite.run("getter/seqlock_snapshot", [&]( ) { benchmark_do_not_optimize(snapshot.load( )); }, 0, 1024);
+     }
+}
+
+int main(int argc, char** argv)
+{
+     const char* json_path = nullptr;
+     const char* csv_path  = nullptr;
+     uint64_t    heap_size = GB_TO_BYTES(1);
+     for(int i = 1; i + 1 < argc; i += 2)
+     {
+          if(strcmp(argv[i], "--json") == 0) json_path = argv[i + 1];
+          else if(strcmp(argv[i], "--csv") == 0) csv_path = argv[i + 1];
+          else if(strcmp(argv[i], "--heap-mb") == 0) heap_size = MB_TO_BYTES(std::max(128ull, strtoull(argv[i + 1], nullptr, 10)));
+     }
+
+     // Timing an engine that disagrees with the reference would be meaningless.
+     if(!memmem_self_test( ) || !value_scan_self_test( ))
+     {
+          SYSLOG_ERRORF("An engine disagrees with the reference, see the self tests\n");
+          return 1;
+     }
+
+     KO_MEMORY_CONFIG conf;
+     BENCHMARK_SUITE  suite;
+     HANDLE           own_process = process_open(process_current_id( ));
+
+     uint8_t* heap = host_allocate_zeroed(heap_size);
+     bench::fill_synthetic_heap(heap, heap_size);
+     bench::plant_heap_patterns(heap, heap_size, bench::heap_patterns(conf));
+
+     SYSLOG_INFO("memmem: " << BYTES_TO_MB(bench::memmem_haystack_size) << " MB, scan: " << BYTES_TO_MB(heap_size) << " MB" << std::endl);
+     const char* engine_names[] = {"scalar", "sse2", "avx2"};
+     SYSLOG_INFO("memmem engine measured as the fastest: " << engine_names[(int) memmem_active_engine( )] << std::endl);
+     bench::memmem_benchmarks(suite, heap);
+     bench::scan_benchmarks(suite, own_process, heap, heap_size, conf);
+     bench::value_scan_benchmarks(suite, own_process, heap, heap_size);
+     bench::getter_benchmarks(suite, own_process);
+
+     log_flush( );
+     suite.write_table(std::cout);
+     if(json_path)
+     {
+          std::ofstream json_file(json_path);
+          suite.write_json(json_file);
+     }
+     if(csv_path)
+     {
+          std::ofstream csv_file(csv_path);
+          suite.write_csv(csv_file);
+     }
+
+     process_close(own_process);
+     host_free(heap, heap_size);
+     return 0;
+}
@@ -0,0 +1,254 @@
+// SYSCORE
+#define SYSCORE_LOG_IMPLEMENTATION 1
+#include "../syscore/sc_log.h"
+
+#define SYSCORE_BENCHMARK_IMPLEMENTATION 1
+#include "../syscore/sc_benchmark.h"
+
+#define SYSCORE_TRACE_IMPLEMENTATION 1
+#include "../syscore/sc_trace.h"
+
+// COMPONENTS
+#define KC_PROCESS_BACKEND_IMPLEMENTATION 1
+#include "../ko_client/kc_process_backend.h"
+
+#define KC_MEMUTILS_IMPLEMENTATION 1
+#include "../ko_client/kc_memutils.h"
+#include "../ko_client/config/ardream_world_memory_config.h"
+
+#define KC_SKILL_TABLE_IMPLEMENTATION 1
+#include "../ko_client/kc_skill_table.h"
+
+#include "synthetic_heap.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Scan benchmark.
+ *
+ * Maps a synthetic 1 GB heap of our own process with PROCESS_MEMORY, then times find_pattern_in_memory
+ * and find_patterns_in_memory with 1 to N worker threads, then the same searches with PROCESS_MEMORY_STREAM.
+ * Every result is checked against the serial one.
+ *
+ * With arguments, times the same searches in the heap of another running process instead, through the system calls
+ * of kc_process_backend.h, e.g. under perf on Linux:
+ *   scan_benchmark <pid> <heap base address in hex> <heap size in MB> [dump path]
+ * The heap is also captured to the dump file if one is given, and a dump is scanned, without the process, with:
+ *   scan_benchmark <dump path>
+ */
+
+namespace bench
+{
+     const uint64_t heap_size         = GB_TO_BYTES(1);
+     const size_t   shard_size        = MB_TO_BYTES(16);
+     const size_t   stream_budget     = MB_TO_BYTES(4);
+     const int      repetitions       = 3;
+
+     double best_of(TICTOC& timer, const std::function<void( )>& run)
+     {
+          double best_ms = 1e300;
+          for(int i = 0; i < repetitions; i++)
+          {
+               timer.tic( );
+               run( );
+               timer.toc( );
+               best_ms = std::min(best_ms, timer.elapsed_time_in_ms( ));
+          }
+          return best_ms;
+     }
+
+     // Finds the heap patterns with 1 to N worker threads, each result is checked against the serial one.
+     void time_parallel_scan(TICTOC& timer, PROCESS_MEMORY& memory, std::vector<PATTERN_SCAN_TARGET>& targets)
+     {
+          memory.set_parallel_scan({1, shard_size});
+          std::vector<PATTERN_SCAN_TARGET> serial_targets = targets;
+          memory.find_patterns_in_memory(serial_targets);
+
+          double         serial_ms   = 0;
+          const uint32_t max_workers = std::max(1u, std::thread::hardware_concurrency( ));
+          for(uint32_t workers = 1; workers <= max_workers; workers = workers < max_workers && workers * 2 > max_workers ? max_workers : workers * 2)
+          {
+               memory.set_parallel_scan({workers, shard_size});
+               const double multi_pattern_ms = best_of(timer, [&]( ) { memory.find_patterns_in_memory(targets); });
+               if(workers == 1) serial_ms = multi_pattern_ms;
+
+               bool is_identical = true;
+               for(size_t i = 0; i < targets.size( ); i++) is_identical = is_identical && targets[i].matches == serial_targets[i].matches;
+
+               SYSLOG_INFO(workers << "       | " << multi_pattern_ms << " ms (x" << serial_ms / multi_pattern_ms << ")" << (is_identical ? "" : " MISMATCH") << std::endl);
+               if(workers == max_workers) break;
+          }
+     }
+
+     // Times the searches in a dump of a heap, mapped from the file. Runs the same wherever the game is.
+     int scan_dump(const char* dump_path)
+     {
+          TICTOC                 timer;
+          const KO_MEMORY_CONFIG conf;
+
+          PROCESS_MEMORY memory {dump_path};
+          if(memory.mapped_regions( ).empty( ))
+          {
+               SYSLOG_ERROR("Can't load the dump " << dump_path << std::endl);
+               return 1;
+          }
+
+          SIZE_T dump_num_bytes = 0;
+          for(const MAPPED_REGION& region : memory.mapped_regions( )) dump_num_bytes += region.size;
+
+          std::vector<PATTERN_SCAN_TARGET> targets;
+          for(const COMPILED_PATTERN& pattern : {COMPILED_PATTERN(conf.player_nation_identification_byte_pattern), COMPILED_PATTERN(conf.mana_hp_anchor_byte_pattern), COMPILED_PATTERN(spike_pattern( ))}) targets.emplace_back(pattern, 2);
+
+          SYSLOG_INFO("Dump " << dump_path << ": " << BYTES_TO_MB(dump_num_bytes) << " MB in " << memory.mapped_regions( ).size( ) << " runs, best of " << repetitions << std::endl);
+          SYSLOG_INFO("workers | find_patterns_in_memory (" << targets.size( ) << " patterns)" << std::endl);
+          time_parallel_scan(timer, memory, targets);
+
+          for(const PATTERN_SCAN_TARGET& target : targets)
+          {
+               for(OTHER_PROCESS_PTR match : target.matches) SYSLOG_INFOF("match   | {}\n", (void*) match);
+          }
+          return 0;
+     }
+
+     // Times the searches in the heap of another process, where the reads are system calls.
+     int scan_other_process(DWORD process_id, OTHER_PROCESS_PTR base_address, uint64_t size, const char* dump_path)
+     {
+          TICTOC                 timer;
+          const KO_MEMORY_CONFIG conf;
+
+          HANDLE process_handle = process_open(process_id);
+          if(!process_handle)
+          {
+               SYSLOG_ERROR("Can't open process " << process_id << std::endl);
+               return 1;
+          }
+
+          std::vector<PATTERN_SCAN_TARGET> targets;
+          for(const COMPILED_PATTERN& pattern : {COMPILED_PATTERN(conf.player_nation_identification_byte_pattern), COMPILED_PATTERN(conf.mana_hp_anchor_byte_pattern), COMPILED_PATTERN(spike_pattern( ))}) targets.emplace_back(pattern, 2);
+
+          SYSLOG_INFO("Process " << process_id << ": " << BYTES_TO_MB(size) << " MB from " << (void*) base_address << ", best of " << repetitions << std::endl);
+
+          const double map_ms = best_of(timer, [&]( ) { PROCESS_MEMORY memory {process_handle, base_address, size}; });
+          SYSLOG_INFO("map     | " << map_ms << " ms (copy of the readable regions)" << std::endl);
+
+          PROCESS_MEMORY_STREAM stream {process_handle, base_address, size, {stream_budget, 4}};
+          const double          multi_pattern_ms = best_of(timer, [&]( ) { stream.find_patterns_in_memory(targets); });
+
+          size_t match_count = 0;
+          for(const PATTERN_SCAN_TARGET& target : targets) match_count += target.matches.size( );
+          SYSLOG_INFO("stream  | " << multi_pattern_ms << " ms (" << targets.size( ) << " patterns, " << match_count << " matches)" << std::endl);
+
+          bool is_captured = true;
+          if(dump_path)
+          {
+               timer.tic( );
+               is_captured = PROCESS_MEMORY::capture_dump(process_handle, base_address, size, dump_path);
+               timer.toc( );
+               if(is_captured) SYSLOG_INFO("capture | " << timer.elapsed_time_in_ms( ) << " ms to " << dump_path << std::endl);
+               else SYSLOG_ERROR("Can't write the dump " << dump_path << std::endl);
+          }
+
+          process_close(process_handle);
+          return is_captured ? 0 : 1;
+     }
+}
+
+int main(int argc, char** argv)
+{
+     if(argc == 2) return bench::scan_dump(argv[1]);
+     if(argc == 4 || argc == 5)
+     {
+          return bench::scan_other_process((DWORD) strtoul(argv[1], nullptr, 10), (OTHER_PROCESS_PTR) strtoull(argv[2], nullptr, 16), MB_TO_BYTES(strtoull(argv[3], nullptr, 10)),
+                                           argc == 5 ? argv[4] : nullptr);
+     }
+
+     TICTOC           timer;
+     KO_MEMORY_CONFIG conf;
+
+     HANDLE own_process = process_open(process_current_id( ));
+
+     uint8_t* heap = host_allocate_zeroed(bench::heap_size);
+     bench::fill_synthetic_heap(heap, bench::heap_size);
+
+     const std::vector<COMPILED_PATTERN> patterns = bench::heap_patterns(conf);
+     bench::plant_heap_patterns(heap, bench::heap_size, patterns);
+
+     PROCESS_MEMORY memory {own_process, heap, bench::heap_size};
+
+     std::vector<PATTERN_SCAN_TARGET> targets;
+     for(const COMPILED_PATTERN& pattern : patterns) targets.emplace_back(pattern, 2);
+
+     const OTHER_PROCESS_PTR          serial_match   = memory.find_pattern_in_memory(bench::spike_pattern( ));
+     std::vector<PATTERN_SCAN_TARGET> serial_targets = targets;
+     memory.find_patterns_in_memory(serial_targets);
+
+     SYSLOG_INFO("Heap: " << BYTES_TO_MB(bench::heap_size) << " MB, shard size: " << BYTES_TO_MB(bench::shard_size) << " MB, best of " << bench::repetitions << std::endl);
+     SYSLOG_INFO("workers | find_pattern_in_memory      | find_patterns_in_memory (" << targets.size( ) << " patterns)" << std::endl);
+
+     double single_pattern_serial_ms = 0, multi_pattern_serial_ms = 0;
+     const uint32_t max_workers = std::max(1u, std::thread::hardware_concurrency( ));
+     for(uint32_t workers = 1; workers <= max_workers; workers = workers < max_workers && workers * 2 > max_workers ? max_workers : workers * 2)
+     {
+          memory.set_parallel_scan({workers, bench::shard_size});
+
+          OTHER_PROCESS_PTR single_match;
+          const double      single_pattern_ms = bench::best_of(timer, [&]( ) { single_match = memory.find_pattern_in_memory(bench::spike_pattern( )); });
+          const double      multi_pattern_ms  = bench::best_of(timer, [&]( ) { memory.find_patterns_in_memory(targets); });
+
+          bool is_identical = single_match == serial_match;
+          for(size_t i = 0; i < targets.size( ); i++) is_identical = is_identical && targets[i].matches == serial_targets[i].matches;
+
+          if(workers == 1)
+          {
+               single_pattern_serial_ms = single_pattern_ms;
+               multi_pattern_serial_ms  = multi_pattern_ms;
+          }
+
+          SYSLOG_INFO(workers << "       | " << single_pattern_ms << " ms (x" << single_pattern_serial_ms / single_pattern_ms << ")"
+                              << " | " << multi_pattern_ms << " ms (x" << multi_pattern_serial_ms / multi_pattern_ms << ")"
+                              << (is_identical ? "" : " MISMATCH") << std::endl);
+          if(workers == max_workers) break;
+     }
+
+     // Same searches, reading the heap through a small buffer instead of scanning a full copy of it.
+     // With a single buffer the reads and the searches alternate, with more a reader thread runs ahead of the search.
+     for(uint32_t buffer_count : {1u, 4u})
+     {
+          PROCESS_MEMORY_STREAM stream {own_process, heap, bench::heap_size, {bench::stream_budget, buffer_count}};
+
+          OTHER_PROCESS_PTR single_match;
+          const double      single_pattern_ms = bench::best_of(timer, [&]( ) { single_match = stream.find_pattern_in_memory(bench::spike_pattern( )); });
+          const double      multi_pattern_ms  = bench::best_of(timer, [&]( ) { stream.find_patterns_in_memory(targets); });
+
+          bool is_identical = single_match == serial_match;
+          for(size_t i = 0; i < targets.size( ); i++) is_identical = is_identical && targets[i].matches == serial_targets[i].matches;
+
+          SYSLOG_INFO("stream  | " << single_pattern_ms << " ms | " << multi_pattern_ms << " ms (" << BYTES_TO_MB(bench::stream_budget) << " MB in "
+                                   << buffer_count << " buffers)" << (is_identical ? "" : " MISMATCH") << std::endl);
+     }
+
+     // Rescan starting from the previous matches, as done when the address cache belongs to a previous client session.
+     {
+          PROCESS_MEMORY_STREAM stream {own_process, heap, bench::heap_size, {bench::stream_budget}};
+
+          std::vector<OTHER_PROCESS_PTR> hints;
+          for(const PATTERN_SCAN_TARGET& target : serial_targets) hints.insert(hints.end( ), target.matches.begin( ), target.matches.end( ));
+
+          const double multi_pattern_ms = bench::best_of(timer, [&]( ) { stream.find_patterns_near(targets, hints); });
+
+          bool is_identical = true;
+          for(size_t i = 0; i < targets.size( ); i++) is_identical = is_identical && targets[i].matches == serial_targets[i].matches;
+
+          SYSLOG_INFO("near    | -             | " << multi_pattern_ms << " ms (previous matches as hints)" << (is_identical ? "" : " MISMATCH") << std::endl);
+     }
+
+     // With SYSCORE_TRACING, where the scans spent their time.
+     SYSTRACE_FLUSH("scan_benchmark_trace.json");
+
+     process_close(own_process);
+     host_free(heap, bench::heap_size);
+     return 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "../ko_client/kc_memutils.h"
+#include "../ko_client/config/ardream_world_memory_config.h"
+#include "../ko_client/kc_skill_table.h"
+#include "../syscore/sc_log.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A synthetic KO heap, shared by the benchmarks so that their figures can be compared.
+ */
+
+namespace bench
+{
+     // Fills the heap with what the KO heap mostly looks like: zeros, small integers and bits of ASCII text.
+     inline void fill_synthetic_heap(uint8_t* heap, uint64_t size)
+     {
+          uint32_t state = 0x4B4F;
+          for(uint64_t i = 0; i < size; i++)
+          {
+               state ^= state << 13;
+               state ^= state >> 17;
+               state ^= state << 5;
+
+               const uint32_t kind = state % 8;
+               heap[i]             = kind < 4 ? 0x00 : kind < 6 ? (uint8_t) (state >> 8) % 16 : (uint8_t) ('a' + (state >> 8) % 26);
+          }
+     }
+
+     // Writes the significant bytes of a pattern at an offset of the heap.
+     inline void plant_pattern(uint8_t* heap, uint64_t offset, const COMPILED_PATTERN& pattern)
+     {
+          for(size_t i = 0; i < pattern.size; i++)
+          {
+               if(pattern.mask[i]) heap[offset + i] = pattern.value[i];
+          }
+     }
+
+     // The skill table of the client, next to the benchmark executable: cbench.bat copies it into the build directory.
+     inline const SKILL_TABLE& skill_table( )
+     {
+          static const SKILL_TABLE skills = []( ) {
+               const std::string path = host_executable_directory( ) + KO_MEMORY_CONFIG( ).skill_table_path;
+
+               SKILL_TABLE table;
+               if(!table.load(path.c_str( )))
+               {
+                    SYSLOG_ERRORF("Can't load the skill table {}\n", path.c_str( ));
+                    log_flush( );
+                    exit(1);
+               }
+               return table;
+          }( );
+          return skills;
+     }
+
+     // The pattern of the skill the single pattern searches look for.
+     inline const MASKED_PATTERN& spike_pattern( )
+     {
+          const SKILL_TABLE& skills = skill_table( );
+          const size_t       spike  = skills.find("spike");
+          if(spike == SIZE_MAX)
+          {
+               SYSLOG_ERRORF("The skill table has no spike\n");
+               log_flush( );
+               exit(1);
+          }
+          return skills.patterns[spike];
+     }
+
+     // The patterns the client scans for at startup.
+     inline std::vector<COMPILED_PATTERN> heap_patterns(const KO_MEMORY_CONFIG& conf)
+     {
+          std::vector<COMPILED_PATTERN> patterns {conf.player_nation_identification_byte_pattern, conf.mana_hp_anchor_byte_pattern};
+          for(const MASKED_PATTERN& pattern : skill_table( ).patterns) patterns.push_back(pattern);
+          return patterns;
+     }
+
+     // Both nation copies of every pattern, near the end so that the early exit doesn't hide the scan cost.
+     inline void plant_heap_patterns(uint8_t* heap, uint64_t size, const std::vector<COMPILED_PATTERN>& patterns)
+     {
+          for(size_t i = 0; i < patterns.size( ); i++)
+          {
+               plant_pattern(heap, size - MB_TO_BYTES(64) + i * KB_TO_BYTES(4), patterns[i]);
+               plant_pattern(heap, size - MB_TO_BYTES(32) + i * KB_TO_BYTES(4), patterns[i]);
+          }
+     }
+}
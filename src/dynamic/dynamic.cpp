@@ -8,6 +8,6 @@ void dynamic_loop()
    SYSLOG_ERROR("ERROR"<< std::endl);
    SYSLOG_DEBUG("DEBUG"<< std::endl);
    SYSLOG_SUCCESS("SUCCESS"<< std::endl);
-   Sleep(1000);
+   precise_sleep_for(std::chrono::seconds(1));
 }
 
@@ -0,0 +1,281 @@
+#ifndef KC_ADDRESS_CACHE_H
+#define KC_ADDRESS_CACHE_H
+#include "kc_memutils.h"
+
+#include <fstream>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief kc_address_cache.h
+ *
+ * Header only library that remembers where the scan targets were found in a running process, so that attaching to the
+ * same process again doesn't need a scan of its whole heap.
+ * Used internally by the KO Client.
+ *
+ */
+
+/**
+ * @brief Tells apart the processes that share a process ID, since the system reuses the IDs of the processes that exited.
+ */
+struct PROCESS_IDENTITY
+{
+    DWORD process_id = 0;
+    uint64_t creation_time = 0; // As returned by process_creation_time.
+
+    inline bool operator==(const PROCESS_IDENTITY& other) const { return process_id == other.process_id && creation_time == other.creation_time; }
+};
+
+/**
+ * @brief Returns the identity of the process, or an identity with a creation time of 0 if it can't be queried.
+ */
+PROCESS_IDENTITY get_process_identity(HANDLE process_handle, DWORD process_id);
+
+/**
+ * @brief  ADDRESS_CACHE
+ *
+ * Saves the matches of a set of scan targets to a small file, keyed by the identity of the process.
+ *
+ * The matches are cached rather than the pointers derived from them, so that the pattern itself is the fingerprint of every
+ * entry: restoring an entry reads pattern_size bytes at each cached match and compares them with the pattern. Only the
+ * targets whose entry is missing or doesn't verify anymore have to be scanned again.
+ *
+ * A cache saved for another process can't be restored, but its matches are still good hints: the heap of a new client
+ * tends to be laid out like the previous one, so PROCESS_MEMORY_STREAM::find_patterns_near scans around them first.
+ *
+ * @code
+ *   ADDRESS_CACHE cache;
+ *   cache.load("ko_address_cache.bin", identity);
+ *   std::vector<size_t> stale_target_indices = cache.restore(process_handle, targets);
+ *   // ... scan the stale targets near cache.hints(stale_targets), then:
+ *   cache.store(identity, targets);
+ *   cache.save("ko_address_cache.bin");
+ * @endcode
+ */
+class ADDRESS_CACHE
+{
+private:
+    static constexpr uint32_t file_magic = 0x43414F4B; // "KOAC"
+    static constexpr uint32_t file_version = 1;
+
+    struct CACHE_ENTRY
+    {
+        uint64_t signature_hash; // Identifies the target the matches belong to.
+        std::vector<OTHER_PROCESS_PTR> matches;
+    };
+
+    PROCESS_IDENTITY identity;
+    std::vector<CACHE_ENTRY> entries;
+    bool is_same_process = false; // Whether the loaded entries were saved for the process the cache was loaded for.
+
+    // Hash of the pattern, mask and max_matches of the target. A change of the signature invalidates its entry.
+    static uint64_t signature_hash(const PATTERN_SCAN_TARGET& target);
+
+    // Checks that every match still holds the pattern of the target, in the memory of the process.
+    static bool verify_matches(HANDLE process_handle, const PATTERN_SCAN_TARGET& target, const std::vector<OTHER_PROCESS_PTR>& matches);
+
+public:
+    /**
+     * @brief Loads the cache file. The cache is left empty if the file is missing or malformed.
+     *
+     * @param path Path of the cache file.
+     * @param identity The process the cache is for. The entries of another process are only used as hints.
+     * @return true if entries of this very process were loaded, which restore can use.
+     */
+    bool load(const char *path, const PROCESS_IDENTITY& identity);
+
+    /**
+     * @brief Writes the cache file.
+     *
+     * @return true on success.
+     */
+    bool save(const char *path) const;
+
+    /**
+     * @brief Fills the matches of the targets whose cached matches still verify against the memory of the process.
+     *
+     * A handful of small reads, instead of a scan.
+     *
+     * @param process_handle handle to the process, needs PROCESS_VM_READ access
+     * @param targets The targets to restore. The matches of the stale ones are left untouched.
+     * @return std::vector<size_t> The indices of the targets that are stale and need to be scanned. All of them if the
+     *                             cache was saved for another process.
+     */
+    std::vector<size_t> restore(HANDLE process_handle, std::vector<PATTERN_SCAN_TARGET>& targets) const;
+
+    /**
+     * @brief Returns the cached matches of the targets, whatever process they were found in, to start their scan from.
+     */
+    std::vector<OTHER_PROCESS_PTR> hints(const std::vector<PATTERN_SCAN_TARGET>& targets) const;
+
+    /**
+     * @brief Replaces the entries of the cache with the matches of the targets.
+     */
+    void store(const PROCESS_IDENTITY& identity, const std::vector<PATTERN_SCAN_TARGET>& targets);
+};
+
+#endif
+
+#ifdef KC_ADDRESS_CACHE_IMPLEMENTATION
+#pragma once
+    PROCESS_IDENTITY get_process_identity(HANDLE process_handle, DWORD process_id)
+    {
+        PROCESS_IDENTITY identity;
+        identity.process_id = process_id;
+
+        identity.creation_time = process_creation_time(process_handle);
+
+        return identity;
+    }
+
+    uint64_t ADDRESS_CACHE::signature_hash(const PATTERN_SCAN_TARGET& target)
+    {
+        // FNV-1a
+        uint64_t hash = 0xCBF29CE484222325ull;
+        auto hash_bytes = [&hash](const void *bytes, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= ((const uint8_t *) bytes)[i];
+                hash *= 0x100000001B3ull;
+            }
+        };
+
+        const uint64_t pattern_size = target.pattern_size;
+        const uint64_t max_matches = target.max_matches;
+        hash_bytes(&pattern_size, sizeof(pattern_size));
+        hash_bytes(&max_matches, sizeof(max_matches));
+        hash_bytes(target.pattern_ptr, target.pattern_size);
+        if (target.mask_ptr) hash_bytes(target.mask_ptr, target.pattern_size);
+        return hash;
+    }
+
+    bool ADDRESS_CACHE::verify_matches(HANDLE process_handle, const PATTERN_SCAN_TARGET& target, const std::vector<OTHER_PROCESS_PTR>& matches)
+    {
+        // Every match is read in a single batch.
+        std::vector<uint8_t> bytes(target.pattern_size * matches.size());
+        std::vector<PROCESS_READ> reads;
+        for (size_t i = 0; i < matches.size(); i++) reads.push_back({matches[i], bytes.data() + i * target.pattern_size, target.pattern_size, false});
+        if (process_read_batch(process_handle, reads.data(), reads.size()) != reads.size()) return false;
+
+        for (size_t i = 0; i < matches.size(); i++)
+        {
+            if (!memmem_masked_equal(bytes.data() + i * target.pattern_size, target.pattern_ptr, target.mask_ptr, target.pattern_size)) return false;
+        }
+        return true;
+    }
+
+    bool ADDRESS_CACHE::load(const char *path, const PROCESS_IDENTITY& identity)
+    {
+        this->identity = identity;
+        this->entries.clear();
+        this->is_same_process = false;
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        uint32_t magic = 0, version = 0, entry_count = 0;
+        PROCESS_IDENTITY file_identity;
+        file.read((char *) &magic, sizeof(magic));
+        file.read((char *) &version, sizeof(version));
+        file.read((char *) &file_identity.process_id, sizeof(file_identity.process_id));
+        file.read((char *) &file_identity.creation_time, sizeof(file_identity.creation_time));
+        file.read((char *) &entry_count, sizeof(entry_count));
+        if (!file || magic != file_magic || version != file_version) return false;
+
+        // A creation time of 0 means it could not be queried, the process can't be told apart from a previous one with the same ID.
+        const bool is_same_process = file_identity == identity && identity.creation_time != 0;
+
+        for (uint32_t i = 0; i < entry_count; i++)
+        {
+            CACHE_ENTRY entry;
+            uint32_t match_count = 0;
+            file.read((char *) &entry.signature_hash, sizeof(entry.signature_hash));
+            file.read((char *) &match_count, sizeof(match_count));
+            for (uint32_t j = 0; j < match_count && file; j++)
+            {
+                uint64_t match = 0;
+                file.read((char *) &match, sizeof(match));
+                entry.matches.push_back((OTHER_PROCESS_PTR)(uintptr_t) match);
+            }
+            if (!file)
+            {
+                this->entries.clear();
+                return false;
+            }
+            this->entries.push_back(entry);
+        }
+
+        this->is_same_process = is_same_process;
+        return is_same_process && !this->entries.empty();
+    }
+
+    bool ADDRESS_CACHE::save(const char *path) const
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+
+        const uint32_t entry_count = (uint32_t) this->entries.size();
+        file.write((const char *) &file_magic, sizeof(file_magic));
+        file.write((const char *) &file_version, sizeof(file_version));
+        file.write((const char *) &this->identity.process_id, sizeof(this->identity.process_id));
+        file.write((const char *) &this->identity.creation_time, sizeof(this->identity.creation_time));
+        file.write((const char *) &entry_count, sizeof(entry_count));
+
+        for (const CACHE_ENTRY& entry : this->entries)
+        {
+            const uint32_t match_count = (uint32_t) entry.matches.size();
+            file.write((const char *) &entry.signature_hash, sizeof(entry.signature_hash));
+            file.write((const char *) &match_count, sizeof(match_count));
+            for (OTHER_PROCESS_PTR match : entry.matches)
+            {
+                const uint64_t address = (uint64_t)(uintptr_t) match;
+                file.write((const char *) &address, sizeof(address));
+            }
+        }
+        return (bool) file;
+    }
+
+    std::vector<size_t> ADDRESS_CACHE::restore(HANDLE process_handle, std::vector<PATTERN_SCAN_TARGET>& targets) const
+    {
+        std::vector<size_t> stale_target_indices;
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            const uint64_t hash = signature_hash(targets[i]);
+            const CACHE_ENTRY *cached = nullptr;
+            for (const CACHE_ENTRY& entry : this->entries)
+            {
+                if (entry.signature_hash == hash) cached = &entry;
+            }
+
+            // Entries of targets that were not resolved are rescanned, the missing matches may have appeared since.
+            const bool is_valid = this->is_same_process && cached && cached->matches.size() >= targets[i].max_matches && verify_matches(process_handle, targets[i], cached->matches);
+            if (is_valid) targets[i].matches = cached->matches;
+            else stale_target_indices.push_back(i);
+        }
+        return stale_target_indices;
+    }
+
+    std::vector<OTHER_PROCESS_PTR> ADDRESS_CACHE::hints(const std::vector<PATTERN_SCAN_TARGET>& targets) const
+    {
+        std::vector<OTHER_PROCESS_PTR> cached_matches;
+        for (const PATTERN_SCAN_TARGET& target : targets)
+        {
+            const uint64_t hash = signature_hash(target);
+            for (const CACHE_ENTRY& entry : this->entries)
+            {
+                if (entry.signature_hash == hash) cached_matches.insert(cached_matches.end(), entry.matches.begin(), entry.matches.end());
+            }
+        }
+        return cached_matches;
+    }
+
+    void ADDRESS_CACHE::store(const PROCESS_IDENTITY& identity, const std::vector<PATTERN_SCAN_TARGET>& targets)
+    {
+        this->identity = identity;
+        this->entries.clear();
+        this->is_same_process = true;
+        for (const PATTERN_SCAN_TARGET& target : targets) this->entries.push_back({signature_hash(target), target.matches});
+    }
+
+#endif
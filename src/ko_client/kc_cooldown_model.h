@@ -0,0 +1,115 @@
+#ifndef KC_COOLDOWN_MODEL_H
+#define KC_COOLDOWN_MODEL_H
+
+#include <stdint.h>
+
+/**
+ * @brief kc_cooldown_model.h
+ *
+ * Header only library that learns how the cooldown of a skill behaves after an activation, so that an activation can be
+ * confirmed from a single sample instead of a trail of them.
+ * Used internally by the KO Client.
+ *
+ */
+
+/**
+ * @brief A cooldown value, and when it was sampled.
+ */
+struct COOLDOWN_SAMPLE
+{
+    float cooldown;             // Remaining cooldown, in seconds.
+    float seconds_since_press;  // Time between the first key press of the activation and the sample.
+};
+
+/**
+ * @brief  COOLDOWN_MODEL
+ *
+ * Learns the cooldown a skill starts from when it is activated, and how fast it decays, from the activations confirmed
+ * so far.
+ *
+ * A failed activation makes the cooldown spike and collapse back to zero in a split second. A real one starts from the
+ * learned max cooldown and decays at the learned rate. Once trained, the model tells them apart from the sample where the
+ * cooldown rose and one later sample: the rise must be within the learned max cooldown, and the decay between the two
+ * samples must match the learned rate. A collapsing spike decays far too fast, or is back to zero already.
+ *
+ * @code
+ *   if (!model.is_trained()) { ... confirm the activation from a trail of decreasing samples ... }
+ *   else if (model.fits(rise, sample)) { ... confirmed ... }
+ *   model.observe(rise, sample); // Learn from every confirmed activation.
+ * @endcode
+ */
+class COOLDOWN_MODEL
+{
+private:
+    static constexpr float learning_rate = 0.25f;            // Weight of a new activation in the learned values.
+    static constexpr float absolute_tolerance = 0.1f;        // Seconds.
+    static constexpr float max_cooldown_tolerance = 0.05f;   // Fraction of the max cooldown added to the absolute tolerance.
+    static constexpr float decay_rate_tolerance = 0.25f;     // Fraction of the decay rate.
+
+    float expected_max_cooldown = 0.0f;   // Cooldown right after an activation, in seconds.
+    float decay_rate = 1.0f;              // Seconds of cooldown lost per second.
+    uint32_t observation_count = 0;
+
+public:
+    static constexpr uint32_t min_observations = 2;          // Activations to learn from before the model is used.
+    static constexpr float min_decay_window = 0.025f;        // Seconds between the two samples, for the decay to be measured.
+
+    [[nodiscard]] bool is_trained() const noexcept { return observation_count >= min_observations; }
+    [[nodiscard]] float get_expected_max_cooldown() const noexcept { return expected_max_cooldown; }
+    [[nodiscard]] float get_decay_rate() const noexcept { return decay_rate; }
+
+    /**
+     * @brief Whether two samples taken after a key press show a real activation of the skill.
+     *
+     * @param rise First sample where the cooldown was up after the press.
+     * @param sample A later sample, at least min_decay_window after the rise.
+     * @return false if the model is not trained yet.
+     */
+    [[nodiscard]] bool fits(const COOLDOWN_SAMPLE& rise, const COOLDOWN_SAMPLE& sample) const noexcept;
+
+    /**
+     * @brief Learns from the samples of a confirmed activation.
+     */
+    void observe(const COOLDOWN_SAMPLE& rise, const COOLDOWN_SAMPLE& sample) noexcept;
+};
+
+#endif
+
+#ifdef KC_COOLDOWN_MODEL_IMPLEMENTATION
+#pragma once
+    bool COOLDOWN_MODEL::fits(const COOLDOWN_SAMPLE& rise, const COOLDOWN_SAMPLE& sample) const noexcept
+    {
+        if (!is_trained()) return false;
+
+        const float elapsed = sample.seconds_since_press - rise.seconds_since_press;
+        if (elapsed < min_decay_window) return false;
+
+        // The skill was activated between the press and the rise, so the rise is at most the max cooldown and at least what is left of it.
+        const float tolerance = absolute_tolerance + max_cooldown_tolerance * expected_max_cooldown;
+        const float lowest_rise = expected_max_cooldown - decay_rate * rise.seconds_since_press - tolerance;
+        if (rise.cooldown > expected_max_cooldown + tolerance || rise.cooldown < lowest_rise) return false;
+
+        const float observed_decay_rate = (rise.cooldown - sample.cooldown) / elapsed;
+        return observed_decay_rate >= decay_rate * (1.0f - decay_rate_tolerance) && observed_decay_rate <= decay_rate * (1.0f + decay_rate_tolerance);
+    }
+
+    void COOLDOWN_MODEL::observe(const COOLDOWN_SAMPLE& rise, const COOLDOWN_SAMPLE& sample) noexcept
+    {
+        const float elapsed = sample.seconds_since_press - rise.seconds_since_press;
+        if (elapsed <= 0.0f || sample.cooldown >= rise.cooldown) return;
+
+        const float observed_decay_rate = (rise.cooldown - sample.cooldown) / elapsed;
+        if (observation_count == 0)
+        {
+            expected_max_cooldown = rise.cooldown;
+            decay_rate = observed_decay_rate;
+        }
+        else
+        {
+            expected_max_cooldown += learning_rate * (rise.cooldown - expected_max_cooldown);
+            decay_rate += learning_rate * (observed_decay_rate - decay_rate);
+        }
+        observation_count++;
+    }
+
+#endif
@@ -1,12 +1,30 @@
 #ifndef KC_MEMUTILS_H
 #define KC_MEMUTILS_H
-#include <windows.h>
+#include "kc_process_backend.h"
+#include "../syscore/sc_trace.h"
+#include <assert.h>
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define KC_MEMUTILS_X86 1
+#include <immintrin.h>
+#endif
 
 /**
  * @brief kc_memutils.h
  * 
- * Header only library for working with process memories on Windows.
+ * Header only library for working with process memories, through the system calls of kc_process_backend.h.
  * Used internally by the KO Client.
  * 
  */
@@ -25,12 +43,13 @@
  * memmem is a well-known C function that comes as a 'GNU extension', which means it is not something in the standard,
  * but provided by the compilers on different platform. Unfortunately, it is not available on Windows with g++.
  * 
- * This is a copy of the Cygwin's memmem implementation, taken from:
- * https://github.com/Alexpux/Cygwin/blob/master/newlib/libc/string/memmem.c
+ * This used to be a copy of the Cygwin's 'small-size' memmem (https://arka-soft.atlassian.net/browse/SW-41), which
+ * compared the first byte of the needle at every position of the haystack. Most of our patterns start with very common
+ * bytes ('s', 'S', 0x00), so that loop fell into the slow path almost everywhere.
  * 
- * TODO: This is the 'small-size' version of the algorithm. There's also a larger but faster version.
- * It is longer and requires more includes, so I didn't copy it directly. We may switch to it in the future.
- * There's a ticket for it at https://arka-soft.atlassian.net/browse/SW-41
+ * The current version picks the two rarest bytes of the needle (see memmem_find_anchor) and tests both of them
+ * at 16 or 32 haystack positions at once. Only positions where both anchor bytes match are verified with memcmp.
+ * The engine is chosen once at runtime: the fastest of the AVX2, SSE2 and scalar engines the CPU supports.
  * 
  * @param haystack pointer to the start of search space
  * @param hs_len length of the search space in bytes
@@ -41,13 +60,597 @@
  */
 void* memmem(const void *haystack, size_t hs_len, const void *needle, size_t ne_len);
 
-// This type points to an address in the address space of the other process.
-// The data pointed by the OTHER_PROCESS_PTR is meant to be read using ReadProcessMemory function.
-typedef uint8_t *OTHER_PROCESS_PTR; 
+/**
+ * @brief The search engines memmem can dispatch to.
+ */
+enum class MEMMEM_ENGINE : uint8_t
+{
+    SCALAR, // memchr on the rarest byte, then a check of the second anchor byte.
+    SSE2,   // rare1 over 128 aligned bytes per step, then rare2 on 16 positions at a time.
+    AVX2    // rare1 over 128 aligned bytes per step, then rare2 on 32 positions at a time.
+};
+
+/**
+ * @brief Offsets of the two needle bytes that are least likely to appear in the haystack.
+ * 
+ * Candidates are filtered on these two bytes before the whole needle is compared.
+ * rare1_offset and rare2_offset are equal only when the needle is a single byte.
+ */
+struct MEMMEM_ANCHOR
+{
+    size_t rare1_offset;
+    size_t rare2_offset;
+};
+
+// Relative frequency of each byte value in the KO heap (0 = never seen, 255 = most common).
+// Rough figures from dumps of the client memory: zero padding and small integers dominate,
+// followed by the ASCII letters of the item / skill strings. The '?' placeholders are frequent as well.
+inline constexpr uint8_t memmem_byte_frequency[256] = {
+    255, 195, 190, 185, 180, 175, 170, 165, 160, 155, 150, 145, 140, 135, 130, 125, // 0x0_
+     70,  70,  70,  70,  70,  70,  70,  70,  70,  70,  70,  70,  70,  70,  70,  70, // 0x1_
+    160,  32,  32,  32,  32,  32,  32,  32,  70,  70,  32,  32,  70,  70,  70,  70, // 0x2_
+     80,  78,  76,  74,  72,  70,  68,  66,  64,  62,  70,  32,  90,  32,  32, 120, // 0x3_
+     90,  56,  36,  38,  40,  60,  36,  36,  44,  52,  36,  36,  42,  36,  50,  54, // 0x4_
+     36,  36,  46,  48,  58,  36,  36,  36,  36,  36,  36,  70,  70,  70,  32,  70, // 0x5_
+     32, 142,  74, 106, 110, 150,  94,  86, 118, 134,  58,  66, 114,  98, 130, 138, // 0x6_
+     90,  54, 122, 126, 146, 102,  70,  82,  62,  78,  50,  32,  32,  32,  32,  32, // 0x7_
+     60,  24,  24,  24,  24,  24,  24,  24,  24,  60,  24,  60,  24,  24,  24,  24, // 0x8_
+     24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24, // 0x9_
+     24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24, // 0xA_
+     24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24, // 0xB_
+     60,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  60,  60,  24,  24, // 0xC_
+     24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24, // 0xD_
+     24,  24,  24,  24,  24,  24,  24,  24,  60,  24,  24,  24,  24,  24,  24,  24, // 0xE_
+     24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  24,  60, 230, // 0xF_
+};
+
+/**
+ * @brief Picks the rarest byte pair of the needle, according to a fixed byte frequency table of the KO heap.
+ * 
+ * @param needle pointer to the pattern of bytes
+ * @param ne_len length of the pattern of bytes, must be greater than 0
+ * @param mask (Optional) 0xFF for the bytes of the needle that must match, 0x00 for wildcards. Wildcards are never anchors.
+ * @return MEMMEM_ANCHOR the offsets of the two anchor bytes within the needle
+ */
+constexpr MEMMEM_ANCHOR memmem_find_anchor(const uint8_t *needle, size_t ne_len, const uint8_t *mask = nullptr)
+{
+    MEMMEM_ANCHOR anchor = {0, 0};
+
+    // Wildcards can match anything, they can't be anchors.
+    auto is_significant = [mask](size_t i) { return !mask || mask[i] == 0xFF; };
+
+    bool found_first = false;
+    for (size_t i = 0; i < ne_len; i++)
+    {
+        if (!is_significant(i)) continue;
+        if (!found_first || memmem_byte_frequency[needle[i]] < memmem_byte_frequency[needle[anchor.rare1_offset]])
+        {
+            anchor.rare1_offset = i;
+            found_first = true;
+        }
+    }
+
+    // The second anchor should preferably be a different byte value, otherwise it filters out nothing
+    // in runs of the same byte. Fall back to any other position if the needle is made of a single value.
+    bool found_second = false;
+    for (size_t i = 0; i < ne_len; i++)
+    {
+        if (i == anchor.rare1_offset || !is_significant(i)) continue;
+
+        const bool is_different_value = needle[i] != needle[anchor.rare1_offset];
+        const bool was_different_value = found_second && needle[anchor.rare2_offset] != needle[anchor.rare1_offset];
+        if (!found_second ||
+            (is_different_value && !was_different_value) ||
+            (is_different_value == was_different_value && memmem_byte_frequency[needle[i]] < memmem_byte_frequency[needle[anchor.rare2_offset]]))
+        {
+            anchor.rare2_offset = i;
+            found_second = true;
+        }
+    }
+
+    if (!found_second) anchor.rare2_offset = anchor.rare1_offset;
+    return anchor;
+}
+
+/**
+ * @brief Picks the window of window_size bytes without wildcards that is the rarest, according to memmem_byte_frequency.
+ *
+ * Windows of zero bytes only are never picked: zero filled memory is everywhere, whatever their score.
+ *
+ * @param mask (Optional) 0x00 for the wildcards of the needle.
+ * @return size_t the offset of the window within the needle, SIZE_MAX if every window has a wildcard or is all zeros.
+ */
+constexpr size_t memmem_find_window(const uint8_t *needle, const uint8_t *mask, size_t ne_len, size_t window_size)
+{
+    size_t best_offset = SIZE_MAX;
+    uint32_t best_frequency = UINT32_MAX;
+    for (size_t offset = 0; offset + window_size <= ne_len; offset++)
+    {
+        uint32_t frequency = 0;
+        bool has_wildcard = false;
+        bool is_all_zeros = true;
+        for (size_t i = 0; i < window_size; i++)
+        {
+            has_wildcard = has_wildcard || (mask && mask[offset + i] != 0xFF);
+            is_all_zeros = is_all_zeros && needle[offset + i] == 0x00;
+            frequency += memmem_byte_frequency[needle[offset + i]];
+        }
+
+        if (!has_wildcard && !is_all_zeros && frequency < best_frequency)
+        {
+            best_frequency = frequency;
+            best_offset = offset;
+        }
+    }
+    return best_offset;
+}
+
+/**
+ * @brief Sum of the memmem_byte_frequency of the window_size bytes at offset, the score memmem_find_window minimizes.
+ */
+constexpr uint32_t memmem_window_frequency(const uint8_t *needle, size_t offset, size_t window_size)
+{
+    uint32_t frequency = 0;
+    for (size_t i = 0; i < window_size; i++) frequency += memmem_byte_frequency[needle[offset + i]];
+    return frequency;
+}
+
+/**
+ * @brief Fills the Boyer-Moore-Horspool shift table of a needle with wildcards.
+ *
+ * When the needle does not match at a position, shifts[c], where c is the haystack byte under the last byte of the needle,
+ * is a distance the search can skip: no closer position puts an equal byte or a wildcard of the needle over c.
+ * A wildcard matches every byte, so the last wildcard before the end of the needle bounds every shift.
+ * Shifts are capped to 255, a smaller shift is always safe.
+ *
+ * @param shifts receives 256 shifts, one per byte value
+ */
+constexpr void memmem_horspool_shifts(const uint8_t *needle, const uint8_t *mask, size_t ne_len, uint8_t *shifts)
+{
+    size_t max_shift = ne_len < 255 ? ne_len : 255;
+    for (size_t i = 0; i + 1 < ne_len; i++)
+    {
+        if (mask && mask[i] != 0xFF && ne_len - 1 - i < max_shift) max_shift = ne_len - 1 - i;
+    }
+
+    for (size_t c = 0; c < 256; c++) shifts[c] = (uint8_t) max_shift;
+    for (size_t i = 0; i + 1 < ne_len; i++)
+    {
+        if (ne_len - 1 - i < shifts[needle[i]]) shifts[needle[i]] = (uint8_t)(ne_len - 1 - i);
+    }
+}
+
+/**
+ * @brief Size of the window without wildcards the multi-pattern scans index every pattern by, see MULTI_PATTERN_MATCHER.
+ * It is also the number of bytes the shuffle filter looks at, so the window is exactly what the filter keys on.
+ */
+constexpr size_t pattern_window_size = 3;
+
+/**
+ * @brief Highest memmem_window_frequency of a window the multi-pattern scans filter on, about 128 per byte.
+ * A pattern whose rarest window scores higher would let most positions through the filter, it is searched with memmem instead.
+ */
+constexpr uint32_t pattern_window_max_frequency = 384;
+
+/**
+ * @brief A needle with wildcards, and what the searches precompute from it.
+ *
+ * It only points to the bytes of a MASKED_PATTERN or a SIGNATURE, which must outlive it. Both convert to it, so the
+ * searches get the anchors and the shift table ready instead of recomputing them on every call.
+ */
+struct COMPILED_PATTERN
+{
+    const uint8_t *value = nullptr;
+    const uint8_t *mask = nullptr;      // Null if every byte must match.
+    size_t size = 0;
+    MEMMEM_ANCHOR anchor = {0, 0};      // See memmem_find_anchor.
+    size_t window_offset = SIZE_MAX;    // See memmem_find_window, SIZE_MAX if the pattern has no window without wildcards.
+    const uint8_t *shifts = nullptr;    // 256 shifts, see memmem_horspool_shifts. Null to move one position at a time.
+};
+
+/**
+ * @brief Computes the anchors of a needle, without a shift table. For the needles that are only searched once.
+ */
+constexpr COMPILED_PATTERN compile_pattern(const uint8_t *needle, const uint8_t *mask, size_t ne_len)
+{
+    return {needle, mask, ne_len, memmem_find_anchor(needle, ne_len, mask), memmem_find_window(needle, mask, ne_len, pattern_window_size), nullptr};
+}
+
+/**
+ * @brief memmem for patterns with wildcards.
+ * 
+ * Same search as memmem, except that the bytes of the needle whose mask is 0x00 match any byte of the haystack.
+ * The anchors are picked among the significant bytes, and candidates are verified with a vectorized masked compare.
+ * 
+ * @param haystack pointer to the start of search space
+ * @param hs_len length of the search space in bytes
+ * @param needle pointer to the pattern of bytes, wildcard bytes are ignored
+ * @param needle_mask pointer to the mask of the pattern, 0xFF for the bytes that must match and 0x00 for wildcards
+ * @param ne_len length of the pattern and its mask
+ * @return void* returns a pointer to the beginning of the pattern found in the haystack
+ */
+void* memmem_masked(const void *haystack, size_t hs_len, const void *needle, const void *needle_mask, size_t ne_len);
+
+/**
+ * @brief memmem_masked with a compiled needle: the anchors are not picked again, and after a candidate that does not
+ * match, the search skips ahead by the shift table of the needle.
+ *
+ * @return void* returns a pointer to the beginning of the pattern found in the haystack
+ */
+void* memmem_compiled(const void *haystack, size_t hs_len, const COMPILED_PATTERN& needle);
+
+/**
+ * @brief Compares size bytes of data with value, ignoring the bits that are 0 in mask. A null mask compares every byte.
+ */
+bool memmem_masked_equal(const uint8_t *data, const uint8_t *value, const uint8_t *mask, size_t size);
+
+/**
+ * @brief Returns the engine memmem dispatches to on this CPU, the fastest one measured the first time it is called.
+ */
+MEMMEM_ENGINE memmem_active_engine();
+
+/**
+ * @brief Runs memmem on a specific engine. Used for verification and benchmarks.
+ * 
+ * Falls back to the next slower engine if the CPU does not support the requested one.
+ */
+void* memmem_with_engine(MEMMEM_ENGINE engine, const void *haystack, size_t hs_len, const void *needle, size_t ne_len);
+void* memmem_masked_with_engine(MEMMEM_ENGINE engine, const void *haystack, size_t hs_len, const void *needle, const void *needle_mask, size_t ne_len);
+void* memmem_compiled_with_engine(MEMMEM_ENGINE engine, const void *haystack, size_t hs_len, const COMPILED_PATTERN& needle);
+
+/**
+ * @brief Reference implementation of memmem with the Two-Way algorithm of Crochemore and Perrin.
+ * 
+ * It is linear in time, uses constant space and shares no code with the engines above,
+ * which makes it a good oracle to check them against. It is not meant to be used for scanning.
+ */
+void* memmem_two_way(const void *haystack, size_t hs_len, const void *needle, size_t ne_len);
+
+/**
+ * @brief Checks every supported memmem engine against memmem_two_way on pseudo-random haystacks and needles.
+ * 
+ * The haystacks are built from a small alphabet, so that partial matches and matches near the ends are frequent.
+ * 
+ * @param iterations number of random haystack / needle pairs to check
+ * @param seed seed of the pseudo-random generator, so that a failure can be reproduced
+ * @return true if all the engines agree with the reference on every pair
+ */
+bool memmem_self_test(uint32_t iterations = 2000, uint32_t seed = 0x4B4F);
+
+/**
+ * @brief A byte pattern with wildcards, stored as value + mask pairs.
+ *
+ * Patterns are written in the IDA style: hexadecimal bytes separated by spaces, with '??' (or '?') for the bytes
+ * that can be anything. Wildcards let signatures skip the bytes that change between client builds.
+ *
+ * The anchors and the shift table of the searches are computed once, when the pattern is parsed. Signatures that are
+ * known at compile time should be a SIGNATURE instead, see COMPILE_SIGNATURE.
+ *
+ * @code
+ *   MASKED_PATTERN spike {"53 70 69 6B 65 00 ?? ?? 05 00 00 00"};
+ * @endcode
+ */
+struct MASKED_PATTERN
+{
+    std::vector<BYTE> value; // The bytes of the pattern, 0 for the wildcards.
+    std::vector<BYTE> mask; // 0xFF for the bytes that must match, 0x00 for the wildcards.
+    MEMMEM_ANCHOR anchor = {0, 0}; // Precomputed by compile, see COMPILED_PATTERN.
+    size_t window_offset = SIZE_MAX;
+    uint8_t shifts[256] = {};
+
+    MASKED_PATTERN() = default;
+
+    /**
+     * @brief Parses an IDA style signature. Asserts that the signature is well-formed.
+     */
+    explicit MASKED_PATTERN(const char *ida_signature);
+
+    /**
+     * @brief Creates a pattern without wildcards from raw bytes.
+     */
+    MASKED_PATTERN(const BYTE *bytes, size_t size) : value(bytes, bytes + size), mask(size, 0xFF) { compile(); }
+
+    /**
+     * @brief Parses an IDA style signature into pattern.
+     *
+     * @param ida_signature Hexadecimal bytes and '??' wildcards, separated by spaces.
+     * @param pattern Receives the parsed pattern. Left empty if the signature is malformed.
+     * @return true if the signature is well-formed and not empty.
+     */
+    static bool parse(const char *ida_signature, MASKED_PATTERN& pattern);
+
+    /**
+     * @brief Computes the anchors and the shift table. Must be called again if value or mask are changed.
+     */
+    void compile()
+    {
+        anchor = memmem_find_anchor(value.data(), size(), mask.data());
+        window_offset = memmem_find_window(value.data(), mask.data(), size(), pattern_window_size);
+        memmem_horspool_shifts(value.data(), mask.data(), size(), shifts);
+    }
+
+    inline size_t size() const { return value.size(); }
+
+    operator COMPILED_PATTERN() const { return {value.data(), mask.data(), size(), anchor, window_offset, shifts}; }
+};
+
+/**
+ * @brief A pattern compiled from an IDA style signature at compile time, see COMPILE_SIGNATURE.
+ *
+ * Holds the same bytes, mask and precomputed tables as a parsed MASKED_PATTERN, in constant storage instead of vectors,
+ * so nothing is parsed nor allocated at runtime.
+ */
+template<size_t N>
+struct SIGNATURE
+{
+    BYTE value[N] = {};
+    BYTE mask[N] = {};
+    MEMMEM_ANCHOR anchor = {0, 0};
+    size_t window_offset = SIZE_MAX;
+    uint8_t shifts[256] = {};
+
+    static constexpr size_t size() { return N; }
+
+    constexpr operator COMPILED_PATTERN() const { return {value, mask, N, anchor, window_offset, shifts}; }
+};
+
+/**
+ * @brief Never defined. Malformed signatures reach a call to it while they are compiled, which is not a constant expression.
+ */
+void signature_is_malformed(const char *reason);
+
+constexpr int signature_hex_digit(char c)
+{
+    return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+/**
+ * @brief Number of bytes of an IDA style signature, with the grammar of MASKED_PATTERN::parse.
+ */
+constexpr size_t signature_size(const char *ida_signature)
+{
+    size_t size = 0;
+    const char *c = ida_signature;
+    while (*c)
+    {
+        if (*c == ' ') { c++; continue; }
+
+        if (c[0] == '?') c += c[1] == '?' ? 2 : 1;
+        else if (signature_hex_digit(c[0]) >= 0 && signature_hex_digit(c[1]) >= 0) c += 2;
+        else signature_is_malformed("bytes are 2 hexadecimal digits or a wildcard");
+
+        if (*c && *c != ' ') signature_is_malformed("bytes are separated by spaces");
+        size++;
+    }
+
+    if (size == 0) signature_is_malformed("the signature is empty");
+    return size;
+}
+
+/**
+ * @brief Compiles an IDA style signature of N bytes, see COMPILE_SIGNATURE.
+ */
+template<size_t N>
+constexpr SIGNATURE<N> signature_compile(const char *ida_signature)
+{
+    SIGNATURE<N> signature;
+    size_t size = 0;
+    const char *c = ida_signature;
+    while (*c)
+    {
+        if (*c == ' ') { c++; continue; }
+
+        if (c[0] == '?')
+        {
+            c += c[1] == '?' ? 2 : 1;
+            signature.value[size] = 0x00;
+            signature.mask[size] = 0x00;
+        }
+        else
+        {
+            signature.value[size] = (BYTE)(signature_hex_digit(c[0]) << 4 | signature_hex_digit(c[1]));
+            signature.mask[size] = 0xFF;
+            c += 2;
+        }
+        size++;
+    }
+
+    signature.anchor = memmem_find_anchor(signature.value, N, signature.mask);
+    signature.window_offset = memmem_find_window(signature.value, signature.mask, N, pattern_window_size);
+    memmem_horspool_shifts(signature.value, signature.mask, N, signature.shifts);
+    return signature;
+}
+
+/**
+ * @brief Compiles an IDA style signature, given as a string literal, into a SIGNATURE at compile time.
+ *
+ * The bytes, the mask, the anchors and the shift table are all constants. A malformed signature does not compile.
+ *
+ * @code
+ *   static constexpr auto spike = COMPILE_SIGNATURE("53 70 69 6B 65 00 ?? ?? 05 00 00 00");
+ *   memory.find_pattern_in_memory(spike);
+ * @endcode
+ */
+#define COMPILE_SIGNATURE(ida_signature) ([]() { constexpr auto compiled_signature = signature_compile<signature_size(ida_signature)>(ida_signature); return compiled_signature; }())
+
+/**
+ * @brief One pattern of a multi-pattern scan, and the matches that were found for it.
+ *
+ * The scan stops looking for a pattern once it has max_matches matches,
+ * and stops altogether once every pattern of the set has reached its max_matches.
+ */
+struct PATTERN_SCAN_TARGET
+{
+    const BYTE *pattern_ptr = nullptr; // Pointer to the beginning of the byte pattern to search for.
+    const BYTE *mask_ptr = nullptr; // (Optional) Mask of the pattern, 0x00 for wildcards. Every byte must match if null.
+    size_t pattern_size = 0; // Size of the byte pattern in bytes. At least MULTI_PATTERN_MATCHER::anchor_size bytes.
+    size_t max_matches = 1; // Number of matches after which the pattern is resolved. SIZE_MAX to find all of them.
+    size_t window_offset = SIZE_MAX; // (Optional) Precomputed window the pattern is indexed by, see memmem_find_window. SIZE_MAX to pick it when the scan starts.
+    std::vector<OTHER_PROCESS_PTR> matches; // Filled by the scan, in ascending address order, in the address space of the external process.
+
+    PATTERN_SCAN_TARGET() = default;
+    PATTERN_SCAN_TARGET(const BYTE *pattern_ptr, size_t pattern_size, size_t max_matches = 1) : pattern_ptr(pattern_ptr), pattern_size(pattern_size), max_matches(max_matches) {}
+    explicit PATTERN_SCAN_TARGET(const COMPILED_PATTERN& pattern, size_t max_matches = 1) : pattern_ptr(pattern.value), mask_ptr(pattern.mask), pattern_size(pattern.size), max_matches(max_matches), window_offset(pattern.window_offset) {}
+
+    inline bool is_resolved() const { return matches.size() >= max_matches; }
+};
+
+/**
+ * @brief  MULTI_PATTERN_MATCHER
+ *
+ * Searches a set of patterns in a single pass over a buffer.
+ *
+ * Every pattern is indexed by the rarest 3-byte window without wildcards it contains (its anchor). Positions of the buffer are first
+ * filtered, and only the positions that pass are compared against the anchors of the buckets that fired and then the whole patterns:
+ *  - With AVX2, the anchor bytes are looked up nibble by nibble in shuffle tables (the 'Teddy' filter of Hyperscan).
+ *    The anchors are spread over 8 buckets, and 32 positions are filtered per step whatever the number of patterns.
+ *  - Otherwise, each position is hashed into a small bit filter of the anchor keys that fits in the L1 cache.
+ *
+ * The cost of a scan barely depends on the number of patterns, unlike one memmem pass per pattern. That only holds while the
+ * anchors are rare: a pattern without a window under pattern_window_max_frequency (mostly zeros, wildcards) would make the filter
+ * fire on most positions, so it is searched with its own memmem_compiled pass instead.
+ */
+class MULTI_PATTERN_MATCHER
+{
+public:
+    static const size_t anchor_size = pattern_window_size; // Size of the window every pattern is indexed by.
+
+private:
+    static const uint32_t filter_hash_bits = 16;
+    static const size_t bucket_count = 8;
+
+    struct ANCHOR
+    {
+        uint32_t key; // The anchor bytes, as loaded from memory into a zeroed integer.
+        size_t offset; // Offset of the anchor within the pattern.
+        size_t target_index; // Index of the pattern within the scan targets.
+    };
+
+    // A pattern without a rare enough anchor, searched on its own.
+    struct MEMMEM_TARGET
+    {
+        COMPILED_PATTERN pattern; // Without its shift table, which lives below and moves with the target.
+        uint8_t shifts[256];
+        size_t target_index;
+    };
+
+    std::vector<uint64_t> anchor_filter; // One bit per hash value of an anchor key.
+    std::vector<ANCHOR> bucket_anchors[bucket_count];
+    std::vector<MEMMEM_TARGET> memmem_targets;
+
+    // For every anchor byte, the buckets whose anchor has a given low / high nibble at that byte.
+    // Each 16-byte table is repeated twice, once for each 128-bit lane of an AVX2 register.
+    uint8_t fingerprint_low_nibble_buckets[anchor_size][32] = {};
+    uint8_t fingerprint_high_nibble_buckets[anchor_size][32] = {};
+
+    static inline uint32_t hash_anchor_key(uint32_t key) { return (key * 0x9E3779B1u) >> (32 - filter_hash_bits); }
+
+    // The state of one call to scan.
+    struct SCAN_CONTEXT
+    {
+        const uint8_t *data;
+        size_t data_size;
+        size_t report_end;
+        OTHER_PROCESS_PTR data_address;
+        std::vector<PATTERN_SCAN_TARGET>& targets;
+        size_t unresolved_count;
+    };
+
+    // Compares the anchors of the buckets set in bucket_mask against the position and records the matches. Returns true once every target is resolved.
+    bool verify_position(SCAN_CONTEXT& context, size_t position, uint8_t bucket_mask) const;
+
+    // Runs the memmem pass of every memmem target. Returns true once every target is resolved.
+    bool scan_memmem_targets(SCAN_CONTEXT& context) const;
+
+    // Runs the shuffle filter from position, as long as a full step fits. Leaves position where it stopped.
+    bool scan_avx2(SCAN_CONTEXT& context, size_t& position) const;
+
+public:
+    /**
+     * @brief Indexes the patterns of the targets. The targets must outlive the matcher.
+     */
+    explicit MULTI_PATTERN_MATCHER(const std::vector<PATTERN_SCAN_TARGET>& targets);
+
+    /**
+     * @brief Searches all the unresolved targets in the buffer and appends their matches.
+     *
+     * @param data Pointer to the buffer to search in, in the address space of the host process.
+     * @param data_size Size of the buffer in bytes.
+     * @param data_address Address of the buffer in the address space of the external process, used to report matches.
+     * @param targets The targets the matcher was built with.
+     * @param report_end (Optional) Matches starting at or after this offset are ignored. Used when the end of the buffer
+     *                   overlaps the beginning of the next buffer to scan, so that matches are reported only once.
+     * @return true if every target is resolved, in which case the scan stopped early.
+     */
+    bool scan(const uint8_t *data, size_t data_size, OTHER_PROCESS_PTR data_address, std::vector<PATTERN_SCAN_TARGET>& targets, size_t report_end = SIZE_MAX) const;
+};
+
+/**
+ * @brief Parallel scan settings of PROCESS_MEMORY.
+ *
+ * The scanned range is split into shards of shard_size bytes, which overlap by (pattern size - 1) bytes so that
+ * no match is lost at their edges. The shards are searched on a worker pool and the results are merged in address order,
+ * so a parallel scan returns exactly what the serial scan returns.
+ */
+struct PARALLEL_SCAN_CONFIG
+{
+    uint32_t worker_count = 1; // Number of threads searching, including the caller. 1 for a serial scan, 0 for one per core.
+    size_t shard_size = MB_TO_BYTES(16); // Size of a shard. Small enough to balance the load, large enough to amortize the scheduling.
+};
+
+/**
+ * @brief  SCAN_WORKER_POOL
+ *
+ * A fixed set of threads that run the tasks of a parallel scan. The threads live as long as the pool,
+ * so that consecutive scans don't pay for thread creation.
+ */
+class SCAN_WORKER_POOL
+{
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+
+    const std::function<void(size_t)> *task = nullptr; // The task of the current run, called with the index of each task.
+    size_t task_count = 0;
+    std::atomic<size_t> next_task_index {0};
+    size_t busy_worker_count = 0;
+    uint64_t run_generation = 0; // Incremented by every run, so that the workers know there is new work.
+    bool is_stopping = false;
+
+    void worker_loop();
+    void run_tasks(); // Takes tasks of the current run until there are none left.
+
+public:
+    /**
+     * @brief Starts worker_count - 1 threads, the thread calling run is the last worker.
+     */
+    explicit SCAN_WORKER_POOL(uint32_t worker_count);
+    ~SCAN_WORKER_POOL();
+
+    SCAN_WORKER_POOL(const SCAN_WORKER_POOL&) = delete;
+    SCAN_WORKER_POOL& operator=(const SCAN_WORKER_POOL&) = delete;
+
+    /**
+     * @brief Calls task(i) for every i in [0, task_count) on the pool and returns once all of them have returned.
+     *
+     * Tasks are handed out in ascending order of i.
+     */
+    void run(size_t task_count, const std::function<void(size_t)>& task);
+
+    inline size_t worker_count() const { return workers.size() + 1; }
+};
 
-// This type points to an address in the address space of our own process.
-// The data pointed by the HOST_PROCESS_PTR can be accessed as usual using the asterisk (*) operator.
-typedef uint8_t *HOST_PROCESS_PTR;  
+/**
+ * @brief A run of contiguous readable memory of the other process, copied by PROCESS_MEMORY.
+ */
+struct MAPPED_REGION
+{
+    OTHER_PROCESS_PTR base_address; // Start of the run, in the address space of the other process.
+    SIZE_T size; // Size of the run in bytes.
+    size_t map_offset; // Offset of its copy within the mapped memory.
+};
 
 /**
  * @brief  PROCESS_MEMORY
@@ -55,31 +658,104 @@ typedef uint8_t *HOST_PROCESS_PTR;
  * This is a utility class that can copy large chunks of memory from another process
  * into a heap-allocated memory within the address space of the current process.
  * 
- * If there are regions marked with NO_ACCESS within the target memory, they are set to 0.
+ * Only the committed, readable regions are copied, optionally only the private ones. Most of the KO heap is reserved
+ * address space with nothing behind it. The copied regions are packed one after the other in the mapped memory, and a
+ * region table sorted by address keeps track of where each run of contiguous regions came from.
+ * Searches never cross the holes between the runs.
  * 
  * It comes with utility methods to search within the address space,
  * as well as means by which pointers can be translated between the process space of the host process,
  * and the other process.
+ *
+ * The copy can also be saved to a dump file, and loaded from it later where the process doesn't run. A dump is mapped
+ * into memory as is, read only, so loading it copies nothing and the pointers translate to the original addresses.
+ * A dump file is a header page, then the copied runs one after the other, then the region table.
  * 
  */
 class PROCESS_MEMORY
 {
     // DATA:
 private:
+    static constexpr uint32_t dump_magic = 0x4D444F4B; // "KODM"
+    static constexpr uint32_t dump_version = 1;
+    static constexpr uint64_t dump_data_offset = KB_TO_BYTES(4); // The runs start on a page of their own, aligned for the searches.
+
+    struct DUMP_HEADER
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t region_count;
+        uint64_t map_base_address;
+        uint64_t map_num_bytes;
+        uint64_t data_offset; // Offset of the runs in the file.
+        uint64_t table_offset; // Offset of the region table in the file, region_count DUMP_REGION entries.
+    };
+
+    struct DUMP_REGION
+    {
+        uint64_t base_address;
+        uint64_t size;
+        uint64_t map_offset;
+    };
+
     HOST_PROCESS_PTR mapped_memory = nullptr; // pointer to a region in our heap that will hold a copy of the other process' memory.
     OTHER_PROCESS_PTR map_base_address = nullptr; // the address in the address space of the other process at which we started copying.
-    SIZE_T map_num_bytes = 0; // number of bytes to copy from the other process
+    SIZE_T map_num_bytes = 0; // number of bytes copied from the other process, the sum of the region sizes.
+    SIZE_T map_capacity = 0; // number of bytes allocated for mapped_memory.
+    HOST_PROCESS_PTR dump_view = nullptr; // The mapped dump file when loaded from one, mapped_memory points into it.
+    size_t dump_view_size = 0;
+    std::vector<MAPPED_REGION> regions; // The copied runs, sorted by address and by map offset alike.
+
+    // Appends a run to a region table, merging it with the last one if they follow each other in both address spaces.
+    static void append_run(std::vector<MAPPED_REGION>& regions, OTHER_PROCESS_PTR base_address, SIZE_T size, size_t map_offset);
+
+    // Writes the region table after the runs, then the header in front of them.
+    static bool finish_dump(std::ofstream& file, OTHER_PROCESS_PTR map_base_address, SIZE_T map_num_bytes, const std::vector<MAPPED_REGION>& regions);
+
+    PARALLEL_SCAN_CONFIG parallel_scan_config; // Serial by default.
+    std::unique_ptr<SCAN_WORKER_POOL> scan_worker_pool; // Only exists when the parallel scan is enabled.
+
+    // A piece of a region searched by one task. Matches starting in [map_offset, map_offset + size) belong to the shard,
+    // and the search may read up to region_end to complete them.
+    struct SCAN_SHARD
+    {
+        size_t map_offset;
+        size_t size;
+        size_t region_end;
+    };
+
+    // Splits the regions into shards of at most shard_size bytes, starting from map_offset.
+    std::vector<SCAN_SHARD> split_into_shards(size_t map_offset, size_t shard_size) const;
+
+    // Offset in the mapped memory of ptr, or of the first copied byte after ptr if it points into a hole.
+    size_t map_offset_at_or_after(OTHER_PROCESS_PTR ptr) const;
+
+    // Shared implementation of the find_pattern_in_memory overloads.
+    OTHER_PROCESS_PTR find_compiled_pattern_in_memory(const COMPILED_PATTERN& pattern, OTHER_PROCESS_PTR search_start_addr_in_process_space);
+
+    // Searches a pattern from map_offset to the end of the mapped memory, shard by shard on the worker pool.
+    // Returns the map offset of the first match, SIZE_MAX if there is none.
+    size_t find_in_shards(size_t map_offset, const COMPILED_PATTERN& pattern);
 
     // METHODS:
     /**
-     * @brief Construct PROCESS_MEMORY, copies num_bytes from the base_address into heap.
+     * @brief Construct PROCESS_MEMORY, copies the readable regions of [base_address, base_address + num_bytes) into heap.
      * 
      * @param process_handle handle to the process
      * @param base_address base address in the address space of the external process to start the map from
-     * @param num_bytes number of bytes to copy
+     * @param num_bytes number of bytes of address space to map
+     * @param private_regions_only (Optional) Skips the image and mapped file regions, keeping only MEM_PRIVATE memory such as the heaps.
      */
 public:
-    explicit PROCESS_MEMORY(HANDLE process_handle, OTHER_PROCESS_PTR base_address, SIZE_T num_bytes);
+    explicit PROCESS_MEMORY(HANDLE process_handle, OTHER_PROCESS_PTR base_address, SIZE_T num_bytes, bool private_regions_only = false);
+
+    /**
+     * @brief Construct PROCESS_MEMORY from a dump file, written by save_dump or capture_dump. The file is mapped, not copied.
+     *
+     * @param dump_path Path of the dump file. Nothing is mapped if it is missing or malformed.
+     */
+    explicit PROCESS_MEMORY(const char *dump_path);
+
     /**
      * @brief Destroy PROCESS_MEMORY. Deallocates all the copied memory.
      * 
@@ -90,14 +766,41 @@ public:
     PROCESS_MEMORY(const PROCESS_MEMORY&) = delete;
     PROCESS_MEMORY& operator=(const PROCESS_MEMORY&) = delete;
 
+    /**
+     * @brief Writes the mapped memory and its region table to a dump file.
+     *
+     * @return true on success.
+     */
+    bool save_dump(const char *dump_path) const;
+
+    /**
+     * @brief Writes the readable regions of [base_address, base_address + num_bytes) of a process straight to a dump file.
+     *
+     * Same dump as a PROCESS_MEMORY of the range followed by save_dump, but the regions are streamed to the file through
+     * a small buffer instead of being copied whole first.
+     *
+     * @param process_handle handle to the process
+     * @param private_regions_only (Optional) Skips the image and mapped file regions, keeping only MEM_PRIVATE memory such as the heaps.
+     * @return true on success.
+     */
+    static bool capture_dump(HANDLE process_handle, OTHER_PROCESS_PTR base_address, SIZE_T num_bytes, const char *dump_path, bool private_regions_only = false);
+
+    /**
+     * @brief Enables or disables the parallel scan for the find methods. Results are identical in both modes.
+     *
+     * @param config Worker count and shard size. A worker count of 1 goes back to the serial scan.
+     */
+    void set_parallel_scan(const PARALLEL_SCAN_CONFIG& config);
+
 
     /**
      * @brief Translates a pointer within the internal mapped_memory to a pointer in the address space of the external process.
      * 
      * @param ptr A pointer pointing somewhere within the internal mapped_memory byte array.
      * @return OTHER_PROCESS_PTR A pointer to the same address, expressed in the address space of the external process.
+     *                           nullptr if ptr is outside of the mapped memory.
      */
-    inline OTHER_PROCESS_PTR host_ptr_to_other(HOST_PROCESS_PTR ptr) { return (OTHER_PROCESS_PTR)((uint8_t *)map_base_address + ((uint64_t)ptr - (uint64_t)mapped_memory)); }
+    OTHER_PROCESS_PTR host_ptr_to_other(HOST_PROCESS_PTR ptr) const;
 
 
     /**
@@ -105,8 +808,14 @@ public:
      * 
      * @param ptr A pointer pointing to an address in the address space of the external process.
      * @return HOST_PROCESS_PTR A pointer to the same address, expressed in the the internal memory map.
+     *                          nullptr if the address was not copied, because it is in a hole or out of the mapped range.
+     */
+    HOST_PROCESS_PTR other_ptr_to_host(OTHER_PROCESS_PTR ptr) const;
+
+    /**
+     * @brief The copied runs of contiguous regions, sorted by address.
      */
-    inline HOST_PROCESS_PTR other_ptr_to_host(OTHER_PROCESS_PTR ptr) { return (HOST_PROCESS_PTR)&mapped_memory[(uint64_t)ptr - (uint64_t)map_base_address]; }
+    inline const std::vector<MAPPED_REGION>& mapped_regions() const { return regions; }
 
     /**
      * @brief Finds a pattern of bytes in the mapped memory and returns its original address in the external process memory.
@@ -118,115 +827,1664 @@ public:
      * @return OTHER_PROCESS_PTR A pointer to the first match of the pattern, in the address space of the external process.
      */
     OTHER_PROCESS_PTR find_pattern_in_memory(BYTE *pattern_ptr, size_t pattern_size, OTHER_PROCESS_PTR search_start_addr_in_process_space = nullptr);
-};
-
-#endif
 
-#ifdef KC_MEMUTILS_IMPLEMENTATION
+    /**
+     * @brief Finds a pattern with wildcards in the mapped memory and returns its original address in the external process memory.
+     *
+     * @param pattern The pattern to search for, a MASKED_PATTERN or a SIGNATURE.
+     * @param search_start_addr_in_process_space  (Optional) Used for starting the search from an offset.
+     * @return OTHER_PROCESS_PTR A pointer to the first match of the pattern, in the address space of the external process.
+     */
+    OTHER_PROCESS_PTR find_pattern_in_memory(const COMPILED_PATTERN& pattern, OTHER_PROCESS_PTR search_start_addr_in_process_space = nullptr);
+
+    /**
+     * @brief Finds a set of byte patterns in a single pass over the mapped memory.
+     *
+     * The matches of each target are reset, then filled in ascending address order up to the target's max_matches.
+     * The pass stops as soon as every target is resolved.
+     *
+     * @param targets The patterns to search for, receive their matches in the address space of the external process.
+     * @return true if every target was resolved.
+     */
+    bool find_patterns_in_memory(std::vector<PATTERN_SCAN_TARGET>& targets);
+};
+
+/**
+ * @brief Streaming scan settings of PROCESS_MEMORY_STREAM.
+ */
+struct STREAM_SCAN_CONFIG
+{
+    size_t buffer_budget = MB_TO_BYTES(4); // Peak memory of a scan: the chunk buffers plus the bytes carried over from one chunk to the next.
+    uint32_t buffer_count = 4; // Chunk buffers the budget is split into. With 2 or more, a reader thread fills the next buffers while the current one is scanned.
+                               // 1 reads and scans on the calling thread, one after the other.
+};
+
+/**
+ * @brief  PROCESS_MEMORY_STREAM
+ *
+ * Searches a range of the memory of another process without copying it whole, unlike PROCESS_MEMORY.
+ * The readable regions are read chunk by chunk into a single reusable buffer of STREAM_SCAN_CONFIG::buffer_budget bytes,
+ * so the memory used by a scan does not depend on the size of the range.
+ *
+ * The last (pattern size - 1) bytes of every chunk are carried over to the front of the buffer, so that matches
+ * across chunk edges are found. Unreadable regions and failed reads are holes: the carry is dropped there,
+ * and no match can span them. Matches are reported in the address space of the external process.
+ *
+ * The reads and the searches are pipelined: a reader thread fills the free chunk buffers with process_read while the
+ * calling thread searches the filled ones, in order. The buffers form a bounded queue, so the reader never gets more than
+ * buffer_count chunks ahead, and a scan takes about max(read time, search time) instead of their sum.
+ */
+class PROCESS_MEMORY_STREAM
+{
+    // DATA:
+private:
+    HANDLE process_handle;
+    OTHER_PROCESS_PTR range_base_address; // Start of the scanned range, in the address space of the other process.
+    SIZE_T range_num_bytes;
+    STREAM_SCAN_CONFIG config;
+    std::vector<uint8_t> buffer; // Chunk buffers followed by the carry. Allocated by the first scan and reused by the next ones.
+
+    // A piece of the range, as read by the CHUNK_READER.
+    struct STREAM_CHUNK
+    {
+        OTHER_PROCESS_PTR address;
+        size_t size;
+        bool is_read; // false for the holes: unreadable regions and failed reads.
+    };
+
+    // Walks the regions of [address, range_end) and reads them chunk by chunk.
+    struct CHUNK_READER
+    {
+        HANDLE process_handle;
+        OTHER_PROCESS_PTR address; // Start of the next chunk.
+        OTHER_PROCESS_PTR range_end;
+        size_t chunk_capacity;
+        std::vector<PROCESS_REGION> regions; // The regions of [address, range_end), listed on the first read.
+        size_t region_index = 0; // The region address is in.
+        bool are_regions_listed = false;
+
+        // Reads the next chunk into destination, which holds chunk_capacity bytes. Returns false at the end of the range.
+        bool read_next(STREAM_CHUNK& chunk, uint8_t *destination);
+    };
+
+    // Called for every chunk read. data starts with the bytes carried over from the previous chunk. Matches starting at or after
+    // report_end are left to the next chunk, which starts with those bytes. Returns true to stop the scan.
+    typedef std::function<bool(const uint8_t *data, size_t data_size, OTHER_PROCESS_PTR data_address, size_t report_end)> CHUNK_CALLBACK;
+
+    // Reads [scan_begin, scan_end) chunk by chunk, consecutive chunks overlapping by overlap bytes. Up to overlap bytes past scan_end
+    // are read to complete the matches, but report_end always stops the matches at scan_end.
+    void for_each_chunk(OTHER_PROCESS_PTR scan_begin, OTHER_PROCESS_PTR scan_end, size_t overlap, const CHUNK_CALLBACK& on_chunk);
+
+    // Shared implementation of the find_pattern_in_memory overloads.
+    OTHER_PROCESS_PTR find_compiled_pattern_in_memory(const COMPILED_PATTERN& pattern, OTHER_PROCESS_PTR search_start_addr_in_process_space);
+
+    // METHODS:
+public:
+    /**
+     * @brief Construct PROCESS_MEMORY_STREAM. Nothing is read until the first scan.
+     *
+     * @param process_handle handle to the process, needs PROCESS_QUERY_INFORMATION and PROCESS_VM_READ access
+     * @param base_address base address in the address space of the external process to start the scans from
+     * @param num_bytes number of bytes to scan
+     * @param config (Optional) buffer budget of the scans
+     */
+    PROCESS_MEMORY_STREAM(HANDLE process_handle, OTHER_PROCESS_PTR base_address, SIZE_T num_bytes, const STREAM_SCAN_CONFIG& config = STREAM_SCAN_CONFIG());
+
+    /**
+     * @brief Finds a pattern of bytes in the range and returns its address in the external process memory.
+     *
+     * @param pattern_ptr Pointer to the beginning of the byte pattern to search for.
+     * @param pattern_size Size of the byte pattern in bytes. Must be smaller than the buffer budget.
+     * @param search_start_addr_in_process_space  (Optional) Used for starting the search from an address within the range.
+     * @return OTHER_PROCESS_PTR A pointer to the first match of the pattern, nullptr if there is none.
+     */
+    OTHER_PROCESS_PTR find_pattern_in_memory(BYTE *pattern_ptr, size_t pattern_size, OTHER_PROCESS_PTR search_start_addr_in_process_space = nullptr);
+
+    /**
+     * @brief Finds a pattern with wildcards, a MASKED_PATTERN or a SIGNATURE, in the range and returns its address in the external process memory.
+     */
+    OTHER_PROCESS_PTR find_pattern_in_memory(const COMPILED_PATTERN& pattern, OTHER_PROCESS_PTR search_start_addr_in_process_space = nullptr);
+
+    /**
+     * @brief Finds a set of byte patterns in a single pass over the range. Same results as PROCESS_MEMORY::find_patterns_in_memory.
+     *
+     * @param targets The patterns to search for, receive their matches in the address space of the external process.
+     * @return true if every target was resolved.
+     */
+    bool find_patterns_in_memory(std::vector<PATTERN_SCAN_TARGET>& targets);
+
+    /**
+     * @brief Finds a set of byte patterns, starting around the addresses where they were found before.
+     *
+     * The neighbourhoods of the hints are scanned first, and widened fourfold every round until every target is resolved.
+     * The last round scans what is left of the range, so a target that moved far away is still found.
+     * Each byte of the range is scanned once at most.
+     *
+     * Unlike find_patterns_in_memory, the matches of a target are the first max_matches found, closest to the hints first,
+     * rather than the lowest ones. They are returned in ascending address order.
+     *
+     * @param targets The patterns to search for, receive their matches in the address space of the external process.
+     * @param hints Addresses where the targets were found before, e.g. in a previous session. Scans the whole range if empty.
+     * @param first_probe_radius (Optional) Number of bytes scanned on each side of the hints in the first round.
+     * @return true if every target was resolved.
+     */
+    bool find_patterns_near(std::vector<PATTERN_SCAN_TARGET>& targets, const std::vector<OTHER_PROCESS_PTR>& hints, size_t first_probe_radius = MB_TO_BYTES(1));
+};
+
+/**
+ * @brief  REMOTE_GATHER
+ *
+ * Reads a fixed set of small values of another process into a local struct, with as few system calls as possible.
+ *
+ * The values are registered once, with the offset of their field in the destination struct. They are then sorted by address,
+ * and the values that are at most max_gap bytes apart within the same region are coalesced into spans. A read is one batch
+ * of reads, one per span, followed by a copy of every value into its field: a single process_vm_readv call on Linux, one
+ * ReadProcessMemory call per span on Windows. Reading the bytes between two values
+ * is cheaper than a system call, and staying within a region guarantees that a span is readable if its values are.
+ *
+ * @code
+ *   REMOTE_GATHER gather(process_handle);
+ *   gather.add(max_hp_ptr, offsetof(PLAYER_STATE, max_hp), sizeof(uint32_t));
+ *   gather.add(cur_hp_ptr, offsetof(PLAYER_STATE, cur_hp), sizeof(uint32_t));
+ *   PLAYER_STATE state;
+ *   gather.read(&state);
+ * @endcode
+ */
+class REMOTE_GATHER
+{
+private:
+    struct GATHER_VALUE
+    {
+        OTHER_PROCESS_PTR address;
+        size_t size;
+        size_t destination_offset; // Offset of the value in the destination struct.
+        size_t span_index; // SIZE_MAX if the value has no address.
+    };
+
+    struct GATHER_SPAN
+    {
+        OTHER_PROCESS_PTR address;
+        size_t size;
+        OTHER_PROCESS_PTR region_end; // End of the region the span is in, the span may not grow past it.
+        size_t buffer_offset; // Offset of the span in the read buffer.
+    };
+
+    HANDLE process_handle = nullptr;
+    size_t max_gap = KB_TO_BYTES(4);
+    std::vector<GATHER_VALUE> values;
+    std::vector<GATHER_SPAN> spans;
+    std::vector<uint8_t> buffer; // The spans, one after the other.
+    std::vector<PROCESS_READ> span_reads; // One read per span, into its place in the buffer.
+    bool is_built = false;
+
+    // Sorts the values and coalesces them into spans. Queries the regions of the values in one batch.
+    void build();
+
+public:
+    REMOTE_GATHER() = default;
+
+    /**
+     * @param process_handle handle to the process, needs PROCESS_QUERY_INFORMATION and PROCESS_VM_READ access
+     * @param max_gap (Optional) Largest number of unused bytes read between two values of a span.
+     */
+    explicit REMOTE_GATHER(HANDLE process_handle, size_t max_gap = KB_TO_BYTES(4)) : process_handle(process_handle), max_gap(max_gap) {}
+
+    /**
+     * @brief Registers a value to read.
+     *
+     * @param address Address of the value in the address space of the external process. A null address reads as zero.
+     * @param destination_offset Offset of the field that receives the value in the destination struct.
+     * @param size Size of the value in bytes.
+     */
+    void add(OTHER_PROCESS_PTR address, size_t destination_offset, size_t size);
+
+    /**
+     * @brief Reads every registered value into its field of destination, one batch of span reads.
+     *
+     * @param destination The struct that receives the values.
+     * @return true if every value was read. The values that could not be read are set to zero.
+     */
+    bool read(void *destination);
+
+    /**
+     * @brief Number of span reads a read makes.
+     */
+    size_t span_count();
+};
+
+#endif
+
+#ifdef KC_MEMUTILS_IMPLEMENTATION
 #pragma once 
-    void* memmem(const void *haystack, size_t hs_len, const void *needle, size_t ne_len)
+    bool memmem_masked_equal(const uint8_t *data, const uint8_t *value, const uint8_t *mask, size_t size)
     {
-    const char* hs = (char*) haystack;
-    const char* ne = (char*) needle;
+        if (!mask) return memcmp(data, value, size) == 0;
 
-    if (ne_len == 0)
-        return (void *)hs;
-    int i;
-    int c = ne[0];
-    const char *end = hs + hs_len - ne_len;
+        size_t i = 0;
+#ifdef __SSE2__
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i difference = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(data + i)), _mm_loadu_si128((const __m128i*)(value + i)));
+            const __m128i masked_difference = _mm_and_si128(difference, _mm_loadu_si128((const __m128i*)(mask + i)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(masked_difference, _mm_setzero_si128())) != 0xFFFF) return false;
+        }
+#endif
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t data_word, value_word, mask_word;
+            memcpy(&data_word, data + i, 8);
+            memcpy(&value_word, value + i, 8);
+            memcpy(&mask_word, mask + i, 8);
+            if ((data_word ^ value_word) & mask_word) return false;
+        }
+        for (; i < size; i++)
+        {
+            if ((data[i] ^ value[i]) & mask[i]) return false;
+        }
+        return true;
+    }
 
-    for ( ; hs <= end; hs++)
+    // Number of positions after a candidate that can't match either, from the byte under the end of the needle.
+    static inline size_t memmem_skip(const uint8_t *candidate, const COMPILED_PATTERN& ne)
     {
-        if (hs[0] != c)
-        continue;
-        for (i = ne_len - 1; i != 0; i--)
-        if (hs[i] != ne[i])
-        break;
-        if (i == 0)
-        return (void *)hs;
+        return ne.shifts ? ne.shifts[candidate[ne.size - 1]] : 1;
     }
 
-    return NULL;
+    // Verifies the candidate positions of a movemask bit set. Returns the first full match or NULL.
+    static inline const uint8_t* memmem_verify_candidates(uint32_t candidates, const uint8_t *position, const COMPILED_PATTERN& ne)
+    {
+        while (candidates)
+        {
+            const size_t offset = __builtin_ctz(candidates);
+            const uint8_t *candidate = position + offset;
+            if (memmem_masked_equal(candidate, ne.value, ne.mask, ne.size)) return candidate;
+
+            const size_t next_offset = offset + memmem_skip(candidate, ne);
+            candidates = next_offset >= 32 ? 0 : candidates & (UINT32_MAX << next_offset);
+        }
+        return NULL;
     }
 
-    PROCESS_MEMORY::PROCESS_MEMORY(HANDLE process_handle, OTHER_PROCESS_PTR base_address, SIZE_T num_bytes)
+    // Scalar engine. Also used for the tails the vector engines cannot cover with a full load.
+    // Searches positions [pos, last] of the haystack.
+    static const uint8_t* memmem_scalar(const uint8_t *hs, size_t pos, size_t last, const COMPILED_PATTERN& ne)
     {
-        this->map_num_bytes = num_bytes;
-        //assert(process_handle != nullptr); //TODO: SHA, whoever uses this constructor must open the process themselves.
+        const MEMMEM_ANCHOR anchor = ne.anchor;
+        const uint8_t rare1 = ne.value[anchor.rare1_offset];
+        const uint8_t rare2 = ne.value[anchor.rare2_offset];
 
-        // Remark: This is also guaranteed to initialize the whole memory to 0.
-        // memset(mapped_memory, 0, bytes_to_map) is implied.
-        this->mapped_memory = (HOST_PROCESS_PTR) VirtualAlloc(NULL, map_num_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        while (pos <= last)
+        {
+            // memchr is already vectorized by the C library, so let it find the next rare byte.
+            const uint8_t *hit = (const uint8_t*) memchr(hs + pos + anchor.rare1_offset, rare1, last - pos + 1);
+            if (!hit) return NULL;
+
+            pos = (size_t)(hit - hs) - anchor.rare1_offset;
+            if (hs[pos + anchor.rare2_offset] == rare2 && memmem_masked_equal(hs + pos, ne.value, ne.mask, ne.size)) return hs + pos;
+            pos += memmem_skip(hs + pos, ne);
+        }
+        return NULL;
+    }
 
-        MEMORY_BASIC_INFORMATION first_region_info;
-        auto accessed_memory_region = VirtualQueryEx(process_handle, base_address, &first_region_info, sizeof(first_region_info));
-        this->map_base_address = (OTHER_PROCESS_PTR)first_region_info.BaseAddress;
+#if defined(KC_MEMUTILS_X86) && defined(__GNUC__)
+    #define KC_MEMUTILS_SIMD 1
 
-        // Iterate over the memory regions
-        uint64_t current_byte_offset = 0;
-        OTHER_PROCESS_PTR address = base_address;
+    // The vector engines first look for rare1 alone, with aligned loads over 128 bytes per step.
+    // Only a step where rare1 shows up is filtered again on rare2, 16 or 32 positions at a time, before the candidates are verified.
+    // Returns the number of positions before the rare1 byte of a position is aligned to alignment, and searches them.
+    static inline size_t memmem_align_head(const uint8_t *hs, size_t last, const COMPILED_PATTERN& ne, size_t alignment, const uint8_t *&match)
+    {
+        const size_t head = (alignment - (((uintptr_t) hs + ne.anchor.rare1_offset) & (alignment - 1))) & (alignment - 1);
+        match = head ? memmem_scalar(hs, 0, std::min(head - 1, last), ne) : NULL;
+        return head;
+    }
+
+    __attribute__((target("sse2")))
+    static const uint8_t* memmem_sse2(const uint8_t *hs, size_t last, const COMPILED_PATTERN& ne)
+    {
+        const MEMMEM_ANCHOR anchor = ne.anchor;
+        const __m128i rare1 = _mm_set1_epi8((char) ne.value[anchor.rare1_offset]);
+        const __m128i rare2 = _mm_set1_epi8((char) ne.value[anchor.rare2_offset]);
 
-        // The idea is to simply iterate over the memory regions, copy them using ReadProcessMemory if we have access to them.
-        // And skip them if they are guarded.
-        bool reached_the_end = false;
-        while (!reached_the_end) {
-            MEMORY_BASIC_INFORMATION region_info;
-            auto accessed_memory_region = VirtualQueryEx(process_handle, address, &region_info, sizeof(region_info));
-            if (!accessed_memory_region) {break;} //TODO: SHA, throw exception or assert.
+        const uint8_t *match;
+        size_t pos = memmem_align_head(hs, last, ne, 16, match);
+        if (match) return match;
 
-            uint64_t bytes_to_read_from_this_segment;
-            if (current_byte_offset + region_info.RegionSize >= map_num_bytes)
+        // The loads at pos + rare_offset stay within the haystack as long as pos + 127 <= last.
+        for (; pos + 127 <= last; pos += 128)
+        {
+            // Written out rather than looped over an array, which the compiler keeps on the stack.
+            const uint8_t *rare1_bytes = hs + pos + anchor.rare1_offset;
+            const __m128i hits0 = _mm_or_si128(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(rare1_bytes)), rare1),
+                                               _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(rare1_bytes + 16)), rare1));
+            const __m128i hits1 = _mm_or_si128(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(rare1_bytes + 32)), rare1),
+                                               _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(rare1_bytes + 48)), rare1));
+            const __m128i hits2 = _mm_or_si128(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(rare1_bytes + 64)), rare1),
+                                               _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(rare1_bytes + 80)), rare1));
+            const __m128i hits3 = _mm_or_si128(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(rare1_bytes + 96)), rare1),
+                                               _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(rare1_bytes + 112)), rare1));
+            if (!_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(hits0, hits1), _mm_or_si128(hits2, hits3)))) continue;
+
+            for (size_t block = pos; block < pos + 128; block += 16)
             {
-                reached_the_end = true;
-                bytes_to_read_from_this_segment = map_num_bytes - current_byte_offset; 
+                const __m128i block1 = _mm_load_si128((const __m128i*)(hs + block + anchor.rare1_offset));
+                const __m128i block2 = _mm_loadu_si128((const __m128i*)(hs + block + anchor.rare2_offset));
+                const uint32_t candidates = (uint32_t) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block1, rare1), _mm_cmpeq_epi8(block2, rare2)));
+                if (candidates && (match = memmem_verify_candidates(candidates, hs + block, ne))) return match;
             }
-            else
+        }
+
+        return pos <= last ? memmem_scalar(hs, pos, last, ne) : NULL;
+    }
+
+    __attribute__((target("avx2")))
+    static const uint8_t* memmem_avx2(const uint8_t *hs, size_t last, const COMPILED_PATTERN& ne)
+    {
+        const MEMMEM_ANCHOR anchor = ne.anchor;
+        const __m256i rare1 = _mm256_set1_epi8((char) ne.value[anchor.rare1_offset]);
+        const __m256i rare2 = _mm256_set1_epi8((char) ne.value[anchor.rare2_offset]);
+
+        const uint8_t *match;
+        size_t pos = memmem_align_head(hs, last, ne, 32, match);
+        if (match) return match;
+
+        for (; pos + 127 <= last; pos += 128)
+        {
+            const uint8_t *rare1_bytes = hs + pos + anchor.rare1_offset;
+            const __m256i hits0 = _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)(rare1_bytes)), rare1);
+            const __m256i hits1 = _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)(rare1_bytes + 32)), rare1);
+            const __m256i hits2 = _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)(rare1_bytes + 64)), rare1);
+            const __m256i hits3 = _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)(rare1_bytes + 96)), rare1);
+            const __m256i any_hit = _mm256_or_si256(_mm256_or_si256(hits0, hits1), _mm256_or_si256(hits2, hits3));
+            if (_mm256_testz_si256(any_hit, any_hit)) continue;
+
+            for (size_t block = pos; block < pos + 128; block += 32)
             {
-                bytes_to_read_from_this_segment = region_info.RegionSize;
+                const __m256i block1 = _mm256_load_si256((const __m256i*)(hs + block + anchor.rare1_offset));
+                const __m256i block2 = _mm256_loadu_si256((const __m256i*)(hs + block + anchor.rare2_offset));
+                const uint32_t candidates = (uint32_t) _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block1, rare1), _mm256_cmpeq_epi8(block2, rare2)));
+                if (candidates && (match = memmem_verify_candidates(candidates, hs + block, ne))) return match;
             }
+        }
+
+        return pos <= last ? memmem_scalar(hs, pos, last, ne) : NULL;
+    }
+#endif
+
+    static bool memmem_cpu_supports(MEMMEM_ENGINE engine)
+    {
+#ifdef KC_MEMUTILS_SIMD
+        switch (engine)
+        {
+            case MEMMEM_ENGINE::AVX2: return __builtin_cpu_supports("avx2");
+            case MEMMEM_ENGINE::SSE2: return __builtin_cpu_supports("sse2");
+            default: return true;
+        }
+#else
+        return engine == MEMMEM_ENGINE::SCALAR;
+#endif
+    }
+
+    // Times every engine the CPU supports on one chunk of the stream (1 MB) where the needle is never found, and returns the fastest.
+    // The vector engines only compete with the memchr of the C library, which may itself use wider vectors than they do, so
+    // neither of them wins on every CPU.
+    static MEMMEM_ENGINE memmem_measure_engines()
+    {
+        const uint8_t needle[] = {0xFE, 0xC3, 0x9A, 0xB1, 0xE7, 0xAF, 0xD4, 0x8C};
+        std::vector<uint8_t> haystack(MB_TO_BYTES(1));
+        for (size_t i = 0; i < haystack.size(); i++) haystack[i] = (uint8_t)(i * 7 % 0x80); // No byte of the needle.
 
-            const bool can_read_region = region_info.Protect != PAGE_NOACCESS &&
-                                   region_info.Protect != PAGE_EXECUTE_WRITECOPY &&
-                                   region_info.Protect != PAGE_EXECUTE &&
-                                   region_info.Protect != PAGE_WRITECOPY &&
-                                   region_info.Protect != PAGE_TARGETS_INVALID;
+        MEMMEM_ENGINE fastest = MEMMEM_ENGINE::SCALAR;
+        double fastest_ns = 0.0;
+        for (MEMMEM_ENGINE engine : {MEMMEM_ENGINE::SCALAR, MEMMEM_ENGINE::SSE2, MEMMEM_ENGINE::AVX2})
+        {
+            if (!memmem_cpu_supports(engine)) continue;
 
-            if(can_read_region)
+            // Best of a few runs, the first one also warms the haystack up.
+            double best_ns = 0.0;
+            for (int run = 0; run < 16; run++)
             {
-                bool succeed = ReadProcessMemory(process_handle,region_info.BaseAddress, &mapped_memory[current_byte_offset], bytes_to_read_from_this_segment, NULL);
+                const auto start = std::chrono::steady_clock::now();
+                void *volatile result = memmem_with_engine(engine, haystack.data(), haystack.size(), needle, sizeof(needle));
+                (void) result;
+                const double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                if (run == 0 || elapsed_ns < best_ns) best_ns = elapsed_ns;
             }
 
-            current_byte_offset += bytes_to_read_from_this_segment;
-            address = (OTHER_PROCESS_PTR) region_info.BaseAddress + region_info.RegionSize;
+            if (engine == MEMMEM_ENGINE::SCALAR || best_ns < fastest_ns)
+            {
+                fastest = engine;
+                fastest_ns = best_ns;
+            }
         }
+        return fastest;
     }
-    PROCESS_MEMORY::~PROCESS_MEMORY()
+
+    MEMMEM_ENGINE memmem_active_engine()
     {
-        if(this->mapped_memory) VirtualFree(this->mapped_memory, 0, MEM_RELEASE);
+        // Measured once, the CPU does not change under us.
+        static const MEMMEM_ENGINE engine = memmem_measure_engines();
+        return engine;
     }
 
-    OTHER_PROCESS_PTR PROCESS_MEMORY::find_pattern_in_memory(BYTE* pattern_ptr, size_t pattern_size, OTHER_PROCESS_PTR search_start_addr_in_process_space)
+    void* memmem_compiled_with_engine(MEMMEM_ENGINE engine, const void *haystack, size_t hs_len, const COMPILED_PATTERN& needle)
     {
-        // TODO: Do something if this function fails to find. 
-        HOST_PROCESS_PTR search_start_address_in_map;
-        SIZE_T search_size;
+        const uint8_t* hs = (const uint8_t*) haystack;
+
+        if (needle.size > hs_len)
+            return NULL;
+        if (needle.size == 0 || (needle.mask && memchr(needle.mask, 0xFF, needle.size) == NULL))
+            return (void *)hs; // Nothing to compare, the first position matches.
+
+        const size_t last = hs_len - needle.size; // Last position at which the needle still fits.
+
+        if (engine == MEMMEM_ENGINE::AVX2 && !memmem_cpu_supports(MEMMEM_ENGINE::AVX2)) engine = MEMMEM_ENGINE::SSE2;
+        if (engine == MEMMEM_ENGINE::SSE2 && !memmem_cpu_supports(MEMMEM_ENGINE::SSE2)) engine = MEMMEM_ENGINE::SCALAR;
+
+        switch (engine)
+        {
+#ifdef KC_MEMUTILS_SIMD
+            case MEMMEM_ENGINE::AVX2: return (void *) memmem_avx2(hs, last, needle);
+            case MEMMEM_ENGINE::SSE2: return (void *) memmem_sse2(hs, last, needle);
+#endif
+            default: return (void *) memmem_scalar(hs, 0, last, needle);
+        }
+    }
+
+    void* memmem_masked_with_engine(MEMMEM_ENGINE engine, const void *haystack, size_t hs_len, const void *needle, const void *needle_mask, size_t ne_len)
+    {
+        const uint8_t* ne = (const uint8_t*) needle;
+        const uint8_t* ne_mask = (const uint8_t*) needle_mask;
+        return memmem_compiled_with_engine(engine, haystack, hs_len, {ne, ne_mask, ne_len, memmem_find_anchor(ne, ne_len, ne_mask), SIZE_MAX, nullptr});
+    }
+
+    void* memmem_with_engine(MEMMEM_ENGINE engine, const void *haystack, size_t hs_len, const void *needle, size_t ne_len)
+    {
+        return memmem_masked_with_engine(engine, haystack, hs_len, needle, NULL, ne_len);
+    }
+
+    void* memmem(const void *haystack, size_t hs_len, const void *needle, size_t ne_len)
+    {
+        return memmem_with_engine(memmem_active_engine(), haystack, hs_len, needle, ne_len);
+    }
+
+    void* memmem_masked(const void *haystack, size_t hs_len, const void *needle, const void *needle_mask, size_t ne_len)
+    {
+        return memmem_masked_with_engine(memmem_active_engine(), haystack, hs_len, needle, needle_mask, ne_len);
+    }
+
+    void* memmem_compiled(const void *haystack, size_t hs_len, const COMPILED_PATTERN& needle)
+    {
+        return memmem_compiled_with_engine(memmem_active_engine(), haystack, hs_len, needle);
+    }
+
+    // Computes the maximal suffix of the needle for the Two-Way algorithm, under the normal or reversed byte order.
+    // Returns the position right before the suffix (-1 for the whole needle) and its period in 'period'.
+    static int64_t memmem_two_way_max_suffix(const uint8_t *ne, int64_t ne_len, int64_t *period, bool reversed)
+    {
+        int64_t max_suffix = -1;
+        int64_t j = 0;
+        int64_t k = 1;
+        *period = 1;
+
+        while (j + k < ne_len)
+        {
+            const uint8_t a = ne[j + k];
+            const uint8_t b = ne[max_suffix + k];
+            if (reversed ? a > b : a < b)
+            {
+                j += k;
+                k = 1;
+                *period = j - max_suffix;
+            }
+            else if (a == b)
+            {
+                if (k != *period) k++;
+                else { j += *period; k = 1; }
+            }
+            else
+            {
+                max_suffix = j++;
+                k = *period = 1;
+            }
+        }
+        return max_suffix;
+    }
 
-        if(search_start_addr_in_process_space)
+    void* memmem_two_way(const void *haystack, size_t hs_len, const void *needle, size_t ne_len)
+    {
+        const uint8_t* hs = (const uint8_t*) haystack;
+        const uint8_t* ne = (const uint8_t*) needle;
+
+        if (ne_len == 0)
+            return (void *)hs;
+        if (ne_len > hs_len)
+            return NULL;
+
+        const int64_t m = (int64_t) ne_len;
+        const int64_t n = (int64_t) hs_len;
+
+        // Critical factorization of the needle.
+        int64_t period, period_reversed;
+        const int64_t suffix = memmem_two_way_max_suffix(ne, m, &period, false);
+        const int64_t suffix_reversed = memmem_two_way_max_suffix(ne, m, &period_reversed, true);
+        const int64_t ell = suffix > suffix_reversed ? suffix : suffix_reversed;
+        if (suffix <= suffix_reversed) period = period_reversed;
+
+        if (memcmp(ne, ne + period, (size_t)(ell + 1)) == 0)
         {
-            uint64_t start_offset = (uint64_t) search_start_addr_in_process_space - (uint64_t) this->map_base_address;
-            search_start_address_in_map = &(this->mapped_memory[start_offset]);
-            search_size = map_num_bytes - start_offset;
+            // The needle is periodic, remember how much of the left part is known to match after a shift.
+            int64_t memory = -1;
+            int64_t j = 0;
+            while (j <= n - m)
+            {
+                int64_t i = (ell > memory ? ell : memory) + 1;
+                while (i < m && ne[i] == hs[i + j]) i++;
+                if (i >= m)
+                {
+                    i = ell;
+                    while (i > memory && ne[i] == hs[i + j]) i--;
+                    if (i <= memory) return (void *)(hs + j);
+                    j += period;
+                    memory = m - period - 1;
+                }
+                else
+                {
+                    j += i - ell;
+                    memory = -1;
+                }
+            }
         }
         else
         {
-            search_start_address_in_map = this->mapped_memory;
-            search_size = map_num_bytes;
+            const int64_t shift = (ell + 1 > m - ell - 1 ? ell + 1 : m - ell - 1) + 1;
+            int64_t j = 0;
+            while (j <= n - m)
+            {
+                int64_t i = ell + 1;
+                while (i < m && ne[i] == hs[i + j]) i++;
+                if (i >= m)
+                {
+                    i = ell;
+                    while (i >= 0 && ne[i] == hs[i + j]) i--;
+                    if (i < 0) return (void *)(hs + j);
+                    j += shift;
+                }
+                else
+                {
+                    j += i - ell;
+                }
+            }
+        }
+        return NULL;
+    }
+
+    bool memmem_self_test(uint32_t iterations, uint32_t seed)
+    {
+        uint32_t state = seed ? seed : 1;
+        auto next_random = [&state]() { state ^= state << 13; state ^= state >> 17; state ^= state << 5; return state; };
+
+        const MEMMEM_ENGINE engines[] = {MEMMEM_ENGINE::SCALAR, MEMMEM_ENGINE::SSE2, MEMMEM_ENGINE::AVX2};
+        uint8_t haystack[512];
+        uint8_t needle[64];
+        uint8_t needle_mask[64];
+
+        for (uint32_t iteration = 0; iteration < iterations; iteration++)
+        {
+            // A 1 to 4 letter alphabet out of the bytes our patterns are made of, so that near-matches are common.
+            const uint8_t letters[] = {0x00, 0x73, 0x53, 0x3F, 0x6E, 0xFF};
+            const uint32_t alphabet_size = 1 + next_random() % 4;
+            const size_t hs_len = next_random() % sizeof(haystack);
+            const size_t ne_len = next_random() % sizeof(needle);
+
+            for (size_t i = 0; i < hs_len; i++) haystack[i] = letters[next_random() % alphabet_size];
+            for (size_t i = 0; i < ne_len; i++) needle[i] = letters[next_random() % alphabet_size];
+
+            // Half of the time, plant the needle somewhere in the haystack, including the very end.
+            if (ne_len <= hs_len && next_random() % 2)
+            {
+                const size_t at = next_random() % (hs_len - ne_len + 1);
+                memcpy(haystack + at, needle, ne_len);
+            }
+
+            const void *expected = memmem_two_way(haystack, hs_len, needle, ne_len);
+            for (MEMMEM_ENGINE engine : engines)
+            {
+                if (memmem_with_engine(engine, haystack, hs_len, needle, ne_len) != expected) return false;
+            }
+
+            // Masked search, with about a quarter of wildcards. Two-Way has no notion of wildcards,
+            // so the reference is the plain position by position comparison.
+            for (size_t i = 0; i < ne_len; i++) needle_mask[i] = next_random() % 4 ? 0xFF : 0x00;
+
+            const void *expected_masked = NULL;
+            for (size_t position = 0; position + ne_len <= hs_len; position++)
+            {
+                size_t i = 0;
+                while (i < ne_len && ((haystack[position + i] ^ needle[i]) & needle_mask[i]) == 0) i++;
+                if (i == ne_len)
+                {
+                    expected_masked = haystack + position;
+                    break;
+                }
+            }
+            // Same search, skipping ahead by the shift table of the compiled needle.
+            MASKED_PATTERN compiled_needle;
+            compiled_needle.value.assign(needle, needle + ne_len);
+            compiled_needle.mask.assign(needle_mask, needle_mask + ne_len);
+            compiled_needle.compile();
+
+            for (MEMMEM_ENGINE engine : engines)
+            {
+                if (memmem_masked_with_engine(engine, haystack, hs_len, needle, needle_mask, ne_len) != expected_masked) return false;
+                if (memmem_compiled_with_engine(engine, haystack, hs_len, compiled_needle) != expected_masked) return false;
+            }
+        }
+        return true;
+    }
+
+    MASKED_PATTERN::MASKED_PATTERN(const char *ida_signature)
+    {
+        const bool is_well_formed = parse(ida_signature, *this);
+        assert(is_well_formed);
+    }
+
+    bool MASKED_PATTERN::parse(const char *ida_signature, MASKED_PATTERN& pattern)
+    {
+        pattern.value.clear();
+        pattern.mask.clear();
+
+        auto hex_digit = [](char c) -> int
+        {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        };
+
+        const char *c = ida_signature;
+        while (*c)
+        {
+            if (*c == ' ') { c++; continue; }
+
+            if (c[0] == '?')
+            {
+                c += c[1] == '?' ? 2 : 1;
+                pattern.value.push_back(0x00);
+                pattern.mask.push_back(0x00);
+            }
+            else
+            {
+                const int high = hex_digit(c[0]);
+                const int low = high < 0 ? -1 : hex_digit(c[1]);
+                if (low < 0) break;
+
+                c += 2;
+                pattern.value.push_back((BYTE)(high << 4 | low));
+                pattern.mask.push_back(0xFF);
+            }
+
+            // Every byte must be followed by a separator or the end of the signature.
+            if (*c && *c != ' ') break;
+        }
+
+        if (*c || pattern.value.empty())
+        {
+            pattern = MASKED_PATTERN();
+            return false;
+        }
+
+        pattern.compile();
+        return true;
+    }
+
+    PROCESS_MEMORY::PROCESS_MEMORY(HANDLE process_handle, OTHER_PROCESS_PTR base_address, SIZE_T num_bytes, bool private_regions_only)
+    {
+        //assert(process_handle != nullptr); //TODO: SHA, whoever uses this constructor must open the process themselves.
+        this->map_base_address = base_address;
+        const OTHER_PROCESS_PTR map_end_address = base_address + num_bytes;
+
+        // First pass: list the regions worth copying, clipped to the mapped range, to know how much memory they need.
+        std::vector<MAPPED_REGION> candidate_regions;
+        SIZE_T candidate_num_bytes = 0;
+        for (const PROCESS_REGION& region : process_list_regions(process_handle, base_address, map_end_address))
+        {
+            const bool is_wanted_type = !private_regions_only || region.is_private;
+            if (region.is_readable && is_wanted_type)
+            {
+                candidate_regions.push_back({region.base_address, region.size, 0});
+                candidate_num_bytes += region.size;
+            }
+        }
+        if (candidate_num_bytes == 0) return;
+
+        // Remark: This is also guaranteed to initialize the whole memory to 0.
+        // memset(mapped_memory, 0, bytes_to_map) is implied.
+        this->mapped_memory = host_allocate_zeroed(candidate_num_bytes);
+        if (!this->mapped_memory) return;
+        this->map_capacity = candidate_num_bytes;
+
+        // Second pass: copy them one after the other. Regions that fail to read are left out of the table,
+        // and regions that follow each other in the other process are merged into a single run.
+        for (const MAPPED_REGION& candidate : candidate_regions)
+        {
+            if (!process_read(process_handle, candidate.base_address, &mapped_memory[map_num_bytes], candidate.size)) continue;
+
+            append_run(regions, candidate.base_address, candidate.size, map_num_bytes);
+            map_num_bytes += candidate.size;
+        }
+    }
+
+    PROCESS_MEMORY::PROCESS_MEMORY(const char *dump_path)
+    {
+        HOST_PROCESS_PTR view = host_map_file(dump_path, this->dump_view_size);
+        if (!view) return;
+        this->dump_view = view;
+
+        // The header and the table are checked against the size of the file, so that a truncated dump can't be read past its end.
+        DUMP_HEADER header;
+        if (this->dump_view_size < sizeof(header)) return;
+        memcpy(&header, view, sizeof(header));
+
+        const bool is_valid = header.magic == dump_magic && header.version == dump_version &&
+                              header.data_offset <= this->dump_view_size && header.map_num_bytes <= this->dump_view_size - header.data_offset &&
+                              header.table_offset <= this->dump_view_size && header.region_count <= (this->dump_view_size - header.table_offset) / sizeof(DUMP_REGION);
+        if (!is_valid) return;
+
+        std::vector<MAPPED_REGION> dump_regions;
+        for (uint64_t i = 0; i < header.region_count; i++)
+        {
+            DUMP_REGION region;
+            memcpy(&region, view + header.table_offset + i * sizeof(DUMP_REGION), sizeof(region));
+
+            // The runs must be packed in address order, as the translations and the shards expect.
+            const size_t expected_map_offset = dump_regions.empty() ? 0 : dump_regions.back().map_offset + dump_regions.back().size;
+            const bool is_ordered = dump_regions.empty() || (uint64_t)(uintptr_t)(dump_regions.back().base_address + dump_regions.back().size) <= region.base_address;
+            if (region.map_offset != expected_map_offset || region.size > header.map_num_bytes - region.map_offset || !is_ordered) return;
+
+            dump_regions.push_back({(OTHER_PROCESS_PTR)(uintptr_t) region.base_address, (SIZE_T) region.size, (size_t) region.map_offset});
         }
+        if (!dump_regions.empty() && dump_regions.back().map_offset + dump_regions.back().size != header.map_num_bytes) return;
+
+        this->mapped_memory = view + header.data_offset;
+        this->map_base_address = (OTHER_PROCESS_PTR)(uintptr_t) header.map_base_address;
+        this->map_num_bytes = (SIZE_T) header.map_num_bytes;
+        this->regions = std::move(dump_regions);
+    }
 
-        const HOST_PROCESS_PTR result = (HOST_PROCESS_PTR) memmem((void*) search_start_address_in_map, search_size, pattern_ptr, pattern_size);
+    PROCESS_MEMORY::~PROCESS_MEMORY()
+    {
+        if(this->dump_view) host_unmap_file(this->dump_view, this->dump_view_size);
+        else if(this->mapped_memory) host_free(this->mapped_memory, this->map_capacity);
+    }
 
-        uint64_t offset = (uint64_t) result -  (uint64_t) this->mapped_memory;
-        return host_ptr_to_other(result);
+    void PROCESS_MEMORY::append_run(std::vector<MAPPED_REGION>& regions, OTHER_PROCESS_PTR base_address, SIZE_T size, size_t map_offset)
+    {
+        const bool follows_previous_run = !regions.empty() &&
+                                          regions.back().base_address + regions.back().size == base_address &&
+                                          regions.back().map_offset + regions.back().size == map_offset;
+        if (follows_previous_run) regions.back().size += size;
+        else regions.push_back({base_address, size, map_offset});
     }
 
-#endif
\ No newline at end of file
+    bool PROCESS_MEMORY::finish_dump(std::ofstream& file, OTHER_PROCESS_PTR map_base_address, SIZE_T map_num_bytes, const std::vector<MAPPED_REGION>& regions)
+    {
+        for (const MAPPED_REGION& region : regions)
+        {
+            const DUMP_REGION dump_region = {(uint64_t)(uintptr_t) region.base_address, (uint64_t) region.size, (uint64_t) region.map_offset};
+            file.write((const char *) &dump_region, sizeof(dump_region));
+        }
+
+        const DUMP_HEADER header = {dump_magic, dump_version, (uint64_t) regions.size(), (uint64_t)(uintptr_t) map_base_address,
+                                    (uint64_t) map_num_bytes, dump_data_offset, dump_data_offset + (uint64_t) map_num_bytes};
+        file.seekp(0);
+        file.write((const char *) &header, sizeof(header));
+        return (bool) file;
+    }
+
+    bool PROCESS_MEMORY::save_dump(const char *dump_path) const
+    {
+        std::ofstream file(dump_path, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+
+        const std::vector<char> header_page(dump_data_offset, 0);
+        file.write(header_page.data(), header_page.size());
+        if (this->map_num_bytes) file.write((const char *) this->mapped_memory, this->map_num_bytes);
+
+        return finish_dump(file, this->map_base_address, this->map_num_bytes, this->regions);
+    }
+
+    bool PROCESS_MEMORY::capture_dump(HANDLE process_handle, OTHER_PROCESS_PTR base_address, SIZE_T num_bytes, const char *dump_path, bool private_regions_only)
+    {
+        std::ofstream file(dump_path, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+
+        const std::vector<char> header_page(dump_data_offset, 0);
+        file.write(header_page.data(), header_page.size());
+
+        // The regions are read chunk by chunk, a chunk that fails to read is left out like a region would be.
+        std::vector<uint8_t> chunk(MB_TO_BYTES(1));
+        std::vector<MAPPED_REGION> dump_regions;
+        SIZE_T dump_num_bytes = 0;
+        for (const PROCESS_REGION& region : process_list_regions(process_handle, base_address, base_address + num_bytes))
+        {
+            if (!region.is_readable || (private_regions_only && !region.is_private)) continue;
+
+            for (SIZE_T offset = 0; offset < region.size; offset += chunk.size())
+            {
+                const SIZE_T chunk_size = std::min<SIZE_T>(chunk.size(), region.size - offset);
+                if (!process_read(process_handle, region.base_address + offset, chunk.data(), chunk_size)) continue;
+
+                file.write((const char *) chunk.data(), chunk_size);
+                append_run(dump_regions, region.base_address + offset, chunk_size, dump_num_bytes);
+                dump_num_bytes += chunk_size;
+            }
+        }
+        if (!file) return false;
+
+        return finish_dump(file, base_address, dump_num_bytes, dump_regions);
+    }
+
+    OTHER_PROCESS_PTR PROCESS_MEMORY::host_ptr_to_other(HOST_PROCESS_PTR ptr) const
+    {
+        if (ptr < this->mapped_memory || ptr >= this->mapped_memory + this->map_num_bytes) return nullptr;
+
+        const size_t map_offset = (size_t)(ptr - this->mapped_memory);
+        auto region = std::upper_bound(regions.begin(), regions.end(), map_offset, [](size_t offset, const MAPPED_REGION& region) { return offset < region.map_offset; });
+        --region; // The first region starts at offset 0, so there is always one before.
+        return region->base_address + (map_offset - region->map_offset);
+    }
+
+    HOST_PROCESS_PTR PROCESS_MEMORY::other_ptr_to_host(OTHER_PROCESS_PTR ptr) const
+    {
+        auto region = std::upper_bound(regions.begin(), regions.end(), ptr, [](OTHER_PROCESS_PTR address, const MAPPED_REGION& region) { return address < region.base_address; });
+        if (region == regions.begin()) return nullptr;
+
+        --region;
+        if (ptr >= region->base_address + region->size) return nullptr;
+        return this->mapped_memory + region->map_offset + (ptr - region->base_address);
+    }
+
+    size_t PROCESS_MEMORY::map_offset_at_or_after(OTHER_PROCESS_PTR ptr) const
+    {
+        auto region = std::upper_bound(regions.begin(), regions.end(), ptr, [](OTHER_PROCESS_PTR address, const MAPPED_REGION& region) { return address < region.base_address; });
+        if (region != regions.begin())
+        {
+            const MAPPED_REGION& previous = *(region - 1);
+            if (ptr < previous.base_address + previous.size) return previous.map_offset + (ptr - previous.base_address);
+        }
+        return region == regions.end() ? this->map_num_bytes : region->map_offset;
+    }
+
+    std::vector<PROCESS_MEMORY::SCAN_SHARD> PROCESS_MEMORY::split_into_shards(size_t map_offset, size_t shard_size) const
+    {
+        std::vector<SCAN_SHARD> shards;
+        for (const MAPPED_REGION& region : regions)
+        {
+            const size_t region_end = region.map_offset + region.size;
+            for (size_t offset = std::max(region.map_offset, map_offset); offset < region_end; )
+            {
+                const size_t size = std::min(shard_size, region_end - offset);
+                shards.push_back({offset, size, region_end});
+                offset += size;
+            }
+        }
+        return shards;
+    }
+
+    OTHER_PROCESS_PTR PROCESS_MEMORY::find_compiled_pattern_in_memory(const COMPILED_PATTERN& pattern, OTHER_PROCESS_PTR search_start_addr_in_process_space)
+    {
+        SYSTRACE_SCOPE("PROCESS_MEMORY::find_pattern_in_memory");
+        // TODO: Do something if this function fails to find. 
+        const size_t search_start_offset = search_start_addr_in_process_space ? map_offset_at_or_after(search_start_addr_in_process_space) : 0;
+
+        const size_t result = find_in_shards(search_start_offset, pattern);
+        if(result == SIZE_MAX) return nullptr;
+
+        return host_ptr_to_other(this->mapped_memory + result);
+    }
+
+    OTHER_PROCESS_PTR PROCESS_MEMORY::find_pattern_in_memory(BYTE* pattern_ptr, size_t pattern_size, OTHER_PROCESS_PTR search_start_addr_in_process_space)
+    {
+        return find_compiled_pattern_in_memory(compile_pattern(pattern_ptr, nullptr, pattern_size), search_start_addr_in_process_space);
+    }
+
+    OTHER_PROCESS_PTR PROCESS_MEMORY::find_pattern_in_memory(const COMPILED_PATTERN& pattern, OTHER_PROCESS_PTR search_start_addr_in_process_space)
+    {
+        return find_compiled_pattern_in_memory(pattern, search_start_addr_in_process_space);
+    }
+
+    void PROCESS_MEMORY::set_parallel_scan(const PARALLEL_SCAN_CONFIG& config)
+    {
+        this->parallel_scan_config = config;
+        if (this->parallel_scan_config.worker_count == 0) this->parallel_scan_config.worker_count = std::max(1u, std::thread::hardware_concurrency());
+        if (this->parallel_scan_config.shard_size == 0) this->parallel_scan_config.shard_size = PARALLEL_SCAN_CONFIG().shard_size;
+
+        this->scan_worker_pool.reset();
+        if (this->parallel_scan_config.worker_count > 1)
+            this->scan_worker_pool.reset(new SCAN_WORKER_POOL(this->parallel_scan_config.worker_count));
+    }
+
+    size_t PROCESS_MEMORY::find_in_shards(size_t map_offset, const COMPILED_PATTERN& pattern)
+    {
+        // A serial scan searches each region whole.
+        const std::vector<SCAN_SHARD> shards = split_into_shards(map_offset, this->scan_worker_pool ? this->parallel_scan_config.shard_size : SIZE_MAX);
+
+        auto search_shard = [&](const SCAN_SHARD& shard)
+        {
+            // Extend the shard by pattern.size - 1 bytes within its region, so that matches starting in it are found whole.
+            // A match can't start past the shard end in that extension, so it is never found twice.
+            const size_t search_end = std::min(shard.map_offset + shard.size + pattern.size - 1, shard.region_end);
+            const HOST_PROCESS_PTR match = (HOST_PROCESS_PTR) memmem_compiled(this->mapped_memory + shard.map_offset, search_end - shard.map_offset, pattern);
+            return match ? (size_t)(match - this->mapped_memory) : SIZE_MAX;
+        };
+
+        if (!this->scan_worker_pool || shards.size() <= 1)
+        {
+            for (const SCAN_SHARD& shard : shards)
+            {
+                const size_t match_offset = search_shard(shard);
+                if (match_offset != SIZE_MAX) return match_offset;
+            }
+            return SIZE_MAX;
+        }
+
+        // Offset of the lowest match found so far. Shards that start above it can't hold the first match.
+        std::atomic<size_t> lowest_match_offset {SIZE_MAX};
+
+        this->scan_worker_pool->run(shards.size(), [&](size_t shard_index)
+        {
+            const SCAN_SHARD& shard = shards[shard_index];
+            if (shard.map_offset >= lowest_match_offset.load(std::memory_order_relaxed)) return;
+
+            const size_t match_offset = search_shard(shard);
+            size_t lowest = lowest_match_offset.load();
+            while (match_offset < lowest && !lowest_match_offset.compare_exchange_weak(lowest, match_offset)) {}
+        });
+
+        return lowest_match_offset.load();
+    }
+
+    bool PROCESS_MEMORY::find_patterns_in_memory(std::vector<PATTERN_SCAN_TARGET>& targets)
+    {
+        SYSTRACE_SCOPE("PROCESS_MEMORY::find_patterns_in_memory");
+        for (PATTERN_SCAN_TARGET& target : targets) target.matches.clear();
+
+        const MULTI_PATTERN_MATCHER matcher(targets);
+        const std::vector<SCAN_SHARD> shards = split_into_shards(0, this->scan_worker_pool ? this->parallel_scan_config.shard_size : SIZE_MAX);
+
+        size_t max_pattern_size = 1;
+        for (const PATTERN_SCAN_TARGET& target : targets) max_pattern_size = std::max(max_pattern_size, target.pattern_size);
+
+        // Scans a shard into shard_targets. Returns true once they are all resolved.
+        auto scan_shard = [&](const SCAN_SHARD& shard, std::vector<PATTERN_SCAN_TARGET>& shard_targets)
+        {
+            const size_t scan_end = std::min(shard.map_offset + shard.size + max_pattern_size - 1, shard.region_end);
+            return matcher.scan(this->mapped_memory + shard.map_offset, scan_end - shard.map_offset, host_ptr_to_other(this->mapped_memory + shard.map_offset), shard_targets, shard.size);
+        };
+
+        auto are_all_resolved = [&targets]()
+        {
+            for (const PATTERN_SCAN_TARGET& target : targets)
+            {
+                if (!target.is_resolved()) return false;
+            }
+            return true;
+        };
+
+        if (!this->scan_worker_pool || shards.size() <= 1)
+        {
+            for (const SCAN_SHARD& shard : shards)
+            {
+                if (scan_shard(shard, targets)) return true;
+            }
+            return are_all_resolved();
+        }
+
+        // Every shard collects its own matches. Completed shards are merged in address order, so that each target keeps
+        // its lowest max_matches matches. Once the merged shards resolve every target, the remaining shards are skipped.
+        const size_t shard_count = shards.size();
+        std::vector<std::vector<PATTERN_SCAN_TARGET>> shard_results(shard_count);
+        std::vector<bool> is_shard_completed(shard_count, false);
+        std::mutex merge_mutex;
+        size_t merged_shard_count = 0;
+        bool is_resolved = false;
+        std::atomic<size_t> skip_shards_from {shard_count};
+        const std::vector<PATTERN_SCAN_TARGET> unresolved_targets = targets; // Copied by every shard, targets is written by the merge.
+
+        this->scan_worker_pool->run(shard_count, [&](size_t shard_index)
+        {
+            if (shard_index >= skip_shards_from.load(std::memory_order_relaxed)) return;
+
+            std::vector<PATTERN_SCAN_TARGET> shard_targets = unresolved_targets;
+            scan_shard(shards[shard_index], shard_targets);
+
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            shard_results[shard_index] = std::move(shard_targets);
+            is_shard_completed[shard_index] = true;
+
+            while (!is_resolved && merged_shard_count < shard_count && is_shard_completed[merged_shard_count])
+            {
+                std::vector<PATTERN_SCAN_TARGET>& merged_targets = shard_results[merged_shard_count];
+                for (size_t i = 0; i < targets.size(); i++)
+                {
+                    for (OTHER_PROCESS_PTR match : merged_targets[i].matches)
+                    {
+                        if (targets[i].is_resolved()) break;
+                        targets[i].matches.push_back(match);
+                    }
+                }
+                merged_targets.clear();
+                merged_shard_count++;
+
+                is_resolved = are_all_resolved();
+                if (is_resolved) skip_shards_from.store(merged_shard_count);
+            }
+        });
+
+        return are_all_resolved();
+    }
+
+    PROCESS_MEMORY_STREAM::PROCESS_MEMORY_STREAM(HANDLE process_handle, OTHER_PROCESS_PTR base_address, SIZE_T num_bytes, const STREAM_SCAN_CONFIG& config)
+        : process_handle(process_handle), range_base_address(base_address), range_num_bytes(num_bytes), config(config)
+    {
+    }
+
+    bool PROCESS_MEMORY_STREAM::CHUNK_READER::read_next(STREAM_CHUNK& chunk, uint8_t *destination)
+    {
+        SYSTRACE_SCOPE("PROCESS_MEMORY_STREAM::read_chunk");
+        if (address >= range_end) return false;
+
+        // Listed once for the whole range, rather than queried region by region.
+        if (!are_regions_listed)
+        {
+            regions = process_list_regions(process_handle, address, range_end);
+            are_regions_listed = true;
+        }
+
+        while (region_index < regions.size() && regions[region_index].base_address + regions[region_index].size <= address) region_index++;
+        if (region_index == regions.size()) return false;
+
+        const PROCESS_REGION& region = regions[region_index];
+        const OTHER_PROCESS_PTR region_end = region.base_address + region.size;
+        if (!region.is_readable)
+        {
+            chunk = {address, (size_t)(region_end - address), false};
+            address = region_end;
+            return true;
+        }
+
+        const size_t bytes_to_read = std::min<size_t>(chunk_capacity, region_end - address);
+        chunk = {address, bytes_to_read, process_read(process_handle, address, destination, bytes_to_read)};
+        address += bytes_to_read;
+        return true;
+    }
+
+    void PROCESS_MEMORY_STREAM::for_each_chunk(OTHER_PROCESS_PTR scan_begin, OTHER_PROCESS_PTR scan_end, size_t overlap, const CHUNK_CALLBACK& on_chunk)
+    {
+        // Every chunk buffer keeps overlap bytes in front of the chunk, where the carry is copied before the search.
+        const size_t buffer_count = std::max<uint32_t>(1, this->config.buffer_count);
+        assert(this->config.buffer_budget > overlap);
+        const size_t chunk_buffer_size = (this->config.buffer_budget - overlap) / buffer_count;
+        assert(chunk_buffer_size > overlap);
+        const size_t chunk_capacity = chunk_buffer_size - overlap;
+
+        this->buffer.resize(this->config.buffer_budget);
+        uint8_t *carry = this->buffer.data() + buffer_count * chunk_buffer_size;
+
+        const OTHER_PROCESS_PTR range_end = this->range_base_address + this->range_num_bytes;
+        const OTHER_PROCESS_PTR read_end = (size_t)(range_end - scan_end) > overlap ? scan_end + overlap : range_end;
+        CHUNK_READER reader = {this->process_handle, scan_begin, read_end, chunk_capacity};
+
+        // Data starting at data_address may report the matches that start before scan_end.
+        auto report_limit = [&](OTHER_PROCESS_PTR data_address) { return scan_end > data_address ? (size_t)(scan_end - data_address) : 0; };
+
+        // The tail of the previous chunk that was not reported yet.
+        size_t carry_size = 0;
+        OTHER_PROCESS_PTR carry_end = nullptr;
+
+        // Reports the carried bytes on their own, when the next chunk doesn't follow them.
+        auto flush_carry = [&]()
+        {
+            const bool stop = carry_size && on_chunk(carry, carry_size, carry_end - carry_size, report_limit(carry_end - carry_size));
+            carry_size = 0;
+            return stop;
+        };
+
+        // Searches a chunk that was read into chunk_buffer. Returns true to stop the scan.
+        auto scan_chunk = [&](const STREAM_CHUNK& chunk, uint8_t *chunk_buffer)
+        {
+            if ((!chunk.is_read || chunk.address != carry_end) && flush_carry()) return true;
+            if (!chunk.is_read) return false;
+
+            uint8_t *data = chunk_buffer + overlap - carry_size;
+            memcpy(data, carry, carry_size);
+            const size_t data_size = carry_size + chunk.size;
+
+            // Matches starting in the last overlap bytes may not fit yet, they are reported with the next chunk.
+            const size_t carry_begin = data_size > overlap ? data_size - overlap : 0;
+            const OTHER_PROCESS_PTR data_address = chunk.address - carry_size;
+            if (on_chunk(data, data_size, data_address, std::min(carry_begin, report_limit(data_address)))) return true;
+
+            carry_size = data_size - carry_begin;
+            memcpy(carry, data + carry_begin, carry_size);
+            carry_end = chunk.address + chunk.size;
+            return false;
+        };
+
+        if (buffer_count == 1)
+        {
+            STREAM_CHUNK chunk;
+            while (reader.read_next(chunk, this->buffer.data() + overlap))
+            {
+                if (scan_chunk(chunk, this->buffer.data())) return;
+            }
+            flush_carry();
+            return;
+        }
+
+        // Chunk i is read into buffer i % buffer_count. The reader waits for a free buffer, the search for a filled one.
+        std::vector<STREAM_CHUNK> chunks(buffer_count);
+        std::mutex mutex;
+        std::condition_variable chunk_filled;
+        std::condition_variable buffer_freed;
+        size_t filled_count = 0;
+        size_t scanned_count = 0;
+        bool is_reading_done = false;
+        bool is_stopping = false;
+
+        std::thread reader_thread([&]()
+        {
+            SYSTRACE_THREAD_NAME("stream reader");
+            for (size_t chunk_index = 0; ; chunk_index++)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    buffer_freed.wait(lock, [&]() { return is_stopping || chunk_index - scanned_count < buffer_count; });
+                    if (is_stopping) return;
+                }
+
+                STREAM_CHUNK chunk;
+                const size_t buffer_index = chunk_index % buffer_count;
+                const bool has_chunk = reader.read_next(chunk, this->buffer.data() + buffer_index * chunk_buffer_size + overlap);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (has_chunk) chunks[buffer_index] = chunk;
+                    if (has_chunk) filled_count++;
+                    else is_reading_done = true;
+                }
+                chunk_filled.notify_one();
+                if (!has_chunk) return;
+            }
+        });
+
+        bool is_stopped = false;
+        while (!is_stopped)
+        {
+            STREAM_CHUNK chunk;
+            size_t buffer_index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                chunk_filled.wait(lock, [&]() { return scanned_count < filled_count || is_reading_done; });
+                if (scanned_count == filled_count) break;
+
+                buffer_index = scanned_count % buffer_count;
+                chunk = chunks[buffer_index];
+            }
+
+            is_stopped = scan_chunk(chunk, this->buffer.data() + buffer_index * chunk_buffer_size);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                scanned_count++;
+                is_stopping = is_stopped;
+            }
+            buffer_freed.notify_one();
+        }
+
+        reader_thread.join();
+        if (!is_stopped) flush_carry();
+    }
+
+    OTHER_PROCESS_PTR PROCESS_MEMORY_STREAM::find_compiled_pattern_in_memory(const COMPILED_PATTERN& pattern, OTHER_PROCESS_PTR search_start_addr_in_process_space)
+    {
+        SYSTRACE_SCOPE("PROCESS_MEMORY_STREAM::find_pattern_in_memory");
+        OTHER_PROCESS_PTR result = nullptr;
+        const OTHER_PROCESS_PTR scan_begin = search_start_addr_in_process_space ? search_start_addr_in_process_space : this->range_base_address;
+
+        for_each_chunk(scan_begin, this->range_base_address + this->range_num_bytes, pattern.size - 1, [&](const uint8_t *data, size_t data_size, OTHER_PROCESS_PTR data_address, size_t report_end)
+        {
+            // memmem returns the first match, so if it is past report_end there is nothing to report in this chunk.
+            const uint8_t *match = (const uint8_t *) memmem_compiled(data, data_size, pattern);
+            if (!match || (size_t)(match - data) >= report_end) return false;
+
+            result = data_address + (match - data);
+            return true;
+        });
+        return result;
+    }
+
+    OTHER_PROCESS_PTR PROCESS_MEMORY_STREAM::find_pattern_in_memory(BYTE *pattern_ptr, size_t pattern_size, OTHER_PROCESS_PTR search_start_addr_in_process_space)
+    {
+        return find_compiled_pattern_in_memory(compile_pattern(pattern_ptr, nullptr, pattern_size), search_start_addr_in_process_space);
+    }
+
+    OTHER_PROCESS_PTR PROCESS_MEMORY_STREAM::find_pattern_in_memory(const COMPILED_PATTERN& pattern, OTHER_PROCESS_PTR search_start_addr_in_process_space)
+    {
+        return find_compiled_pattern_in_memory(pattern, search_start_addr_in_process_space);
+    }
+
+    bool PROCESS_MEMORY_STREAM::find_patterns_in_memory(std::vector<PATTERN_SCAN_TARGET>& targets)
+    {
+        SYSTRACE_SCOPE("PROCESS_MEMORY_STREAM::find_patterns_in_memory");
+        for (PATTERN_SCAN_TARGET& target : targets) target.matches.clear();
+
+        const MULTI_PATTERN_MATCHER matcher(targets);
+        size_t max_pattern_size = 1;
+        for (const PATTERN_SCAN_TARGET& target : targets) max_pattern_size = std::max(max_pattern_size, target.pattern_size);
+
+        bool is_resolved = targets.empty();
+        if (is_resolved) return true;
+
+        for_each_chunk(this->range_base_address, this->range_base_address + this->range_num_bytes, max_pattern_size - 1, [&](const uint8_t *data, size_t data_size, OTHER_PROCESS_PTR data_address, size_t report_end)
+        {
+            is_resolved = matcher.scan(data, data_size, data_address, targets, report_end);
+            return is_resolved;
+        });
+        return is_resolved;
+    }
+
+    bool PROCESS_MEMORY_STREAM::find_patterns_near(std::vector<PATTERN_SCAN_TARGET>& targets, const std::vector<OTHER_PROCESS_PTR>& hints, size_t first_probe_radius)
+    {
+        SYSTRACE_SCOPE("PROCESS_MEMORY_STREAM::find_patterns_near");
+        if (hints.empty()) return find_patterns_in_memory(targets);
+
+        for (PATTERN_SCAN_TARGET& target : targets) target.matches.clear();
+
+        const MULTI_PATTERN_MATCHER matcher(targets);
+        size_t max_pattern_size = 1;
+        for (const PATTERN_SCAN_TARGET& target : targets) max_pattern_size = std::max(max_pattern_size, target.pattern_size);
+
+        bool is_resolved = targets.empty();
+        const OTHER_PROCESS_PTR range_end = this->range_base_address + this->range_num_bytes;
+
+        auto scan_interval = [&](OTHER_PROCESS_PTR begin, OTHER_PROCESS_PTR end)
+        {
+            for_each_chunk(begin, end, max_pattern_size - 1, [&](const uint8_t *data, size_t data_size, OTHER_PROCESS_PTR data_address, size_t report_end)
+            {
+                is_resolved = matcher.scan(data, data_size, data_address, targets, report_end);
+                return is_resolved;
+            });
+        };
+
+        // The probed windows, sorted and merged. They only grow, so each round scans the difference with the previous round.
+        typedef std::pair<OTHER_PROCESS_PTR, OTHER_PROCESS_PTR> ADDRESS_INTERVAL;
+        std::vector<ADDRESS_INTERVAL> scanned_windows;
+
+        for (size_t radius = std::max<size_t>(first_probe_radius, 1); !is_resolved; radius = radius > this->range_num_bytes / 4 ? this->range_num_bytes : radius * 4)
+        {
+            std::vector<ADDRESS_INTERVAL> windows;
+            if (radius >= this->range_num_bytes)
+            {
+                windows.push_back({this->range_base_address, range_end});
+            }
+            else
+            {
+                for (OTHER_PROCESS_PTR hint : hints)
+                {
+                    const size_t hint_offset = (size_t) std::min(std::max(hint, this->range_base_address), range_end) - (size_t) this->range_base_address;
+                    windows.push_back({this->range_base_address + (hint_offset > radius ? hint_offset - radius : 0), this->range_base_address + std::min(hint_offset + radius, this->range_num_bytes)});
+                }
+                std::sort(windows.begin(), windows.end());
+
+                std::vector<ADDRESS_INTERVAL> merged_windows;
+                for (const ADDRESS_INTERVAL& window : windows)
+                {
+                    if (!merged_windows.empty() && window.first <= merged_windows.back().second) merged_windows.back().second = std::max(merged_windows.back().second, window.second);
+                    else merged_windows.push_back(window);
+                }
+                windows.swap(merged_windows);
+            }
+
+            // Scan the parts of the windows that previous rounds did not cover.
+            for (const ADDRESS_INTERVAL& window : windows)
+            {
+                OTHER_PROCESS_PTR address = window.first;
+                for (const ADDRESS_INTERVAL& scanned : scanned_windows)
+                {
+                    if (is_resolved || scanned.second <= address) continue;
+                    if (scanned.first >= window.second) break;
+
+                    if (address < scanned.first) scan_interval(address, scanned.first);
+                    address = scanned.second;
+                }
+
+                if (!is_resolved && address < window.second) scan_interval(address, window.second);
+            }
+            scanned_windows.swap(windows);
+
+            if (scanned_windows.size() == 1 && scanned_windows.front().first == this->range_base_address && scanned_windows.front().second == range_end) break;
+        }
+
+        for (PATTERN_SCAN_TARGET& target : targets) std::sort(target.matches.begin(), target.matches.end());
+        return is_resolved;
+    }
+
+    void REMOTE_GATHER::add(OTHER_PROCESS_PTR address, size_t destination_offset, size_t size)
+    {
+        this->values.push_back({address, size, destination_offset, SIZE_MAX});
+        this->is_built = false;
+    }
+
+    void REMOTE_GATHER::build()
+    {
+        std::vector<size_t> order(this->values.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return this->values[a].address < this->values[b].address; });
+
+        // The region of every value that may start a span, in one batch.
+        std::vector<PROCESS_REGION_QUERY> region_queries(this->values.size());
+        for (size_t i = 0; i < this->values.size(); i++) region_queries[i] = {this->values[i].address, {}, false};
+        process_query_region_batch(this->process_handle, region_queries.data(), region_queries.size());
+
+        this->spans.clear();
+        for (size_t value_index : order)
+        {
+            GATHER_VALUE& value = this->values[value_index];
+            value.span_index = SIZE_MAX;
+            if (!value.address) continue;
+
+            const OTHER_PROCESS_PTR value_end = value.address + value.size;
+            if (!this->spans.empty())
+            {
+                GATHER_SPAN& span = this->spans.back();
+                const OTHER_PROCESS_PTR span_end = span.address + span.size;
+                if (value.address <= span_end + this->max_gap && value_end <= span.region_end)
+                {
+                    span.size = std::max(span_end, value_end) - span.address;
+                    value.span_index = this->spans.size() - 1;
+                    continue;
+                }
+            }
+
+            // A new span. If its region can't be queried, it is limited to this value.
+            const PROCESS_REGION_QUERY& region_query = region_queries[value_index];
+            OTHER_PROCESS_PTR region_end = value_end;
+            if (region_query.is_queried)
+                region_end = std::max(value_end, region_query.region.base_address + region_query.region.size);
+
+            this->spans.push_back({value.address, value.size, region_end, 0});
+            value.span_index = this->spans.size() - 1;
+        }
+
+        size_t buffer_size = 0;
+        for (GATHER_SPAN& span : this->spans)
+        {
+            span.buffer_offset = buffer_size;
+            buffer_size += span.size;
+        }
+        this->buffer.assign(buffer_size, 0);
+
+        this->span_reads.clear();
+        for (const GATHER_SPAN& span : this->spans) this->span_reads.push_back({span.address, this->buffer.data() + span.buffer_offset, span.size, false});
+        this->is_built = true;
+    }
+
+    bool REMOTE_GATHER::read(void *destination)
+    {
+        SYSTRACE_SCOPE("REMOTE_GATHER::read");
+        if (!this->is_built) build();
+
+        process_read_batch(this->process_handle, this->span_reads.data(), this->span_reads.size());
+
+        bool is_every_value_read = true;
+        for (const GATHER_VALUE& value : this->values)
+        {
+            uint8_t *field = (uint8_t *) destination + value.destination_offset;
+            if (value.span_index == SIZE_MAX || !this->span_reads[value.span_index].is_read)
+            {
+                memset(field, 0, value.size);
+                is_every_value_read = false;
+                continue;
+            }
+
+            const GATHER_SPAN& span = this->spans[value.span_index];
+            memcpy(field, this->buffer.data() + span.buffer_offset + (value.address - span.address), value.size);
+        }
+        return is_every_value_read;
+    }
+
+    size_t REMOTE_GATHER::span_count()
+    {
+        if (!this->is_built) build();
+        return this->spans.size();
+    }
+
+    SCAN_WORKER_POOL::SCAN_WORKER_POOL(uint32_t worker_count)
+    {
+        for (uint32_t i = 1; i < worker_count; i++) workers.emplace_back(&SCAN_WORKER_POOL::worker_loop, this);
+    }
+
+    SCAN_WORKER_POOL::~SCAN_WORKER_POOL()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            is_stopping = true;
+        }
+        work_available.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    void SCAN_WORKER_POOL::run(size_t task_count, const std::function<void(size_t)>& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->task = &task;
+            this->task_count = task_count;
+            this->next_task_index = 0;
+            this->busy_worker_count = workers.size();
+            this->run_generation++;
+        }
+        work_available.notify_all();
+
+        run_tasks();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        work_done.wait(lock, [this]() { return busy_worker_count == 0; });
+        this->task = nullptr;
+    }
+
+    void SCAN_WORKER_POOL::run_tasks()
+    {
+        for (size_t task_index = next_task_index++; task_index < task_count; task_index = next_task_index++) (*task)(task_index);
+    }
+
+    void SCAN_WORKER_POOL::worker_loop()
+    {
+        uint64_t last_generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [&]() { return is_stopping || run_generation != last_generation; });
+                if (is_stopping) return;
+                last_generation = run_generation;
+            }
+
+            run_tasks();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy_worker_count--;
+            }
+            work_done.notify_one();
+        }
+    }
+
+    MULTI_PATTERN_MATCHER::MULTI_PATTERN_MATCHER(const std::vector<PATTERN_SCAN_TARGET>& targets)
+        : anchor_filter(((size_t)1 << filter_hash_bits) / 64, 0)
+    {
+        size_t anchor_count = 0;
+        for (size_t target_index = 0; target_index < targets.size(); target_index++)
+        {
+            const PATTERN_SCAN_TARGET& target = targets[target_index];
+            assert(target.pattern_size >= anchor_size);
+
+            // The rarest window gives the fewest false positives to verify. Compiled patterns come with it.
+            const size_t best_offset = target.window_offset != SIZE_MAX ? target.window_offset : memmem_find_window(target.pattern_ptr, target.mask_ptr, target.pattern_size, anchor_size);
+            if (best_offset == SIZE_MAX || memmem_window_frequency(target.pattern_ptr, best_offset, anchor_size) > pattern_window_max_frequency)
+            {
+                MEMMEM_TARGET memmem_target;
+                memmem_target.pattern = compile_pattern(target.pattern_ptr, target.mask_ptr, target.pattern_size);
+                memmem_horspool_shifts(target.pattern_ptr, target.mask_ptr, target.pattern_size, memmem_target.shifts);
+                memmem_target.target_index = target_index;
+                memmem_targets.push_back(memmem_target);
+                continue;
+            }
+
+            ANCHOR anchor = {0, best_offset, target_index};
+            memcpy(&anchor.key, target.pattern_ptr + best_offset, anchor_size);
+
+            const uint32_t hash = hash_anchor_key(anchor.key);
+            anchor_filter[hash / 64] |= (uint64_t)1 << (hash % 64);
+
+            const size_t bucket = anchor_count++ % bucket_count;
+            bucket_anchors[bucket].push_back(anchor);
+
+            const uint8_t bucket_bit = (uint8_t)(1 << bucket);
+            for (size_t i = 0; i < anchor_size; i++)
+            {
+                const uint8_t fingerprint_byte = target.pattern_ptr[best_offset + i];
+                for (size_t lane = 0; lane < 32; lane += 16)
+                {
+                    fingerprint_low_nibble_buckets[i][lane + (fingerprint_byte & 0x0F)] |= bucket_bit;
+                    fingerprint_high_nibble_buckets[i][lane + (fingerprint_byte >> 4)] |= bucket_bit;
+                }
+            }
+        }
+    }
+
+    bool MULTI_PATTERN_MATCHER::verify_position(SCAN_CONTEXT& context, size_t position, uint8_t bucket_mask) const
+    {
+        if (position + anchor_size > context.data_size) return false;
+
+        uint32_t key = 0;
+        memcpy(&key, context.data + position, anchor_size);
+
+        for (; bucket_mask; bucket_mask &= bucket_mask - 1)
+        {
+            for (const ANCHOR& anchor : bucket_anchors[__builtin_ctz(bucket_mask)])
+            {
+                if (anchor.key != key || anchor.offset > position) continue;
+
+                PATTERN_SCAN_TARGET& target = context.targets[anchor.target_index];
+                const size_t match_start = position - anchor.offset;
+                if (target.is_resolved() || match_start >= context.report_end || match_start + target.pattern_size > context.data_size) continue;
+                if (!memmem_masked_equal(context.data + match_start, target.pattern_ptr, target.mask_ptr, target.pattern_size)) continue;
+
+                target.matches.push_back(context.data_address + match_start);
+                if (target.is_resolved() && --context.unresolved_count == 0) return true;
+            }
+        }
+        return false;
+    }
+
+    bool MULTI_PATTERN_MATCHER::scan_memmem_targets(SCAN_CONTEXT& context) const
+    {
+        for (const MEMMEM_TARGET& memmem_target : memmem_targets)
+        {
+            PATTERN_SCAN_TARGET& target = context.targets[memmem_target.target_index];
+            COMPILED_PATTERN pattern = memmem_target.pattern;
+            pattern.shifts = memmem_target.shifts;
+
+            for (size_t search_start = 0; !target.is_resolved() && search_start < context.data_size;)
+            {
+                const uint8_t *match = (const uint8_t*) memmem_compiled(context.data + search_start, context.data_size - search_start, pattern);
+                if (!match) break;
+
+                const size_t match_start = match - context.data;
+                if (match_start >= context.report_end) break;
+
+                target.matches.push_back(context.data_address + match_start);
+                if (target.is_resolved() && --context.unresolved_count == 0) return true;
+                search_start = match_start + 1;
+            }
+        }
+        return false;
+    }
+
+#ifdef KC_MEMUTILS_SIMD
+    __attribute__((target("avx2")))
+    bool MULTI_PATTERN_MATCHER::scan_avx2(SCAN_CONTEXT& context, size_t& position) const
+    {
+        __m256i low_tables[anchor_size];
+        __m256i high_tables[anchor_size];
+        for (size_t i = 0; i < anchor_size; i++)
+        {
+            low_tables[i] = _mm256_loadu_si256((const __m256i*) fingerprint_low_nibble_buckets[i]);
+            high_tables[i] = _mm256_loadu_si256((const __m256i*) fingerprint_high_nibble_buckets[i]);
+        }
+        const __m256i low_nibble_mask = _mm256_set1_epi8(0x0F);
+        const __m256i zero = _mm256_setzero_si256();
+
+        alignas(32) uint8_t position_buckets[32];
+
+        // Each step loads 32 bytes at position + i for every anchor byte i.
+        for (; position + 32 + anchor_size - 1 <= context.data_size; position += 32)
+        {
+            __m256i buckets = _mm256_set1_epi8((char) 0xFF);
+            for (size_t i = 0; i < anchor_size; i++)
+            {
+                const __m256i block = _mm256_loadu_si256((const __m256i*)(context.data + position + i));
+                const __m256i low_nibbles = _mm256_and_si256(block, low_nibble_mask);
+                const __m256i high_nibbles = _mm256_and_si256(_mm256_srli_epi16(block, 4), low_nibble_mask);
+                buckets = _mm256_and_si256(buckets, _mm256_and_si256(_mm256_shuffle_epi8(low_tables[i], low_nibbles), _mm256_shuffle_epi8(high_tables[i], high_nibbles)));
+            }
+
+            uint32_t candidates = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(buckets, zero));
+            if (!candidates) continue;
+
+            _mm256_store_si256((__m256i*) position_buckets, buckets);
+            while (candidates)
+            {
+                const size_t lane = __builtin_ctz(candidates);
+                if (verify_position(context, position + lane, position_buckets[lane])) return true;
+                candidates &= candidates - 1;
+            }
+        }
+        return false;
+    }
+#endif
+
+    bool MULTI_PATTERN_MATCHER::scan(const uint8_t *data, size_t data_size, OTHER_PROCESS_PTR data_address, std::vector<PATTERN_SCAN_TARGET>& targets, size_t report_end) const
+    {
+        SCAN_CONTEXT context = {data, data_size, report_end, data_address, targets, 0};
+        for (const PATTERN_SCAN_TARGET& target : targets)
+        {
+            if (!target.is_resolved()) context.unresolved_count++;
+        }
+        if (context.unresolved_count == 0) return true;
+
+        if (scan_memmem_targets(context)) return true;
+        if (memmem_targets.size() == targets.size()) return false;
+
+        size_t position = 0;
+#ifdef KC_MEMUTILS_SIMD
+        if (memmem_cpu_supports(MEMMEM_ENGINE::AVX2) && scan_avx2(context, position)) return true;
+#endif
+
+        // Whatever the shuffle filter could not cover, or everything without AVX2.
+        const uint64_t *filter = anchor_filter.data();
+        for (; position + anchor_size <= data_size; position++)
+        {
+            uint32_t key = 0;
+            memcpy(&key, data + position, anchor_size);
+
+            const uint32_t hash = hash_anchor_key(key);
+            if (!((filter[hash / 64] >> (hash % 64)) & 1)) continue;
+
+            if (verify_position(context, position, 0xFF)) return true;
+        }
+        return false;
+    }
+
+#endif
@@ -0,0 +1,654 @@
+#ifndef KC_PROCESS_BACKEND_H
+#define KC_PROCESS_BACKEND_H
+#ifdef _WIN32
+#include <windows.h>
+#include <tlhelp32.h>
+#include <string.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief kc_process_backend.h
+ *
+ * Header only library that gives access to another process: finding it by name, listing the regions of its address space
+ * and reading them. The scanner and the KO Client go through it instead of calling the system directly.
+ * Used internally by the KO Client.
+ *
+ * Two implementations share these functions, chosen at compile time:
+ * - Win32: Toolhelp snapshots, VirtualQueryEx and ReadProcessMemory.
+ * - Linux: /proc/<pid>/maps and process_vm_readv, which reads a whole batch with a single system call. It reads the
+ *   client when it runs under Wine, and lets the scanner be profiled with perf against any local process. Reading another
+ *   process needs ptrace access to it: same user and kernel.yama.ptrace_scope = 0, or CAP_SYS_PTRACE.
+ *
+ */
+
+#ifndef _WIN32
+// The scanner is written with the Win32 types, they map to their POSIX counterparts here.
+typedef void *HANDLE; // The handle of a process is its pid.
+typedef uint32_t DWORD;
+typedef uint8_t BYTE;
+typedef size_t SIZE_T;
+#endif
+
+// This type points to an address in the address space of the other process.
+// The data pointed by the OTHER_PROCESS_PTR is meant to be read using process_read.
+typedef uint8_t *OTHER_PROCESS_PTR;
+
+// This type points to an address in the address space of our own process.
+// The data pointed by the HOST_PROCESS_PTR can be accessed as usual using the asterisk (*) operator.
+typedef uint8_t *HOST_PROCESS_PTR;
+
+/**
+ * @brief A region of the address space of another process, with the same attributes throughout.
+ */
+struct PROCESS_REGION
+{
+    OTHER_PROCESS_PTR base_address;
+    SIZE_T size;
+    bool is_readable; // Committed, and can be read without side effects in the other process, such as touching a guard page.
+    bool is_private;  // Memory of the process itself, such as the heaps, rather than an image or a mapped file.
+};
+
+/**
+ * @brief One query of a batch, see process_query_region_batch.
+ */
+struct PROCESS_REGION_QUERY
+{
+    OTHER_PROCESS_PTR address;
+    PROCESS_REGION region; // Set by process_query_region_batch, the region that contains address.
+    bool is_queried;       // Set by process_query_region_batch.
+};
+
+/**
+ * @brief One read of a batch, see process_read_batch.
+ */
+struct PROCESS_READ
+{
+    OTHER_PROCESS_PTR address;
+    void *destination;
+    size_t size;
+    bool is_read; // Set by process_read_batch.
+};
+
+/**
+ * @brief Returns the ID of a running process by the name of its executable, e.g. "KnightOnLine.exe". Case insensitive.
+ *
+ * On Linux the name is matched against the executable of the command line, so a Windows program is found under Wine.
+ *
+ * @return DWORD 0 if no process has that name.
+ */
+DWORD process_find_id(const char *process_name);
+
+/**
+ * @brief Returns the ID of our own process, to run the scanner against itself.
+ */
+DWORD process_current_id();
+
+/**
+ * @brief Opens a process to query and read its memory.
+ *
+ * @return HANDLE nullptr on failure.
+ */
+HANDLE process_open(DWORD process_id);
+
+/**
+ * @brief Closes a handle returned by process_open.
+ */
+void process_close(HANDLE process_handle);
+
+/**
+ * @brief Returns when the process was started, in a unit specific to the system, or 0 if it can't be queried.
+ *
+ * Only meant to tell apart two processes that had the same ID.
+ */
+uint64_t process_creation_time(HANDLE process_handle);
+
+/**
+ * @brief Queries the region that contains address.
+ *
+ * On Linux, every call parses /proc/<pid>/maps: use process_query_region_batch or process_list_regions to query several regions.
+ *
+ * @return false if the address is past the address space of the process.
+ */
+bool process_query_region(HANDLE process_handle, OTHER_PROCESS_PTR address, PROCESS_REGION& region);
+
+/**
+ * @brief Queries the regions of a batch of addresses. A query that fails doesn't stop the others.
+ *
+ * On Linux, /proc/<pid>/maps is parsed once for the whole batch. On Windows, it is one VirtualQueryEx call per query.
+ *
+ * @return size_t The number of queries that succeeded, each of them has is_queried set.
+ */
+size_t process_query_region_batch(HANDLE process_handle, PROCESS_REGION_QUERY *queries, size_t query_count);
+
+/**
+ * @brief Lists the regions that cover [begin, end), in ascending order and clipped to the range.
+ *
+ * The regions follow each other without gaps: the unmapped address space is listed as unreadable regions. The list stops
+ * early if the rest of the range is past the address space of the process.
+ */
+std::vector<PROCESS_REGION> process_list_regions(HANDLE process_handle, OTHER_PROCESS_PTR begin, OTHER_PROCESS_PTR end);
+
+/**
+ * @brief Reads size bytes of the other process at address into destination.
+ *
+ * @return true if every byte was read.
+ */
+bool process_read(HANDLE process_handle, OTHER_PROCESS_PTR address, void *destination, size_t size);
+
+/**
+ * @brief Performs a batch of reads. A read that fails doesn't stop the others.
+ *
+ * On Linux, the batch is a single process_vm_readv call, and one more after every read that fails. On Windows, it is one
+ * ReadProcessMemory call per read.
+ *
+ * @return size_t The number of reads that read every byte, each of them has is_read set.
+ */
+size_t process_read_batch(HANDLE process_handle, PROCESS_READ *reads, size_t read_count);
+
+/**
+ * @brief Allocates zeroed memory in our own process, straight from the system, for the large copies of the other process.
+ */
+HOST_PROCESS_PTR host_allocate_zeroed(size_t size);
+
+/**
+ * @brief Frees memory allocated by host_allocate_zeroed.
+ */
+void host_free(HOST_PROCESS_PTR memory, size_t size);
+
+/**
+ * @brief Maps a whole file into our own process, read only. The pages are loaded from the file when first touched.
+ *
+ * @param path Path of the file.
+ * @param size Receives the size of the file.
+ * @return HOST_PROCESS_PTR nullptr if the file can't be opened or is empty. The view must not be written to.
+ */
+HOST_PROCESS_PTR host_map_file(const char *path, size_t& size);
+
+/**
+ * @brief Unmaps a view returned by host_map_file.
+ */
+void host_unmap_file(HOST_PROCESS_PTR view, size_t size);
+
+/**
+ * @brief Returns the directory of the executable of our own process, with a trailing separator, to find the files shipped
+ * next to it whatever the working directory.
+ *
+ * @return std::string Empty if it can't be queried, which leaves the paths built on it relative to the working directory.
+ */
+std::string host_executable_directory();
+
+#ifdef _WIN32
+/**
+ * @brief Returns true if the region is committed and can be copied with ReadProcessMemory, judging by its protection.
+ *
+ * Free and reserved regions have no pages behind them, and guard pages raise an exception in the other process when touched.
+ */
+bool is_readable_region(const MEMORY_BASIC_INFORMATION& region_info);
+#endif
+
+#endif
+
+#ifdef KC_PROCESS_BACKEND_IMPLEMENTATION
+#pragma once
+#ifdef _WIN32
+    bool is_readable_region(const MEMORY_BASIC_INFORMATION& region_info)
+    {
+        return region_info.State == MEM_COMMIT &&
+               !(region_info.Protect & PAGE_GUARD) &&
+               region_info.Protect != PAGE_NOACCESS &&
+               region_info.Protect != PAGE_EXECUTE_WRITECOPY &&
+               region_info.Protect != PAGE_EXECUTE &&
+               region_info.Protect != PAGE_WRITECOPY &&
+               region_info.Protect != PAGE_TARGETS_INVALID;
+    }
+
+    DWORD process_find_id(const char *process_name)
+    {
+        HANDLE snapshot_handle = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+        if (snapshot_handle == INVALID_HANDLE_VALUE) return 0;
+
+        PROCESSENTRY32 process_entry {};
+        process_entry.dwSize = sizeof(PROCESSENTRY32);
+
+        DWORD result = 0;
+        while (Process32Next(snapshot_handle, &process_entry))
+        {
+            if (_stricmp(process_entry.szExeFile, process_name) == 0)
+            {
+                result = process_entry.th32ProcessID;
+                break;
+            }
+        }
+
+        CloseHandle(snapshot_handle);
+        return result;
+    }
+
+    DWORD process_current_id()
+    {
+        return GetCurrentProcessId();
+    }
+
+    HANDLE process_open(DWORD process_id)
+    {
+        return OpenProcess(PROCESS_ALL_ACCESS, FALSE, process_id);
+    }
+
+    void process_close(HANDLE process_handle)
+    {
+        if (process_handle) CloseHandle(process_handle);
+    }
+
+    uint64_t process_creation_time(HANDLE process_handle)
+    {
+        FILETIME creation_time, exit_time, kernel_time, user_time;
+        if (!GetProcessTimes(process_handle, &creation_time, &exit_time, &kernel_time, &user_time)) return 0;
+        return ((uint64_t) creation_time.dwHighDateTime << 32) | creation_time.dwLowDateTime; // 100 ns intervals since 1601.
+    }
+
+    bool process_query_region(HANDLE process_handle, OTHER_PROCESS_PTR address, PROCESS_REGION& region)
+    {
+        MEMORY_BASIC_INFORMATION region_info;
+        if (!VirtualQueryEx(process_handle, address, &region_info, sizeof(region_info))) return false;
+
+        region = {(OTHER_PROCESS_PTR) region_info.BaseAddress, region_info.RegionSize, is_readable_region(region_info), region_info.Type == MEM_PRIVATE};
+        return true;
+    }
+
+    bool process_read(HANDLE process_handle, OTHER_PROCESS_PTR address, void *destination, size_t size)
+    {
+        SIZE_T bytes_read = 0;
+        const bool succeed = ReadProcessMemory(process_handle, address, destination, size, &bytes_read);
+        return succeed && bytes_read == size;
+    }
+
+    size_t process_read_batch(HANDLE process_handle, PROCESS_READ *reads, size_t read_count)
+    {
+        size_t completed_count = 0;
+        for (size_t i = 0; i < read_count; i++)
+        {
+            reads[i].is_read = process_read(process_handle, reads[i].address, reads[i].destination, reads[i].size);
+            completed_count += reads[i].is_read;
+        }
+        return completed_count;
+    }
+
+    HOST_PROCESS_PTR host_allocate_zeroed(size_t size)
+    {
+        return (HOST_PROCESS_PTR) VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    }
+
+    void host_free(HOST_PROCESS_PTR memory, size_t size)
+    {
+        if (memory) VirtualFree(memory, 0, MEM_RELEASE);
+    }
+
+    HOST_PROCESS_PTR host_map_file(const char *path, size_t& size)
+    {
+        size = 0;
+        HANDLE file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file_handle == INVALID_HANDLE_VALUE) return nullptr;
+
+        LARGE_INTEGER file_size;
+        HOST_PROCESS_PTR view = nullptr;
+        if (GetFileSizeEx(file_handle, &file_size) && file_size.QuadPart > 0)
+        {
+            // The view keeps the mapping alive, both handles can be closed right away.
+            HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping_handle)
+            {
+                view = (HOST_PROCESS_PTR) MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+                if (view) size = (size_t) file_size.QuadPart;
+                CloseHandle(mapping_handle);
+            }
+        }
+
+        CloseHandle(file_handle);
+        return view;
+    }
+
+    void host_unmap_file(HOST_PROCESS_PTR view, size_t size)
+    {
+        if (view) UnmapViewOfFile(view);
+    }
+
+    std::string host_executable_directory()
+    {
+        char path[MAX_PATH];
+        const DWORD length = GetModuleFileNameA(NULL, path, sizeof(path));
+        if (length == 0 || length >= sizeof(path)) return std::string();
+
+        const std::string executable_path(path, length);
+        return executable_path.substr(0, executable_path.find_last_of("\\/") + 1);
+    }
+#else
+    // One line of /proc/<pid>/maps.
+    struct PROCESS_MAPPING
+    {
+        uintptr_t begin;
+        uintptr_t end;
+        bool is_readable;
+        bool is_private;
+    };
+
+    static pid_t process_pid(HANDLE process_handle) { return (pid_t)(intptr_t) process_handle; }
+
+    // Reads the mappings of the process, in ascending order. Empty if the process can't be queried.
+    static std::vector<PROCESS_MAPPING> process_read_maps(HANDLE process_handle)
+    {
+        std::vector<PROCESS_MAPPING> mappings;
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%d/maps", (int) process_pid(process_handle));
+
+        FILE *maps = fopen(path, "r");
+        if (!maps) return mappings;
+
+        char line[PATH_MAX + 128];
+        while (fgets(line, sizeof(line), maps))
+        {
+            unsigned long begin, end, offset, inode;
+            char permissions[5];
+            int path_offset = 0;
+            if (sscanf(line, "%lx-%lx %4s %lx %*x:%*x %lu %n", &begin, &end, permissions, &offset, &inode, &path_offset) < 5) continue;
+
+            // The kernel pages such as [vvar] can't be read with process_vm_readv.
+            const char *mapping_path = line + path_offset;
+            const bool is_kernel_page = strncmp(mapping_path, "[vvar", 5) == 0 || strncmp(mapping_path, "[vsyscall]", 10) == 0;
+
+            const bool is_readable = permissions[0] == 'r' && !is_kernel_page;
+            const bool is_private = inode == 0 && permissions[3] == 'p'; // Anonymous memory: heaps, stacks, and the VirtualAlloc of Wine.
+            mappings.push_back({(uintptr_t) begin, (uintptr_t) end, is_readable, is_private});
+        }
+
+        fclose(maps);
+        return mappings;
+    }
+
+    // Lists the mappings and the gaps between them that overlap [begin, end). The gaps are unreadable regions.
+    static std::vector<PROCESS_REGION> process_regions_from_maps(const std::vector<PROCESS_MAPPING>& mappings, uintptr_t begin, uintptr_t end)
+    {
+        std::vector<PROCESS_REGION> regions;
+        uintptr_t address = begin;
+        for (const PROCESS_MAPPING& mapping : mappings)
+        {
+            if (address >= end) break;
+            if (mapping.end <= address) continue;
+
+            if (mapping.begin > address)
+            {
+                const uintptr_t gap_end = std::min<uintptr_t>(mapping.begin, end);
+                regions.push_back({(OTHER_PROCESS_PTR) address, gap_end - address, false, false});
+                address = gap_end;
+                if (address >= end) break;
+            }
+
+            const uintptr_t region_end = std::min<uintptr_t>(mapping.end, end);
+            regions.push_back({(OTHER_PROCESS_PTR) address, region_end - address, mapping.is_readable, mapping.is_private});
+            address = region_end;
+        }
+        if (address < end && !mappings.empty()) regions.push_back({(OTHER_PROCESS_PTR) address, end - address, false, false});
+        return regions;
+    }
+
+    // Returns the name of the executable of a command line, without its directory. Wine keeps the Windows path of the program.
+    static const char *process_executable_name(const char *command_line)
+    {
+        const char *name = command_line;
+        for (const char *c = command_line; *c; c++)
+        {
+            if (*c == '/' || *c == '\\') name = c + 1;
+        }
+        return name;
+    }
+
+    DWORD process_find_id(const char *process_name)
+    {
+        DIR *proc = opendir("/proc");
+        if (!proc) return 0;
+
+        DWORD result = 0;
+        while (dirent *entry = readdir(proc))
+        {
+            char *pid_end = nullptr;
+            const long pid = strtol(entry->d_name, &pid_end, 10);
+            if (*pid_end != '\0' || pid <= 0) continue;
+
+            char path[64];
+            snprintf(path, sizeof(path), "/proc/%ld/cmdline", pid);
+            FILE *cmdline = fopen(path, "r");
+            if (!cmdline) continue;
+
+            char command_line[PATH_MAX] = {};
+            const size_t length = fread(command_line, 1, sizeof(command_line) - 1, cmdline);
+            fclose(cmdline);
+            if (length == 0) continue; // Kernel threads.
+
+            // Only the first argument, the program itself.
+            if (strcasecmp(process_executable_name(command_line), process_name) == 0)
+            {
+                result = (DWORD) pid;
+                break;
+            }
+        }
+
+        closedir(proc);
+        return result;
+    }
+
+    DWORD process_current_id()
+    {
+        return (DWORD) getpid();
+    }
+
+    HANDLE process_open(DWORD process_id)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%u", (unsigned) process_id);
+        return process_id && access(path, F_OK) == 0 ? (HANDLE)(intptr_t) process_id : nullptr;
+    }
+
+    void process_close(HANDLE /*process_handle*/)
+    {
+        // Nothing is held open, the pid is the handle.
+    }
+
+    uint64_t process_creation_time(HANDLE process_handle)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%d/stat", (int) process_pid(process_handle));
+        FILE *stat = fopen(path, "r");
+        if (!stat) return 0;
+
+        char line[1024] = {};
+        const size_t length = fread(line, 1, sizeof(line) - 1, stat);
+        fclose(stat);
+        if (length == 0) return 0;
+
+        // The name of the program is in parentheses and may contain spaces, the fields are counted after it.
+        const char *field = strrchr(line, ')');
+        if (!field) return 0;
+
+        // starttime is the 22nd field, in clock ticks since boot, and the name is the 2nd.
+        for (int i = 2; i < 22 && field; i++) field = strchr(field + 1, ' ');
+        return field ? strtoull(field + 1, nullptr, 10) : 0;
+    }
+
+    // Looks up the region that contains address in the mappings: from the address to the end of its mapping, or to the next mapping if it is in a gap.
+    static bool process_region_from_maps(const std::vector<PROCESS_MAPPING>& mappings, OTHER_PROCESS_PTR address, PROCESS_REGION& region)
+    {
+        const uintptr_t begin = (uintptr_t) address;
+        const auto mapping = std::upper_bound(mappings.begin(), mappings.end(), begin, [](uintptr_t value, const PROCESS_MAPPING& m) { return value < m.end; });
+        if (mapping == mappings.end()) return false;
+
+        if (mapping->begin > begin) region = {address, mapping->begin - begin, false, false};
+        else region = {(OTHER_PROCESS_PTR) mapping->begin, mapping->end - mapping->begin, mapping->is_readable, mapping->is_private};
+        return true;
+    }
+
+    bool process_query_region(HANDLE process_handle, OTHER_PROCESS_PTR address, PROCESS_REGION& region)
+    {
+        return process_region_from_maps(process_read_maps(process_handle), address, region);
+    }
+
+    size_t process_query_region_batch(HANDLE process_handle, PROCESS_REGION_QUERY *queries, size_t query_count)
+    {
+        const std::vector<PROCESS_MAPPING> mappings = process_read_maps(process_handle);
+
+        size_t completed_count = 0;
+        for (size_t i = 0; i < query_count; i++)
+        {
+            queries[i].is_queried = process_region_from_maps(mappings, queries[i].address, queries[i].region);
+            completed_count += queries[i].is_queried;
+        }
+        return completed_count;
+    }
+
+    std::vector<PROCESS_REGION> process_list_regions(HANDLE process_handle, OTHER_PROCESS_PTR begin, OTHER_PROCESS_PTR end)
+    {
+        return process_regions_from_maps(process_read_maps(process_handle), (uintptr_t) begin, (uintptr_t) end);
+    }
+
+    bool process_read(HANDLE process_handle, OTHER_PROCESS_PTR address, void *destination, size_t size)
+    {
+        PROCESS_READ read = {address, destination, size, false};
+        return process_read_batch(process_handle, &read, 1) == 1;
+    }
+
+    size_t process_read_batch(HANDLE process_handle, PROCESS_READ *reads, size_t read_count)
+    {
+        const size_t max_reads_per_call = IOV_MAX;
+        std::vector<iovec> local_vectors, remote_vectors;
+
+        size_t completed_count = 0;
+        size_t next_read = 0;
+        while (next_read < read_count)
+        {
+            // process_vm_readv stops at the first read that fails, the batch is resumed after it.
+            const size_t call_read_count = std::min(read_count - next_read, max_reads_per_call);
+            local_vectors.resize(call_read_count);
+            remote_vectors.resize(call_read_count);
+            for (size_t i = 0; i < call_read_count; i++)
+            {
+                const PROCESS_READ& read = reads[next_read + i];
+                local_vectors[i] = {read.destination, read.size};
+                remote_vectors[i] = {read.address, read.size};
+            }
+
+            const ssize_t result = process_vm_readv(process_pid(process_handle), local_vectors.data(), call_read_count, remote_vectors.data(), call_read_count, 0);
+            size_t bytes_left = result > 0 ? (size_t) result : 0;
+
+            size_t i = 0;
+            for (; i < call_read_count && bytes_left >= reads[next_read + i].size; i++)
+            {
+                bytes_left -= reads[next_read + i].size;
+                reads[next_read + i].is_read = true;
+                completed_count++;
+            }
+
+            // The read the call stopped at, if it did, failed or was cut short.
+            if (i < call_read_count)
+            {
+                reads[next_read + i].is_read = false;
+                i++;
+            }
+            next_read += i;
+        }
+        return completed_count;
+    }
+
+    HOST_PROCESS_PTR host_allocate_zeroed(size_t size)
+    {
+        void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return memory == MAP_FAILED ? nullptr : (HOST_PROCESS_PTR) memory;
+    }
+
+    void host_free(HOST_PROCESS_PTR memory, size_t size)
+    {
+        if (memory) munmap(memory, size);
+    }
+
+    HOST_PROCESS_PTR host_map_file(const char *path, size_t& size)
+    {
+        size = 0;
+        const int file = open(path, O_RDONLY);
+        if (file < 0) return nullptr;
+
+        struct stat file_status;
+        void *view = MAP_FAILED;
+        if (fstat(file, &file_status) == 0 && file_status.st_size > 0)
+        {
+            // The mapping keeps the file alive, it can be closed right away.
+            view = mmap(nullptr, (size_t) file_status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (view != MAP_FAILED) size = (size_t) file_status.st_size;
+        }
+
+        close(file);
+        return view == MAP_FAILED ? nullptr : (HOST_PROCESS_PTR) view;
+    }
+
+    void host_unmap_file(HOST_PROCESS_PTR view, size_t size)
+    {
+        if (view) munmap(view, size);
+    }
+
+    std::string host_executable_directory()
+    {
+        char path[PATH_MAX];
+        const ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+        if (length <= 0 || (size_t) length >= sizeof(path)) return std::string();
+
+        const std::string executable_path(path, (size_t) length);
+        return executable_path.substr(0, executable_path.find_last_of('/') + 1);
+    }
+#endif
+
+#ifdef _WIN32
+    size_t process_query_region_batch(HANDLE process_handle, PROCESS_REGION_QUERY *queries, size_t query_count)
+    {
+        size_t completed_count = 0;
+        for (size_t i = 0; i < query_count; i++)
+        {
+            queries[i].is_queried = process_query_region(process_handle, queries[i].address, queries[i].region);
+            completed_count += queries[i].is_queried;
+        }
+        return completed_count;
+    }
+
+    std::vector<PROCESS_REGION> process_list_regions(HANDLE process_handle, OTHER_PROCESS_PTR begin, OTHER_PROCESS_PTR end)
+    {
+        std::vector<PROCESS_REGION> regions;
+        OTHER_PROCESS_PTR address = begin;
+        while (address < end)
+        {
+            PROCESS_REGION region;
+            if (!process_query_region(process_handle, address, region)) break;
+
+            const OTHER_PROCESS_PTR region_end = std::min(region.base_address + region.size, end);
+            if (region_end <= address) break;
+
+            regions.push_back({address, (SIZE_T)(region_end - address), region.is_readable, region.is_private});
+            address = region_end;
+        }
+        return regions;
+    }
+#endif
+
+#endif
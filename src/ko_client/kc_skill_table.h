@@ -0,0 +1,180 @@
+#ifndef KC_SKILL_TABLE_H
+#define KC_SKILL_TABLE_H
+#include "kc_cooldown_model.h"
+#include "kc_memutils.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief kc_skill_table.h
+ *
+ * Header only library that holds the skills the client knows about, as loaded from a skill table file.
+ * Used internally by the KO Client.
+ *
+ */
+
+/**
+ * @brief  SKILL_TABLE
+ *
+ * The skills in a structure of arrays: entry i of every array belongs to skill i, so that a pass over one attribute of
+ * every skill, such as their cooldown pointers when the state gather is built, is a loop over a single contiguous array.
+ *
+ * The table is loaded once from a text file, one skill per line, '#' starts a comment:
+ *   # name    page  key  priority  pattern
+ *   spike     F1    2    6         53 70 69 6B 65 00 ?? ?? ...
+ *
+ * - page, key: a digit, a letter, F1 to F24, or a virtual key code in hex (0x..).
+ * - priority: among the skills that are ready together, the highest is sent first. 0 keeps the skill out of the rotation.
+ * - pattern: the IDA style signature of the skill, see MASKED_PATTERN::parse.
+ *
+ * @code
+ *   SKILL_TABLE skills;
+ *   if (!skills.load("ardream_world_skills.cfg")) { ... }
+ *   size_t spike = skills.find("spike");
+ * @endcode
+ */
+class SKILL_TABLE
+{
+public:
+    static constexpr size_t max_skills = 16;            // Size of the cooldown arrays sampled for the table.
+    static constexpr float ready_cooldown = 1e-6f;      // A cooldown under this means the skill can be used.
+    static constexpr float unresolved_cooldown = 3600.0f; // Read for a skill whose cooldown pointer is not found yet, keeps it out of the rotation.
+
+    std::vector<std::string> names;
+    std::vector<MASKED_PATTERN> patterns;
+    std::vector<OTHER_PROCESS_PTR> cooldown_ptrs;      // Cooldown of each skill in the KO memory, null until resolved.
+    std::vector<uint16_t> pages;                        // Virtual key codes.
+    std::vector<uint16_t> keys;
+    std::vector<int32_t> priorities;
+    std::vector<COOLDOWN_MODEL> cooldown_models;        // Learned from the activations of each skill.
+
+    /**
+     * @brief Parses a virtual key name: a digit, a letter, F1 to F24, or a code in hex (0x..).
+     *
+     * @return 0 if the name is not a key.
+     */
+    static uint16_t parse_virtual_key(const std::string& name);
+
+    /**
+     * @brief Replaces the table with the skills of a skill table file.
+     *
+     * @return false if the file can't be read or a line is malformed, the table is then left empty.
+     */
+    bool load(const char *path);
+
+    /**
+     * @brief Replaces the table with the skills of the text of a skill table file.
+     *
+     * @param error Receives the line that could not be parsed, if any.
+     */
+    bool parse(const std::string& text, std::string *error = nullptr);
+
+    /**
+     * @brief Adds a skill at the end of the table.
+     *
+     * @return The index of the skill, SIZE_MAX if the table is full.
+     */
+    size_t add(const std::string& name, MASKED_PATTERN pattern, uint16_t page, uint16_t key, int32_t priority);
+
+    /**
+     * @return The index of the skill, SIZE_MAX if there is none with this name.
+     */
+    size_t find(const std::string& name) const;
+
+    [[nodiscard]] size_t size() const noexcept { return names.size(); }
+};
+
+#endif
+
+#ifdef KC_SKILL_TABLE_IMPLEMENTATION
+#pragma once
+#include <algorithm>
+#include <ctype.h>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+    uint16_t SKILL_TABLE::parse_virtual_key(const std::string& name)
+    {
+        if (name.size() == 1 && isalnum((unsigned char) name[0])) return (uint16_t) toupper((unsigned char) name[0]); // VK_0 to VK_9 and VK_A to VK_Z are their characters.
+
+        char *end = nullptr;
+        if ((name[0] == 'F' || name[0] == 'f') && name.size() <= 3)
+        {
+            const unsigned long function_key = strtoul(name.c_str() + 1, &end, 10);
+            if (*end == '\0' && function_key >= 1 && function_key <= 24) return (uint16_t) (0x70 + function_key - 1); // VK_F1 = 0x70.
+        }
+
+        if (name.size() > 2 && name[0] == '0' && (name[1] == 'x' || name[1] == 'X'))
+        {
+            const unsigned long code = strtoul(name.c_str() + 2, &end, 16);
+            if (*end == '\0' && code > 0 && code < 0xFF) return (uint16_t) code;
+        }
+        return 0;
+    }
+
+    bool SKILL_TABLE::load(const char *path)
+    {
+        *this = SKILL_TABLE();
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        std::stringstream text;
+        text << file.rdbuf();
+        return parse(text.str());
+    }
+
+    bool SKILL_TABLE::parse(const std::string& text, std::string *error)
+    {
+        *this = SKILL_TABLE();
+        std::istringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            const size_t comment = line.find('#');
+            if (comment != std::string::npos) line.erase(comment);
+            std::replace(line.begin(), line.end(), '\t', ' ');
+            line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+
+            std::istringstream fields(line);
+            std::string name, page, key, pattern_text;
+            int32_t priority = 0;
+            if (!(fields >> name)) continue; // Blank line.
+
+            MASKED_PATTERN pattern;
+            const bool is_well_formed = (fields >> page >> key >> priority) && std::getline(fields >> std::ws, pattern_text)
+                                        && parse_virtual_key(page) && parse_virtual_key(key) && MASKED_PATTERN::parse(pattern_text.c_str(), pattern);
+
+            if (!is_well_formed || find(name) != SIZE_MAX || add(name, std::move(pattern), parse_virtual_key(page), parse_virtual_key(key), priority) == SIZE_MAX)
+            {
+                if (error) *error = line;
+                *this = SKILL_TABLE();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t SKILL_TABLE::add(const std::string& name, MASKED_PATTERN pattern, uint16_t page, uint16_t key, int32_t priority)
+    {
+        if (size() >= max_skills) return SIZE_MAX;
+
+        names.push_back(name);
+        patterns.push_back(std::move(pattern));
+        cooldown_ptrs.push_back(nullptr);
+        pages.push_back(page);
+        keys.push_back(key);
+        priorities.push_back(priority);
+        cooldown_models.emplace_back();
+        return size() - 1;
+    }
+
+    size_t SKILL_TABLE::find(const std::string& name) const
+    {
+        const auto it = std::find(names.begin(), names.end(), name);
+        return it == names.end() ? SIZE_MAX : (size_t) (it - names.begin());
+    }
+
+#endif
@@ -0,0 +1,717 @@
+#ifndef KC_VALUE_SCANNER_H
+#define KC_VALUE_SCANNER_H
+#include "kc_memutils.h"
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief kc_value_scanner.h
+ *
+ * Header only library that searches the memory of another process for values instead of byte patterns: a first scan
+ * finds every aligned value that passes a test, then each next scan narrows these candidates down as the values change
+ * in the game. This is how the offsets of KO_MEMORY_CONFIG are found again after a patch, before new byte patterns are
+ * captured around them: a cooldown float that decreases, an HP uint32 that equals what the game shows.
+ *
+ */
+
+/**
+ * @brief Types of the values a VALUE_SCANNER looks for. Every type is 4 bytes long, and aligned on 4 bytes.
+ */
+enum class SCAN_VALUE_TYPE : uint8_t
+{
+    INT32,
+    UINT32,
+    FLOAT32
+};
+
+/**
+ * @brief The tests a scan can make on a value.
+ */
+enum class VALUE_TEST : uint8_t
+{
+    BETWEEN,   // low <= value <= high. Exact values and floats within an epsilon are ranges too.
+    CHANGED,   // The value differs from the previous scan, bit for bit. Only for the next scans, like the tests below.
+    UNCHANGED, // The value is the same as in the previous scan, bit for bit.
+    INCREASED, // value > previous value.
+    DECREASED  // value < previous value.
+};
+
+/**
+ * @brief The test of a scan, and its operands. The operands are converted to the type of the scanner: rounded inwards
+ *        for the integer types, so that between(0.5, 3) finds 1, 2 and 3.
+ *
+ * @code
+ *   scanner.first_scan(memory, VALUE_PREDICATE::equals(1234));          // The HP the game shows.
+ *   scanner.first_scan(memory, VALUE_PREDICATE::near(9.5, 0.5));         // A cooldown of about 9.5 seconds.
+ *   scanner.next_scan(process_handle, VALUE_PREDICATE::decreased());
+ * @endcode
+ */
+struct VALUE_PREDICATE
+{
+    VALUE_TEST test;
+    double low = 0;  // Operands of BETWEEN.
+    double high = 0;
+
+    static VALUE_PREDICATE equals(double value) { return {VALUE_TEST::BETWEEN, value, value}; }
+    static VALUE_PREDICATE between(double low, double high) { return {VALUE_TEST::BETWEEN, low, high}; }
+    static VALUE_PREDICATE near(double value, double epsilon) { return {VALUE_TEST::BETWEEN, value - epsilon, value + epsilon}; }
+    static VALUE_PREDICATE changed() { return {VALUE_TEST::CHANGED}; }
+    static VALUE_PREDICATE unchanged() { return {VALUE_TEST::UNCHANGED}; }
+    static VALUE_PREDICATE increased() { return {VALUE_TEST::INCREASED}; }
+    static VALUE_PREDICATE decreased() { return {VALUE_TEST::DECREASED}; }
+};
+
+/**
+ * @brief A value found by a VALUE_SCANNER, as it was at the last scan.
+ */
+struct VALUE_CANDIDATE
+{
+    OTHER_PROCESS_PTR address;
+    uint32_t value_bits;
+
+    inline int32_t as_int32() const { return (int32_t) value_bits; }
+    inline uint32_t as_uint32() const { return value_bits; }
+    inline float as_float() const { float value; memcpy(&value, &value_bits, sizeof(value)); return value; }
+};
+
+/**
+ * @brief  VALUE_SCANNER
+ *
+ * Finds the aligned values of a type that pass a sequence of tests, over the memory of another process.
+ *
+ * The candidates are kept per page, in a block that holds one bit per aligned value of the page and the values of the
+ * candidates at the last scan, one after the other in address order. The pages without a candidate are dropped, so a
+ * first scan that matches millions of values of a 1 GB window costs 4 bytes per candidate plus a bitmap of 128 bytes
+ * per page that has one, and the next scans only visit these pages.
+ *
+ * A page is tested with SIMD compare kernels that turn 8 (AVX2) or 4 (SSE2) values into bits of the bitmap at once,
+ * the engine being chosen like the one of memmem. The pages that are left with a few candidates are tested one
+ * candidate at a time instead.
+ *
+ * The first scan reads a PROCESS_MEMORY copy of the window. A next scan can read another copy, or read only the pages
+ * that still hold candidates straight from the process, which is much cheaper once the candidates are narrowed down.
+ *
+ * @code
+ *   VALUE_SCANNER scanner(SCAN_VALUE_TYPE::UINT32);
+ *   PROCESS_MEMORY memory(process_handle, heap_base_address, GB_TO_BYTES(1), true);
+ *   scanner.first_scan(memory, VALUE_PREDICATE::equals(current_hp));
+ *   // ... take a hit in the game, then:
+ *   scanner.next_scan(process_handle, VALUE_PREDICATE::decreased());
+ *   for (const VALUE_CANDIDATE& candidate : scanner.candidates(16)) { ... }
+ * @endcode
+ */
+class VALUE_SCANNER
+{
+public:
+    static constexpr size_t value_size = 4;
+    static constexpr size_t block_size = KB_TO_BYTES(4); // Range of addresses of a block of candidates, a page.
+    static constexpr size_t block_slots = block_size / value_size;
+    static constexpr size_t block_words = block_slots / 64;
+    static constexpr uint32_t sparse_block_count = block_slots / 16; // Under this many candidates, a block is tested one candidate at a time.
+
+private:
+    // The candidates of a page.
+    struct CANDIDATE_BLOCK
+    {
+        OTHER_PROCESS_PTR base_address; // Aligned on block_size.
+        size_t first_value; // Index of the value of the first candidate in values, the values of the others follow it.
+        uint32_t count;
+        uint64_t bits[block_words]; // Bit i stands for the value at base_address + i * value_size.
+    };
+
+    // The operands of a BETWEEN test, as bits of the scanned type.
+    struct VALUE_RANGE
+    {
+        uint32_t low;
+        uint32_t high;
+        bool is_empty; // No value of the type is in the range, such as between(0.2, 0.8) for an integer.
+    };
+
+    SCAN_VALUE_TYPE type;
+    MEMMEM_ENGINE engine;
+    std::vector<CANDIDATE_BLOCK> blocks; // Sorted by address.
+    std::vector<uint32_t> values; // The values of the candidates at the last scan, block after block.
+    size_t candidate_count = 0;
+    bool is_scanned = false;
+
+    VALUE_RANGE to_range(const VALUE_PREDICATE& predicate) const;
+
+    // Tests the slots of a page that are set in mask, and appends a block of those that pass to next_blocks.
+    // previous is the block they were candidates of, or nullptr for a first scan.
+    void scan_block(OTHER_PROCESS_PTR base_address, const uint8_t *page, const uint64_t *mask, const CANDIDATE_BLOCK *previous,
+                    const VALUE_PREDICATE& predicate, const VALUE_RANGE& range,
+                    std::vector<CANDIDATE_BLOCK>& next_blocks, std::vector<uint32_t>& next_values) const;
+
+    // Replaces the candidates with the next ones.
+    size_t commit(std::vector<CANDIDATE_BLOCK>& next_blocks, std::vector<uint32_t>& next_values);
+
+public:
+    /**
+     * @param type The type of the values to look for.
+     * @param engine (Optional) The compare kernels to use, see MEMMEM_ENGINE. Falls back to what the CPU supports.
+     */
+    explicit VALUE_SCANNER(SCAN_VALUE_TYPE type, MEMMEM_ENGINE engine = memmem_active_engine());
+
+    /**
+     * @brief Finds every aligned value of the copied memory that passes a BETWEEN test, in place of the candidates.
+     *
+     * @return size_t The number of candidates.
+     */
+    size_t first_scan(const PROCESS_MEMORY& memory, const VALUE_PREDICATE& predicate);
+
+    /**
+     * @brief Keeps the candidates that pass a test, as read from another copy of the memory. A candidate that the copy
+     *        misses is dropped.
+     *
+     * @return size_t The number of candidates left.
+     */
+    size_t next_scan(const PROCESS_MEMORY& memory, const VALUE_PREDICATE& predicate);
+
+    /**
+     * @brief Keeps the candidates that pass a test, reading only the pages that hold candidates from the process.
+     *        The candidates of a page that can't be read anymore are dropped.
+     *
+     * @param process_handle handle to the process, needs PROCESS_VM_READ access
+     * @return size_t The number of candidates left.
+     */
+    size_t next_scan(HANDLE process_handle, const VALUE_PREDICATE& predicate);
+
+    /**
+     * @brief Forgets the candidates, the next scan has to be a first scan.
+     */
+    void reset();
+
+    /**
+     * @brief Returns the candidates with their value at the last scan, in address order.
+     *
+     * @param max_count (Optional) Stops after this many.
+     */
+    std::vector<VALUE_CANDIDATE> candidates(size_t max_count = SIZE_MAX) const;
+
+    inline size_t size() const { return candidate_count; }
+    inline bool has_scanned() const { return is_scanned; }
+    inline SCAN_VALUE_TYPE value_type() const { return type; }
+};
+
+/**
+ * @brief Compares the compare kernels of every engine the CPU supports with a value at a time, on random pages.
+ *
+ * @param iteration_count Number of random pages tested for every type and test.
+ * @return true if they all agree.
+ */
+bool value_scan_self_test(size_t iteration_count = 2000);
+
+#endif
+
+#ifdef KC_VALUE_SCANNER_IMPLEMENTATION
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+    // The test of a single value, the reference of the kernels.
+    static bool value_passes(SCAN_VALUE_TYPE type, VALUE_TEST test, uint32_t value, uint32_t previous, uint32_t low, uint32_t high)
+    {
+        if (test == VALUE_TEST::CHANGED) return value != previous;
+        if (test == VALUE_TEST::UNCHANGED) return value == previous;
+
+        if (type == SCAN_VALUE_TYPE::FLOAT32)
+        {
+            float v, p, l, h;
+            memcpy(&v, &value, 4);
+            memcpy(&p, &previous, 4);
+            memcpy(&l, &low, 4);
+            memcpy(&h, &high, 4);
+            switch (test)
+            {
+                case VALUE_TEST::INCREASED: return v > p;
+                case VALUE_TEST::DECREASED: return v < p;
+                default: return v >= l && v <= h;
+            }
+        }
+
+        // Signed compares, the unsigned values are shifted into the range of int32.
+        const uint32_t bias = type == SCAN_VALUE_TYPE::UINT32 ? 0x80000000u : 0;
+        const int32_t v = (int32_t) (value ^ bias), p = (int32_t) (previous ^ bias), l = (int32_t) (low ^ bias), h = (int32_t) (high ^ bias);
+        switch (test)
+        {
+            case VALUE_TEST::INCREASED: return v > p;
+            case VALUE_TEST::DECREASED: return v < p;
+            default: return v >= l && v <= h;
+        }
+    }
+
+    // Sets the bits of the slots of a page that pass the test, one value at a time.
+    static void value_test_page_scalar(SCAN_VALUE_TYPE type, VALUE_TEST test, const uint8_t *page, const uint32_t *previous, uint32_t low, uint32_t high, uint64_t *bits)
+    {
+        for (size_t word = 0; word < VALUE_SCANNER::block_words; word++)
+        {
+            uint64_t word_bits = 0;
+            for (size_t bit = 0; bit < 64; bit++)
+            {
+                const size_t slot = word * 64 + bit;
+                uint32_t value;
+                memcpy(&value, page + slot * VALUE_SCANNER::value_size, sizeof(value));
+                if (value_passes(type, test, value, previous ? previous[slot] : 0, low, high)) word_bits |= 1ull << bit;
+            }
+            bits[word] = word_bits;
+        }
+    }
+
+#if defined(KC_MEMUTILS_X86) && defined(__GNUC__)
+    #define KC_VALUE_SCANNER_SIMD 1
+
+    // 4 values per step, 16 steps per word of the bitmap.
+    __attribute__((target("sse2")))
+    static void value_test_page_sse2(SCAN_VALUE_TYPE type, VALUE_TEST test, const uint8_t *page, const uint32_t *previous, uint32_t low, uint32_t high, uint64_t *bits)
+    {
+        const bool is_float = type == SCAN_VALUE_TYPE::FLOAT32;
+        const __m128i bias = _mm_set1_epi32(type == SCAN_VALUE_TYPE::UINT32 ? (int) 0x80000000u : 0);
+        const __m128i low_int = _mm_xor_si128(_mm_set1_epi32((int) low), bias);
+        const __m128i high_int = _mm_xor_si128(_mm_set1_epi32((int) high), bias);
+        const __m128 low_float = _mm_castsi128_ps(_mm_set1_epi32((int) low));
+        const __m128 high_float = _mm_castsi128_ps(_mm_set1_epi32((int) high));
+
+        for (size_t word = 0; word < VALUE_SCANNER::block_words; word++)
+        {
+            uint64_t word_bits = 0;
+            for (size_t step = 0; step < 16; step++)
+            {
+                const size_t slot = word * 64 + step * 4;
+                const __m128i value = _mm_loadu_si128((const __m128i *)(page + slot * VALUE_SCANNER::value_size));
+                const __m128i previous_value = previous ? _mm_loadu_si128((const __m128i *)(previous + slot)) : _mm_setzero_si128();
+
+                __m128i passes;
+                switch (test)
+                {
+                    case VALUE_TEST::CHANGED: passes = _mm_xor_si128(_mm_cmpeq_epi32(value, previous_value), _mm_set1_epi32(-1)); break;
+                    case VALUE_TEST::UNCHANGED: passes = _mm_cmpeq_epi32(value, previous_value); break;
+                    case VALUE_TEST::INCREASED:
+                        passes = is_float ? _mm_castps_si128(_mm_cmpgt_ps(_mm_castsi128_ps(value), _mm_castsi128_ps(previous_value)))
+                                          : _mm_cmpgt_epi32(_mm_xor_si128(value, bias), _mm_xor_si128(previous_value, bias));
+                        break;
+                    case VALUE_TEST::DECREASED:
+                        passes = is_float ? _mm_castps_si128(_mm_cmplt_ps(_mm_castsi128_ps(value), _mm_castsi128_ps(previous_value)))
+                                          : _mm_cmplt_epi32(_mm_xor_si128(value, bias), _mm_xor_si128(previous_value, bias));
+                        break;
+                    default:
+                        if (is_float) passes = _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(_mm_castsi128_ps(value), low_float), _mm_cmple_ps(_mm_castsi128_ps(value), high_float)));
+                        else
+                        {
+                            const __m128i biased = _mm_xor_si128(value, bias);
+                            passes = _mm_xor_si128(_mm_or_si128(_mm_cmplt_epi32(biased, low_int), _mm_cmpgt_epi32(biased, high_int)), _mm_set1_epi32(-1));
+                        }
+                        break;
+                }
+                word_bits |= (uint64_t) _mm_movemask_ps(_mm_castsi128_ps(passes)) << (step * 4);
+            }
+            bits[word] = word_bits;
+        }
+    }
+
+    // 8 values per step, 8 steps per word of the bitmap.
+    __attribute__((target("avx2")))
+    static void value_test_page_avx2(SCAN_VALUE_TYPE type, VALUE_TEST test, const uint8_t *page, const uint32_t *previous, uint32_t low, uint32_t high, uint64_t *bits)
+    {
+        const bool is_float = type == SCAN_VALUE_TYPE::FLOAT32;
+        const __m256i bias = _mm256_set1_epi32(type == SCAN_VALUE_TYPE::UINT32 ? (int) 0x80000000u : 0);
+        const __m256i low_int = _mm256_xor_si256(_mm256_set1_epi32((int) low), bias);
+        const __m256i high_int = _mm256_xor_si256(_mm256_set1_epi32((int) high), bias);
+        const __m256 low_float = _mm256_castsi256_ps(_mm256_set1_epi32((int) low));
+        const __m256 high_float = _mm256_castsi256_ps(_mm256_set1_epi32((int) high));
+
+        for (size_t word = 0; word < VALUE_SCANNER::block_words; word++)
+        {
+            uint64_t word_bits = 0;
+            for (size_t step = 0; step < 8; step++)
+            {
+                const size_t slot = word * 64 + step * 8;
+                const __m256i value = _mm256_loadu_si256((const __m256i *)(page + slot * VALUE_SCANNER::value_size));
+                const __m256i previous_value = previous ? _mm256_loadu_si256((const __m256i *)(previous + slot)) : _mm256_setzero_si256();
+
+                __m256i passes;
+                switch (test)
+                {
+                    case VALUE_TEST::CHANGED: passes = _mm256_xor_si256(_mm256_cmpeq_epi32(value, previous_value), _mm256_set1_epi32(-1)); break;
+                    case VALUE_TEST::UNCHANGED: passes = _mm256_cmpeq_epi32(value, previous_value); break;
+                    case VALUE_TEST::INCREASED:
+                        passes = is_float ? _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(value), _mm256_castsi256_ps(previous_value), _CMP_GT_OQ))
+                                          : _mm256_cmpgt_epi32(_mm256_xor_si256(value, bias), _mm256_xor_si256(previous_value, bias));
+                        break;
+                    case VALUE_TEST::DECREASED:
+                        passes = is_float ? _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(value), _mm256_castsi256_ps(previous_value), _CMP_LT_OQ))
+                                          : _mm256_cmpgt_epi32(_mm256_xor_si256(previous_value, bias), _mm256_xor_si256(value, bias));
+                        break;
+                    default:
+                        if (is_float)
+                        {
+                            const __m256 value_float = _mm256_castsi256_ps(value);
+                            passes = _mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(value_float, low_float, _CMP_GE_OQ), _mm256_cmp_ps(value_float, high_float, _CMP_LE_OQ)));
+                        }
+                        else
+                        {
+                            const __m256i biased = _mm256_xor_si256(value, bias);
+                            passes = _mm256_xor_si256(_mm256_or_si256(_mm256_cmpgt_epi32(low_int, biased), _mm256_cmpgt_epi32(biased, high_int)), _mm256_set1_epi32(-1));
+                        }
+                        break;
+                }
+                word_bits |= (uint64_t) _mm256_movemask_ps(_mm256_castsi256_ps(passes)) << (step * 8);
+            }
+            bits[word] = word_bits;
+        }
+    }
+#endif
+
+    // Tests every slot of a page with the kernel of an engine.
+    static void value_test_page(MEMMEM_ENGINE engine, SCAN_VALUE_TYPE type, VALUE_TEST test, const uint8_t *page, const uint32_t *previous, uint32_t low, uint32_t high, uint64_t *bits)
+    {
+        switch (engine)
+        {
+#ifdef KC_VALUE_SCANNER_SIMD
+            case MEMMEM_ENGINE::AVX2: value_test_page_avx2(type, test, page, previous, low, high, bits); return;
+            case MEMMEM_ENGINE::SSE2: value_test_page_sse2(type, test, page, previous, low, high, bits); return;
+#endif
+            default: value_test_page_scalar(type, test, page, previous, low, high, bits); return;
+        }
+    }
+
+    static bool value_engine_is_supported(MEMMEM_ENGINE engine)
+    {
+#ifdef KC_VALUE_SCANNER_SIMD
+        switch (engine)
+        {
+            case MEMMEM_ENGINE::AVX2: return __builtin_cpu_supports("avx2");
+            case MEMMEM_ENGINE::SSE2: return __builtin_cpu_supports("sse2");
+            default: return true;
+        }
+#else
+        return engine == MEMMEM_ENGINE::SCALAR;
+#endif
+    }
+
+    VALUE_SCANNER::VALUE_SCANNER(SCAN_VALUE_TYPE type, MEMMEM_ENGINE engine) : type(type), engine(engine)
+    {
+        if (this->engine == MEMMEM_ENGINE::AVX2 && !value_engine_is_supported(MEMMEM_ENGINE::AVX2)) this->engine = MEMMEM_ENGINE::SSE2;
+        if (this->engine == MEMMEM_ENGINE::SSE2 && !value_engine_is_supported(MEMMEM_ENGINE::SSE2)) this->engine = MEMMEM_ENGINE::SCALAR;
+    }
+
+    VALUE_SCANNER::VALUE_RANGE VALUE_SCANNER::to_range(const VALUE_PREDICATE& predicate) const
+    {
+        VALUE_RANGE range {0, 0, false};
+        if (predicate.test != VALUE_TEST::BETWEEN) return range;
+
+        if (this->type == SCAN_VALUE_TYPE::FLOAT32)
+        {
+            const float low = (float) predicate.low, high = (float) predicate.high;
+            memcpy(&range.low, &low, sizeof(low));
+            memcpy(&range.high, &high, sizeof(high));
+            range.is_empty = !(low <= high);
+            return range;
+        }
+
+        const double type_min = this->type == SCAN_VALUE_TYPE::INT32 ? (double) INT32_MIN : 0.0;
+        const double type_max = this->type == SCAN_VALUE_TYPE::INT32 ? (double) INT32_MAX : (double) UINT32_MAX;
+        const double low = std::max(std::ceil(predicate.low), type_min);
+        const double high = std::min(std::floor(predicate.high), type_max);
+        range.is_empty = !(low <= high);
+        if (range.is_empty) return range;
+
+        if (this->type == SCAN_VALUE_TYPE::INT32)
+        {
+            range.low = (uint32_t) (int32_t) low;
+            range.high = (uint32_t) (int32_t) high;
+        }
+        else
+        {
+            range.low = (uint32_t) low;
+            range.high = (uint32_t) high;
+        }
+        return range;
+    }
+
+    void VALUE_SCANNER::scan_block(OTHER_PROCESS_PTR base_address, const uint8_t *page, const uint64_t *mask, const CANDIDATE_BLOCK *previous,
+                                   const VALUE_PREDICATE& predicate, const VALUE_RANGE& range,
+                                   std::vector<CANDIDATE_BLOCK>& next_blocks, std::vector<uint32_t>& next_values) const
+    {
+        CANDIDATE_BLOCK block;
+        block.base_address = base_address;
+        block.first_value = next_values.size();
+        block.count = 0;
+
+        if (previous && previous->count < sparse_block_count)
+        {
+            // Too few candidates for the kernels to pay off.
+            const uint32_t *previous_value = this->values.data() + previous->first_value;
+            for (size_t word = 0; word < block_words; word++)
+            {
+                block.bits[word] = 0;
+                for (uint64_t candidates = previous->bits[word]; candidates; candidates &= candidates - 1, previous_value++)
+                {
+                    const size_t bit = (size_t) __builtin_ctzll(candidates);
+                    if (!(mask[word] >> bit & 1)) continue;
+
+                    uint32_t value;
+                    memcpy(&value, page + (word * 64 + bit) * value_size, sizeof(value));
+                    if (!value_passes(this->type, predicate.test, value, *previous_value, range.low, range.high)) continue;
+
+                    block.bits[word] |= 1ull << bit;
+                    next_values.push_back(value);
+                }
+            }
+        }
+        else
+        {
+            // The previous values, spread back to the slots they were read from.
+            alignas(32) uint32_t spread_values[block_slots];
+            const bool is_relative = previous && predicate.test != VALUE_TEST::BETWEEN;
+            if (is_relative)
+            {
+                const uint32_t *previous_value = this->values.data() + previous->first_value;
+                for (size_t word = 0; word < block_words; word++)
+                {
+                    for (uint64_t candidates = previous->bits[word]; candidates; candidates &= candidates - 1)
+                        spread_values[word * 64 + (size_t) __builtin_ctzll(candidates)] = *previous_value++;
+                }
+            }
+
+            value_test_page(this->engine, this->type, predicate.test, page, is_relative ? spread_values : nullptr, range.low, range.high, block.bits);
+
+            size_t count = 0;
+            for (size_t word = 0; word < block_words; word++)
+            {
+                block.bits[word] &= previous ? mask[word] & previous->bits[word] : mask[word];
+                count += (size_t) __builtin_popcountll(block.bits[word]);
+            }
+
+            // A first scan can keep most of the values of a page, they are copied without a check of the capacity each.
+            next_values.resize(next_values.size() + count);
+            uint32_t *next_value = next_values.data() + block.first_value;
+            for (size_t word = 0; word < block_words; word++)
+            {
+                for (uint64_t candidates = block.bits[word]; candidates; candidates &= candidates - 1)
+                    memcpy(next_value++, page + (word * 64 + (size_t) __builtin_ctzll(candidates)) * value_size, value_size);
+            }
+        }
+
+        block.count = (uint32_t) (next_values.size() - block.first_value);
+        if (block.count) next_blocks.push_back(block);
+    }
+
+    size_t VALUE_SCANNER::commit(std::vector<CANDIDATE_BLOCK>& next_blocks, std::vector<uint32_t>& next_values)
+    {
+        this->blocks.swap(next_blocks);
+        this->values.swap(next_values);
+        this->candidate_count = this->values.size();
+        this->is_scanned = true;
+        return this->candidate_count;
+    }
+
+    size_t VALUE_SCANNER::first_scan(const PROCESS_MEMORY& memory, const VALUE_PREDICATE& predicate)
+    {
+        SYSTRACE_SCOPE("VALUE_SCANNER::first_scan");
+        reset();
+        const VALUE_RANGE range = to_range(predicate);
+        std::vector<CANDIDATE_BLOCK> next_blocks;
+        std::vector<uint32_t> next_values;
+        if (predicate.test != VALUE_TEST::BETWEEN || range.is_empty) return commit(next_blocks, next_values);
+
+        uint64_t full_mask[block_words];
+        std::fill(full_mask, full_mask + block_words, ~0ull);
+
+        alignas(32) uint8_t partial_page[block_size];
+        for (const MAPPED_REGION& region : memory.mapped_regions())
+        {
+            const uintptr_t region_begin = (uintptr_t) region.base_address;
+            const uintptr_t region_end = region_begin + region.size;
+            const uint8_t *region_copy = memory.other_ptr_to_host(region.base_address);
+
+            for (uintptr_t block_begin = region_begin & ~(uintptr_t) (block_size - 1); block_begin < region_end; block_begin += block_size)
+            {
+                if (block_begin >= region_begin && block_begin + block_size <= region_end)
+                {
+                    scan_block((OTHER_PROCESS_PTR) block_begin, region_copy + (block_begin - region_begin), full_mask, nullptr, predicate, range, next_blocks, next_values);
+                    continue;
+                }
+
+                // A page the region only covers a part of, only the values that are whole within the region are tested.
+                const uintptr_t begin = std::max(block_begin, region_begin);
+                const uintptr_t end = std::min(block_begin + block_size, region_end);
+                uint64_t mask[block_words] = {};
+                memset(partial_page, 0, sizeof(partial_page));
+                memcpy(partial_page + (begin - block_begin), region_copy + (begin - region_begin), end - begin);
+                for (size_t slot = (begin - block_begin + value_size - 1) / value_size; (slot + 1) * value_size <= end - block_begin; slot++) mask[slot / 64] |= 1ull << (slot % 64);
+
+                scan_block((OTHER_PROCESS_PTR) block_begin, partial_page, mask, nullptr, predicate, range, next_blocks, next_values);
+            }
+        }
+
+        // Two regions can share a page, its blocks are merged back into one.
+        size_t merged_count = 0;
+        for (size_t i = 0; i < next_blocks.size(); i++)
+        {
+            if (merged_count && next_blocks[merged_count - 1].base_address == next_blocks[i].base_address)
+            {
+                CANDIDATE_BLOCK& merged = next_blocks[merged_count - 1];
+                std::vector<uint32_t> merged_values;
+                const uint32_t *first_values = next_values.data() + merged.first_value;
+                const uint32_t *second_values = next_values.data() + next_blocks[i].first_value;
+                for (size_t word = 0; word < block_words; word++)
+                {
+                    for (uint64_t candidates = merged.bits[word] | next_blocks[i].bits[word]; candidates; candidates &= candidates - 1)
+                        merged_values.push_back((merged.bits[word] >> __builtin_ctzll(candidates) & 1) ? *first_values++ : *second_values++);
+                    merged.bits[word] |= next_blocks[i].bits[word];
+                }
+                // The two blocks are the last ones written, their values are contiguous.
+                std::copy(merged_values.begin(), merged_values.end(), next_values.begin() + merged.first_value);
+                merged.count += next_blocks[i].count;
+                continue;
+            }
+            next_blocks[merged_count++] = next_blocks[i];
+        }
+        next_blocks.resize(merged_count);
+
+        return commit(next_blocks, next_values);
+    }
+
+    size_t VALUE_SCANNER::next_scan(const PROCESS_MEMORY& memory, const VALUE_PREDICATE& predicate)
+    {
+        SYSTRACE_SCOPE("VALUE_SCANNER::next_scan");
+        if (!this->is_scanned) return first_scan(memory, predicate);
+
+        const VALUE_RANGE range = to_range(predicate);
+        std::vector<CANDIDATE_BLOCK> next_blocks;
+        std::vector<uint32_t> next_values;
+        if (predicate.test == VALUE_TEST::BETWEEN && range.is_empty) return commit(next_blocks, next_values);
+
+        uint64_t full_mask[block_words];
+        std::fill(full_mask, full_mask + block_words, ~0ull);
+
+        alignas(32) uint8_t partial_page[block_size];
+        for (const CANDIDATE_BLOCK& block : this->blocks)
+        {
+            // Copied whole in a single run in the common case, else gathered value by value.
+            const uint8_t *first = memory.other_ptr_to_host(block.base_address);
+            const uint8_t *last = memory.other_ptr_to_host(block.base_address + block_size - 1);
+            if (first && last == first + block_size - 1)
+            {
+                scan_block(block.base_address, first, full_mask, &block, predicate, range, next_blocks, next_values);
+                continue;
+            }
+
+            uint64_t mask[block_words] = {};
+            memset(partial_page, 0, sizeof(partial_page));
+            for (size_t slot = 0; slot < block_slots; slot++)
+            {
+                const uint8_t *value_first = memory.other_ptr_to_host(block.base_address + slot * value_size);
+                const uint8_t *value_last = memory.other_ptr_to_host(block.base_address + slot * value_size + value_size - 1);
+                if (!value_first || value_last != value_first + value_size - 1) continue;
+
+                memcpy(partial_page + slot * value_size, value_first, value_size);
+                mask[slot / 64] |= 1ull << (slot % 64);
+            }
+            scan_block(block.base_address, partial_page, mask, &block, predicate, range, next_blocks, next_values);
+        }
+
+        return commit(next_blocks, next_values);
+    }
+
+    size_t VALUE_SCANNER::next_scan(HANDLE process_handle, const VALUE_PREDICATE& predicate)
+    {
+        SYSTRACE_SCOPE("VALUE_SCANNER::next_scan");
+        const VALUE_RANGE range = to_range(predicate);
+        std::vector<CANDIDATE_BLOCK> next_blocks;
+        std::vector<uint32_t> next_values;
+        if (!this->is_scanned || (predicate.test == VALUE_TEST::BETWEEN && range.is_empty)) return commit(next_blocks, next_values);
+
+        uint64_t full_mask[block_words];
+        std::fill(full_mask, full_mask + block_words, ~0ull);
+
+        // The pages are read in batches, a single system call per batch on Linux.
+        const size_t batch_block_count = 256;
+        std::vector<uint8_t> pages(batch_block_count * block_size);
+        std::vector<PROCESS_READ> reads;
+        for (size_t batch_begin = 0; batch_begin < this->blocks.size(); batch_begin += batch_block_count)
+        {
+            const size_t batch_end = std::min(batch_begin + batch_block_count, this->blocks.size());
+            reads.clear();
+            for (size_t i = batch_begin; i < batch_end; i++) reads.push_back({this->blocks[i].base_address, pages.data() + (i - batch_begin) * block_size, block_size, false});
+            process_read_batch(process_handle, reads.data(), reads.size());
+
+            for (size_t i = batch_begin; i < batch_end; i++)
+            {
+                if (reads[i - batch_begin].is_read) scan_block(this->blocks[i].base_address, pages.data() + (i - batch_begin) * block_size, full_mask, &this->blocks[i], predicate, range, next_blocks, next_values);
+            }
+        }
+
+        return commit(next_blocks, next_values);
+    }
+
+    void VALUE_SCANNER::reset()
+    {
+        this->blocks.clear();
+        this->values.clear();
+        this->candidate_count = 0;
+        this->is_scanned = false;
+    }
+
+    std::vector<VALUE_CANDIDATE> VALUE_SCANNER::candidates(size_t max_count) const
+    {
+        std::vector<VALUE_CANDIDATE> result;
+        for (const CANDIDATE_BLOCK& block : this->blocks)
+        {
+            const uint32_t *value = this->values.data() + block.first_value;
+            for (size_t word = 0; word < block_words; word++)
+            {
+                for (uint64_t candidates = block.bits[word]; candidates; candidates &= candidates - 1)
+                {
+                    if (result.size() >= max_count) return result;
+                    result.push_back({block.base_address + (word * 64 + (size_t) __builtin_ctzll(candidates)) * value_size, *value++});
+                }
+            }
+        }
+        return result;
+    }
+
+    bool value_scan_self_test(size_t iteration_count)
+    {
+        std::mt19937 rng(0x4B4F);
+        const SCAN_VALUE_TYPE types[] = {SCAN_VALUE_TYPE::INT32, SCAN_VALUE_TYPE::UINT32, SCAN_VALUE_TYPE::FLOAT32};
+        const VALUE_TEST tests[] = {VALUE_TEST::BETWEEN, VALUE_TEST::CHANGED, VALUE_TEST::UNCHANGED, VALUE_TEST::INCREASED, VALUE_TEST::DECREASED};
+        const MEMMEM_ENGINE engines[] = {MEMMEM_ENGINE::SSE2, MEMMEM_ENGINE::AVX2};
+
+        // Values drawn from a few of each kind, so that equal values, sign changes, NaNs and infinities all come up.
+        const uint32_t specials[] = {0, 1, 2, 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFFu, 0x3F800000u /* 1.0f */, 0xBF800000u /* -1.0f */,
+                                     0x7F800000u /* inf */, 0xFF800000u /* -inf */, 0x7FC00000u /* NaN */, 0x00000001u /* denormal */};
+        auto draw = [&]() { return rng() % 2 ? specials[rng() % (sizeof(specials) / sizeof(specials[0]))] : (uint32_t) rng() % 8 ? (uint32_t) rng() % 16 : (uint32_t) rng(); };
+
+        std::vector<uint32_t> page(VALUE_SCANNER::block_slots), previous(VALUE_SCANNER::block_slots);
+        uint64_t expected[VALUE_SCANNER::block_words], bits[VALUE_SCANNER::block_words];
+        for (size_t iteration = 0; iteration < iteration_count; iteration++)
+        {
+            for (size_t i = 0; i < page.size(); i++)
+            {
+                previous[i] = draw();
+                page[i] = rng() % 4 ? previous[i] : draw();
+            }
+
+            for (SCAN_VALUE_TYPE type : types)
+            {
+                for (VALUE_TEST test : tests)
+                {
+                    uint32_t low = draw(), high = draw();
+                    value_test_page_scalar(type, test, (const uint8_t *) page.data(), previous.data(), low, high, expected);
+                    for (MEMMEM_ENGINE engine : engines)
+                    {
+                        if (!value_engine_is_supported(engine)) continue;
+                        value_test_page(engine, type, test, (const uint8_t *) page.data(), previous.data(), low, high, bits);
+                        if (memcmp(bits, expected, sizeof(bits)) != 0) return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+#endif
@@ -2,15 +2,26 @@
 #define KO_CLIENT_H
 #include "../syscore/syscore.h"
 #include "config/ardream_world_memory_config.h"
+#include "kc_address_cache.h"
+#include "kc_cooldown_model.h"
 #include "kc_memutils.h"
+#include "kc_skill_table.h"
+#include "kc_value_scanner.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstddef>
+#include <future>
 #include <iostream>
 #include <iterator>
+#include <mutex>
 #include <stdint.h>
+#include <string>
 #include <tchar.h>
-#include <tlhelp32.h>
+#include <thread>
+#include <vector>
 
 enum class PLAYER_RACE : uint8_t
 {
@@ -18,6 +29,30 @@ enum class PLAYER_RACE : uint8_t
      EL_MORAD = 38      // EL MORAD identification byte.
 };
 
+/**
+ * @brief The values of the player that the rotation reads every tick,
+ * filled at once by KO_CLIENT::read_player_state.
+ */
+struct PLAYER_STATE
+{
+     float cooldowns[SKILL_TABLE::max_skills];     // Indexed like the skill table.
+
+     uint32_t max_hp;
+     uint32_t cur_hp;
+     uint32_t max_mp;
+     uint32_t cur_mp;
+};
+
+/**
+ * @brief A PLAYER_STATE sampled by the state poller, and when it was sampled.
+ */
+struct PLAYER_SNAPSHOT
+{
+     PLAYER_STATE                          state;
+     std::chrono::steady_clock::time_point sampled_at;       // Right after the values were read.
+     uint64_t                              sample_index;     // 0 for the first sample of a poller run.
+};
+
 /**
  * @class KnightOnline
  *
@@ -36,203 +71,130 @@ class KO_CLIENT
      HANDLE process_handle;
      DWORD  process_id;
 
-     PLAYER_RACE player_race;
+     std::atomic<PLAYER_RACE> player_race {PLAYER_RACE::KARUS};     // Assigned by the pointer resolver, before the skill pointers.
+
+     // Names, patterns, cooldown pointers, keys and cooldown models of the skills, loaded from the skill table file.
+     SKILL_TABLE skills;
+
+     KO_MEM_ADR player_max_hp_ptr = nullptr;
+     KO_MEM_ADR player_cur_hp_ptr = nullptr;
+     KO_MEM_ADR player_max_mp_ptr = nullptr;
+     KO_MEM_ADR player_cur_mp_ptr = nullptr;
 
-     KO_MEM_ADR spike_cooldown_ptr;
-     KO_MEM_ADR thrust_cooldown_ptr;
-     KO_MEM_ADR pierce_cooldown_ptr;
-     KO_MEM_ADR cut_cooldown_ptr;
-     KO_MEM_ADR shock_cooldown_ptr;
-     KO_MEM_ADR jab_cooldown_ptr;
-     KO_MEM_ADR stab_cooldown_ptr;
-     KO_MEM_ADR stab2_cooldown_ptr;
-     KO_MEM_ADR stroke_cooldown_ptr;
+     REMOTE_GATHER player_state_gather;           // Reads every resolved pointer above in a few coalesced spans.
+     std::mutex    player_state_gather_mutex;     // Held while the gather is read, or replaced by the pointer resolver.
 
-     KO_MEM_ADR player_max_hp_ptr;
-     KO_MEM_ADR player_cur_hp_ptr;
-     KO_MEM_ADR player_max_mp_ptr;
-     KO_MEM_ADR player_cur_mp_ptr;
+     // The pointers above are resolved in the background, from the construction on.
+     std::thread                           pointer_resolver;
+     std::atomic<bool>                     is_pointer_resolver_stopping {false};
+     std::atomic<bool>                     is_skill_ptr_resolved[SKILL_TABLE::max_skills] {};     // Set once the cooldown pointer of the skill is found.
+     std::atomic<bool>                     is_player_ptr_resolved {false};                        // Set once the health and mana pointers are found.
+     std::vector<std::promise<bool>>       skill_resolution_promises;
+     std::vector<std::shared_future<bool>> skill_resolutions;     // true if the cooldown pointer of the skill was found.
+     std::promise<void>                    resolution_done_promise;
+     std::shared_future<void>              resolution_done;
+
+     SEQLOCK<PLAYER_SNAPSHOT> player_state_snapshot;               // Published by the state poller, read by the getters.
+     std::thread              state_poller;                        // Samples the player state while it runs.
+     std::atomic<bool>        is_state_poller_active {false};      // Getters read the snapshot while set.
+     std::atomic<bool>        is_state_poller_stopping {false};
+
+     mutable INPUT_INJECTOR input_injector;     // Presses the skill keys while the cooldowns are watched.
 
      // Method Section
                                                                            private:
      /**
-   * @brief Get the process ID by matching the process name.
+   * @brief Finds the player race from the match of the nation identification
+   * pattern.
    *
-   * This function retrieves the process ID of a running process by matching
-   * its name with the provided process_name. Returns 0 if it fails.
-   *
-   * @param process_name
-   * @return DWORD
+   * @param nation_target The nation identification pattern, after the scan
+   * @param conf Reference to the KO memory config
+   * @return PLAYER_RACE
    */
-     DWORD get_process_id_by_client_name(const char* process_name);
+     PLAYER_RACE find_player_race(const PATTERN_SCAN_TARGET& nation_target, KO_MEMORY_CONFIG& conf);
 
      /**
-   * @brief Finds the player race from the KO memory and returns it.
+   * @brief A generic function that finds the skill cooldown among the matches
+   * of a skill byte pattern.
+   *
+   * Skill patterns have one copy per nation, the copy whose nation byte
+   * matches the player race is picked.
    *
-   * @param ko_memory_ref Reference to the mapped KO memory object
+   * @param skill_target The skill byte pattern, after the scan
+   * @param skill_name Name of the skill in the skill table, for the logs
    * @param conf Reference to the KO memory config
-   * @return PLAYER_RACE
+   * @return KO_MEM_ADR A pointer to the cooldown of the skill, expressed in
+   * the address space of KnighOnline. nullptr if the pattern wasn't found, or
+   * if none of its copies matches the player race.
    */
-     PLAYER_RACE find_player_race(PROCESS_MEMORY& ko_memory_ref, KO_MEMORY_CONFIG& conf);
+     KO_MEM_ADR find_skill_cooldown_ptr_generic(const PATTERN_SCAN_TARGET& skill_target, const std::string& skill_name, KO_MEMORY_CONFIG& conf);
 
      /**
-   * @brief A generic function that finds the skill cooldown by searching a
-   * skill byte pattern.
+   * @brief  Assigns the player health and mana pointers from the match of
+   * their anchor pattern.
    *
-   * @param ko_memory_ref Reference to the mapped KO memory object
-   * @param conf Reference to the KO memory config
-   * @param skill_byte_pattern Pointer to the beginning of the byte pattern to
-   * search
-   * @param byte_pattern_size Size of the pattern to search for
-   * @return KO_MEM_ADR A pointer to the first match to the pattern, expressed
-   * in the address space of KnighOnline.
+   * @param anchor_target The health and mana anchor pattern, after the scan
+   * @param conf
+   */
+     void assign_player_health_and_mana_ptr(const PATTERN_SCAN_TARGET& anchor_target, KO_MEMORY_CONFIG& conf);
+
+     /**
+   * @brief Resolves the pointers, run by the pointer resolver thread.
+   *
+   * The targets that the address cache still knows are published at once.
+   * The skills of the resolution order then get a pass over the heap each,
+   * the first one together with the nation pattern since every skill pointer
+   * depends on the race, and every other target shares a last pass. The
+   * pointers found by a pass are published as soon as it completes.
+   *
+   * @param resolution_order Indices of the skills to resolve first, in order
    */
-     KO_MEM_ADR find_skill_cooldown_ptr_generic(PROCESS_MEMORY& ko_memory_ref, KO_MEMORY_CONFIG& conf, KO_MEM_BYTE* skill_byte_pattern, size_t byte_pattern_size);
+     void resolve_pointers(std::vector<size_t> resolution_order);
 
 /**
- * @brief A utility macro to call find_skill_cooldown_ptr_generic for a skill
- * name.
+ * @brief A utility macro to register the pointer of a PLAYER_STATE field in
+ * a player state gather.
  */
-#define find_skill_cooldown_ptr(ko_memory_ref, conf, skill_name) find_skill_cooldown_ptr_generic(ko_memory_ref, conf, conf.skill_name##_byte_pattern, sizeof(conf.skill_name##_byte_pattern));
+#define gather_player_state_field(gather, field_name, pointer) gather.add(pointer, offsetof(PLAYER_STATE, field_name), sizeof(PLAYER_STATE::field_name))
 
      /**
-   * @brief  Finds the patterns for the player health and mana information in
-   * the KO memory, and assings them to member variables.
-   *
-   * @param ko_memory_ref
-   * @param conf
+   * @brief Reads the player state through the gather. The skills that are
+   * not resolved yet read as SKILL_TABLE::unresolved_cooldown.
    */
-     void assign_player_health_and_mana_ptr(PROCESS_MEMORY& ko_memory_ref, KO_MEMORY_CONFIG& conf);
+     void gather_player_state(PLAYER_STATE& state) noexcept;
 
      /**
-    * @brief Sends the specified skill with a retry mechanism to handle cooldown
-    * inconsistencies.
-    *
-    * This function monitors and handles cooldown inconsistencies, automatically
-    * retrying if necessary.
-    *
-    * @tparam skill The skill to be sent.
-    *
-    * @warning Assumes the existence of `float get_##skill##_cooldown()` and
-    * `void send_raw_key(int key)`.
-    *
-    * @note Keeps track of the last x amount of previous cooldowns to ensure a
-    * consistent decrease.
-    *
-    * This mechanism is designed to address issues when attempting to use a skill
-    * while the previous skill's action is still ongoing. In such cases, the skill
-    * activation may initially fail, causing the cooldown to spike to a maximum
-    * value (e.g., 10 seconds), only to rapidly decrease to a negligible value
-    * (epsilon) once the action is completed in a split second.
-    *
-    * Fast execution of this process results in a series of cooldown values, for
-    * instance:
-    *   - 10.9293
-    *   - 10.9495
-    *   - 10.0291
-    *
-    * The algorithm systematically examines the last x cooldown values to verify if
-    * they exhibit a consistent decrease. A consistent decrease indicates
-    * successful skill activation, allowing the system to proceed to the next skill
-    * confidently.
-    */
-#define DEFINE_SEND_SKILL_UNTIL_IN_COOLDOWN_FUNC(skill)                                                                                                                                                \
-     bool send_##skill##_until_in_cooldown( ) const noexcept                                                                                                                                           \
-     {                                                                                                                                                                                                 \
-          const float epsilon                       = 1e-6; /* Tolerance for floating-point number comparison */                                                                                       \
-          const int   previous_cooldowns_count      = 3;    /* Number of previous cooldowns to consider */                                                                                             \
-          const int   input_overwhelm_protection_ms = 50;   /* Protect against input lag */                                                                                                            \
-          const int   max_duration_ms               = 3000; /* Timeout in ms */                                                                                                                        \
-                                                                                                                                                                                                       \
-          float current_cooldown = get_##skill##_cooldown( );                                                                                                                                          \
-          float previous_cooldown;                                                                                                                                                                     \
-          int   previous_decreasing_cooldown_count = 0; /* Track previous cooldowns */                                                                                                                 \
-          auto  start_time                         = std::chrono::high_resolution_clock::now( );                                                                                                       \
-                                                                                                                                                                                                       \
-          if(current_cooldown > epsilon)                                                                                                                                                               \
-          {                                                                                                                                                                                            \
-               return false;                                                                                                                                                                           \
-          } /* If skill is in cooldown, return */                                                                                                                                                      \
-                                                                                                                                                                                                       \
-          while(true)                                                                                                                                                                                  \
-          {                                                                                                                                                                                            \
-               send_multiple_keys(skill##_page, skill##_key); /* Attempt to activate the skill */                                                                                                      \
-               previous_cooldown = current_cooldown;                                                                                                                                                   \
-               current_cooldown  = get_##skill##_cooldown( ); /* Get current cooldown */                                                                                                               \
-                                                                                                                                                                                                       \
-               Sleep(input_overwhelm_protection_ms);                                                                                                                                                   \
-                                                                                                                                                                                                       \
-               const bool is_previous_cooldown_bigger_than_current_cooldown = previous_cooldown - current_cooldown > epsilon;                                                                          \
-                                                                                                                                                                                                       \
-               if(is_previous_cooldown_bigger_than_current_cooldown) /* Skill is active and cooldown is decreasing */                                                                                  \
-               {                                                                                                                                                                                       \
-                    previous_decreasing_cooldown_count++; /* Track decreasing cooldown count */                                                                                                        \
-               }                                                                                                                                                                                       \
-               else                                                                                                                                                                                    \
-               {                                                                                                                                                                                       \
-                    previous_decreasing_cooldown_count = 0; /* If the trail fails, start again */                                                                                                      \
-                    continue;                                                                                                                                                                          \
-               }                                                                                                                                                                                       \
-                                                                                                                                                                                                       \
-               bool is_cooldown_consistently_decreasing = previous_decreasing_cooldown_count == previous_cooldowns_count;                                                                              \
-                                                                                                                                                                                                       \
-               if(is_cooldown_consistently_decreasing) /* X amount of previous cooldowns is decreasing */                                                                                              \
-               {                                                                                                                                                                                       \
-                    send_raw_key(VK_R);                                                                                                                                                                \
-                    return true;                                                                                                                                                                       \
-               }                                                                                                                                                                                       \
-                                                                                                                                                                                                       \
-               auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now( ) - start_time);                                                     \
-                                                                                                                                                                                                       \
-               if(elapsed_time.count( ) >= max_duration_ms)                                                                                                                                            \
-               {                                                                                                                                                                                       \
-                    return false;                                                                                                                                                                      \
-               } /* Timeout */                                                                                                                                                                         \
-          }                                                                                                                                                                                            \
-     }
+   * @brief Reads the player state and publishes it to the snapshot.
+   *
+   * @param sample_index Index of the sample within the poller run
+   */
+     void publish_player_state_sample(uint64_t sample_index);
 
-/**
- * @brief A utility macro to define getter functions that read addresses from
- * the KO memory and returns them as float.
- */
-#define DEFINE_FLOAT_GETTER_FUNC(function_name, variable_name)                                                                                                                                         \
-     [[nodiscard]] inline float function_name( ) const noexcept                                                                                                                                        \
-     {                                                                                                                                                                                                 \
-          float f;                                                                                                                                                                                     \
-          ReadProcessMemory(process_handle, variable_name, &f, sizeof(f), NULL);                                                                                                                       \
-          return f;                                                                                                                                                                                    \
-     }
+     /**
+   * @brief Samples the cooldown of a skill, from the state poller snapshot if
+   * it runs, from the KO memory otherwise. The sample is kept in the skill
+   * table.
+   *
+   * @param skill The index of the skill in the skill table
+   * @param first_press_time The time the sample is dated from
+   * @return COOLDOWN_SAMPLE
+   */
+     COOLDOWN_SAMPLE sample_cooldown(size_t skill, std::chrono::steady_clock::time_point first_press_time) noexcept;
 
 /**
  * @brief A utility macro to define getter functions that read addresses from
  * the KO memory and returns them as uint32.
  */
-#define DEFINE_UINT32_GETTER_FUNC(function_name, variable_name)                                                                                                                                        \
+#define DEFINE_UINT32_GETTER_FUNC(function_name, variable_name, state_field_name)                                                                                                                      \
      [[nodiscard]] inline uint32_t function_name( ) const noexcept                                                                                                                                     \
      {                                                                                                                                                                                                 \
+          if(is_state_poller_running( )) return player_state_snapshot.load( ).state.state_field_name; /* Sampled by the poller, no system call */                                                      \
+          if(!is_player_resolved( )) return 0;                                                                                                                                                         \
           uint32_t i;                                                                                                                                                                                  \
-          ReadProcessMemory(process_handle, variable_name, &i, sizeof(i), NULL);                                                                                                                       \
+          process_read(process_handle, variable_name, &i, sizeof(i));                                                                                                                                  \
           return i;                                                                                                                                                                                    \
      }
 
-/**
- * @brief Defines getter and sender functions for a specific skill.
- *
- * This macro creates a pair of functions for a given skill: a getter to retrieve
- * the cooldown value and a sender to report skill hits based on cooldown status.
- * The getter is generated using DEFINE_FLOAT_GETTER_FUNC, and the sender using
- * DEFINE_SEND_SKILL_FUNC.
- *
- * @param skill The skill's name for which to define functions.
- *
- * @note The getter retrieves cooldown using the skill's associated variable,
- * and the sender uses the getter to determine hit reports (COOLDOWN or READY)
- * based on the current cooldown status.
- */
-#define DEFINE_SKILL_FUNCTIONS(skill)                                                                                                                                                                  \
-     DEFINE_FLOAT_GETTER_FUNC(get_##skill##_cooldown, skill##_cooldown_ptr); /*ie. defines get_spike_cooldown*/                                                                                        \
-     DEFINE_SEND_SKILL_UNTIL_IN_COOLDOWN_FUNC(skill)                         /*ie. defines send_spike_until_in_cooldown*/
-
                                                                            public:
      /**
    * @brief Construct a new KnightOnline object and initialize process-related
@@ -242,33 +204,147 @@ class KO_CLIENT
    * initializes essential process-related data. It first attempts to find the
    * "KnightOnLine.exe" process and waits for its identification, with a
    * maximum retry interval of 1 second between attempts. Once the process is
-   * identified, it opens a handle to the process, and resolves the memory
-   * address for pointers, process handle and ID.
+   * identified, it opens a handle to the process, loads the skill table and
+   * starts to resolve the pointers in the background: the client is usable
+   * right away, each skill as soon as its pointer is known, see
+   * is_skill_resolved.
+   *
+   * @param resolve_first Names of the skills to resolve first, in order. Each
+   * one may cost a pass over the heap of its own. By default, the skill of
+   * the highest priority is resolved first.
    */
-     KO_CLIENT( );
+     explicit KO_CLIENT(const std::vector<std::string>& resolve_first = { });
 
      ~KO_CLIENT( );
 
      [[nodiscard]] DWORD       get_process_id( ) const noexcept { return process_id; }
      [[nodiscard]] HANDLE      get_process_handle( ) const noexcept { return process_handle; }
-     [[nodiscard]] PLAYER_RACE get_player_race( ) const noexcept { return player_race; }
-
-     DEFINE_SKILL_FUNCTIONS(spike);
-     DEFINE_SKILL_FUNCTIONS(thrust);
-     DEFINE_SKILL_FUNCTIONS(pierce);
-     DEFINE_SKILL_FUNCTIONS(jab);
-     DEFINE_SKILL_FUNCTIONS(cut);
-     DEFINE_SKILL_FUNCTIONS(shock);
-     DEFINE_SKILL_FUNCTIONS(stab);
-     DEFINE_SKILL_FUNCTIONS(stab2);
-     DEFINE_SKILL_FUNCTIONS(stroke);
+     [[nodiscard]] PLAYER_RACE get_player_race( ) const noexcept { return player_race.load( ); }
+
+     /**
+   * @brief Whether the cooldown pointer of a skill is resolved. Until then,
+   * the skill can't be sent and its cooldown reads as
+   * SKILL_TABLE::unresolved_cooldown.
+   *
+   * @param skill The index of the skill in the skill table
+   */
+     [[nodiscard]] bool is_skill_resolved(size_t skill) const noexcept { return is_skill_ptr_resolved[skill].load(std::memory_order_acquire); }
+
+     /**
+   * @brief Returns a future that is ready once the resolution of a skill is
+   * over: true if its cooldown pointer was found, false if it wasn't.
+   *
+   * @param skill The index of the skill in the skill table
+   */
+     [[nodiscard]] std::shared_future<bool> get_skill_resolution(size_t skill) const { return skill_resolutions[skill]; }
+
+     /**
+   * @brief Whether the health and mana pointers are resolved. Until then, the
+   * health and mana read as zero.
+   */
+     [[nodiscard]] bool is_player_resolved( ) const noexcept { return is_player_ptr_resolved.load(std::memory_order_acquire); }
+
+     /**
+   * @brief Waits until every pointer is resolved, or known to be missing.
+   */
+     void wait_until_resolved( ) const { resolution_done.wait( ); }
+
+     /**
+   * @brief Reads the cooldowns, health and mana of the player at once.
+   *
+   * A single batch of reads of the spans of nearby values, instead of one
+   * system call per getter. Values that could not be read are zero.
+   *
+   * @return PLAYER_STATE
+   */
+     [[nodiscard]] PLAYER_STATE read_player_state( ) noexcept;
+
+     /**
+   * @brief Starts a thread that samples the player state at a fixed rate.
+   *
+   * While it runs, the getters and read_player_state return the values of
+   * the last sample: plain loads from local memory, no system call, and all
+   * the values of a sample were read together. The first sample is taken
+   * before this function returns.
+   *
+   * @param period Time between two samples. Keep it well under the 50 ms the
+   * send functions wait between two cooldown reads.
+   */
+     void start_state_poller(std::chrono::microseconds period = std::chrono::milliseconds(5));
+
+     /**
+   * @brief Stops the state poller, the getters read the KO memory again.
+   */
+     void stop_state_poller( );
+
+     [[nodiscard]] bool is_state_poller_running( ) const noexcept { return is_state_poller_active.load(std::memory_order_acquire); }
+
+     /**
+   * @brief Returns the last sample of the state poller, with its timestamp.
+   * Zero if the poller never ran.
+   */
+     [[nodiscard]] PLAYER_SNAPSHOT get_player_snapshot( ) const noexcept { return player_state_snapshot.load( ); }
+
+     /**
+   * @brief Whether a cooldown read from the KO memory means that the skill can
+   * be used. Same tolerance as send_skill_until_in_cooldown.
+   */
+     [[nodiscard]] static constexpr bool is_cooldown_ready(float cooldown) noexcept { return cooldown <= SKILL_TABLE::ready_cooldown; }
+
+     /**
+   * @brief Returns the skill table, loaded from the skill table file of the
+   * memory config.
+   */
+     [[nodiscard]] const SKILL_TABLE& get_skill_table( ) const noexcept { return skills; }
+
+     /**
+   * @brief Returns the cooldown of a skill, from the state poller snapshot if
+   * it runs, from the KO memory otherwise.
+   *
+   * @param skill The index of the skill in the skill table
+   */
+     [[nodiscard]] float get_skill_cooldown(size_t skill) const noexcept;
+
+     /**
+    * @brief Sends a skill with a retry mechanism to handle cooldown
+    * inconsistencies.
+    *
+    * This mechanism is designed to address issues when attempting to use a skill
+    * while the previous skill's action is still ongoing. In such cases, the skill
+    * activation may initially fail, causing the cooldown to spike to a maximum
+    * value (e.g., 10 seconds), only to rapidly decrease to a negligible value
+    * (epsilon) once the action is completed in a split second.
+    *
+    * Fast execution of this process results in a series of cooldown values, for
+    * instance:
+    *   - 10.9293
+    *   - 10.9495
+    *   - 10.0291
+    *
+    * Until the cooldown model of the skill is trained, the last x cooldown values
+    * are examined, 50 ms apart, to verify that they exhibit a consistent
+    * decrease. A consistent decrease indicates successful skill activation.
+    * Every confirmed activation trains the model.
+    *
+    * Once it is trained, the cooldown is watched at the rate of the state
+    * poller after each press, and a single sample that decays from the rise the
+    * way the model expects confirms the activation. A spike that collapses
+    * decays far too fast for the model. If the skill changed and the model
+    * doesn't fit anymore, a cooldown that stays up and decreases for as long as
+    * the trail above still confirms the activation, and retrains the model.
+    *
+    * @param skill The index of the skill in the skill table
+    * @return true if the skill was activated, false if it was in cooldown
+    * already or the activation timed out.
+    */
+     bool send_skill_until_in_cooldown(size_t skill) noexcept;
 
      // Player (Maybe later we can expand this to have a macro called
      // DEFINE_PLAYER_FUNCTIONS)
-     DEFINE_UINT32_GETTER_FUNC(get_player_max_hp, player_max_hp_ptr);
-     DEFINE_UINT32_GETTER_FUNC(get_player_cur_hp, player_cur_hp_ptr);
-     DEFINE_UINT32_GETTER_FUNC(get_player_max_mp, player_max_mp_ptr);
-     DEFINE_UINT32_GETTER_FUNC(get_player_cur_mp, player_cur_mp_ptr);
+     DEFINE_UINT32_GETTER_FUNC(get_player_max_hp, player_max_hp_ptr, max_hp);
+     DEFINE_UINT32_GETTER_FUNC(get_player_cur_hp, player_cur_hp_ptr, cur_hp);
+     DEFINE_UINT32_GETTER_FUNC(get_player_max_mp, player_max_mp_ptr, max_mp);
+     DEFINE_UINT32_GETTER_FUNC(get_player_cur_mp, player_cur_mp_ptr, cur_mp);
 
      inline void print_info( ) const noexcept;
 };
@@ -278,106 +354,128 @@ class KO_CLIENT
 #ifdef KO_CLIENT_IMPLEMENTATION
 #pragma once
 
+#define KC_PROCESS_BACKEND_IMPLEMENTATION 1
+#include "kc_process_backend.h"
+
 #define KC_MEMUTILS_IMPLEMENTATION 1
 #include "kc_memutils.h"
 
-KO_CLIENT::KO_CLIENT( )
-{
-     process_id = get_process_id_by_client_name("KnightOnLine.exe");
+#define KC_ADDRESS_CACHE_IMPLEMENTATION 1
+#include "kc_address_cache.h"
 
-     // TODO: Add Safety Features
-     process_handle = OpenProcess(PROCESS_ALL_ACCESS, FALSE, process_id);
+#define KC_COOLDOWN_MODEL_IMPLEMENTATION 1
+#include "kc_cooldown_model.h"
 
-     // Map the process memory to search for patterns in it
-     double const ko_address_space_heap_starts_at = 0.2;     // GB (via manual inspection using vmmap)
-     double const ko_address_space_heap_size      = 1;       // GB (via manual inspection using vmmap)
-     KO_MEM_ADR   heap_base_address               = (KO_MEM_ADR) GB_TO_BYTES(ko_address_space_heap_starts_at);
-     uint64_t     bytes_to_map                    = GB_TO_BYTES(ko_address_space_heap_size);
+#define KC_SKILL_TABLE_IMPLEMENTATION 1
+#include "kc_skill_table.h"
 
-     PROCESS_MEMORY   ko_memory {process_handle, heap_base_address, bytes_to_map};
-     KO_MEMORY_CONFIG ko_memory_config;
+#define KC_VALUE_SCANNER_IMPLEMENTATION 1
+#include "kc_value_scanner.h"
 
-     // Assign the pointers
-     player_race = find_player_race(ko_memory, ko_memory_config);
+KO_CLIENT::KO_CLIENT(const std::vector<std::string>& resolve_first)
+{
+     SYSTRACE_SCOPE("KO_CLIENT::KO_CLIENT");
+#ifdef DEBUG
+     // The scanner relies on memmem, and the value scanner on its page tests: make sure every engine this CPU can run agrees with the reference.
+     assert(memmem_self_test( ));
+     assert(value_scan_self_test( ));
+#endif
 
-     spike_cooldown_ptr  = find_skill_cooldown_ptr(ko_memory, ko_memory_config, spike);
-     thrust_cooldown_ptr = find_skill_cooldown_ptr(ko_memory, ko_memory_config, thrust);
-     pierce_cooldown_ptr = find_skill_cooldown_ptr(ko_memory, ko_memory_config, pierce);
-     cut_cooldown_ptr    = find_skill_cooldown_ptr(ko_memory, ko_memory_config, cut);
-     shock_cooldown_ptr  = find_skill_cooldown_ptr(ko_memory, ko_memory_config, shock);
-     jab_cooldown_ptr    = find_skill_cooldown_ptr(ko_memory, ko_memory_config, jab);
-     stab2_cooldown_ptr  = find_skill_cooldown_ptr(ko_memory, ko_memory_config, stab2);
-     stab_cooldown_ptr   = find_skill_cooldown_ptr(ko_memory, ko_memory_config, stab);
-     stroke_cooldown_ptr = find_skill_cooldown_ptr(ko_memory, ko_memory_config, stroke);
+     process_id = process_find_id("KnightOnLine.exe");
 
-     assign_player_health_and_mana_ptr(ko_memory, ko_memory_config);
-}
+     // TODO: Add Safety Features
+     process_handle = process_open(process_id);
 
-KO_CLIENT::~KO_CLIENT( ) { CloseHandle(process_handle); }
+     KO_MEMORY_CONFIG ko_memory_config;
+     if(!skills.load(ko_memory_config.skill_table_path)) SYSLOG_ERRORF("Can't load the skill table {}\n", ko_memory_config.skill_table_path);
 
-DWORD KO_CLIENT::get_process_id_by_client_name(const char* process_name)
-{
-     // TODO: Add Safety Features
-     HANDLE snapshot_handle = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-     if(snapshot_handle == INVALID_HANDLE_VALUE)
+     std::vector<size_t> resolution_order;
+     for(const std::string& name : resolve_first)
      {
-          return 0;
+          const size_t skill = skills.find(name);
+          if(skill == SIZE_MAX) SYSLOG_WARNF("Can't resolve the unknown skill {} first\n", name.c_str( ));
+          else resolution_order.push_back(skill);
      }
+     if(resolve_first.empty( ) && skills.size( ) > 0) resolution_order.push_back((size_t) (std::max_element(skills.priorities.begin( ), skills.priorities.end( )) - skills.priorities.begin( )));
 
-     PROCESSENTRY32 process_entry { };
-     process_entry.dwSize = sizeof(PROCESSENTRY32);
+     // Nothing is resolved yet, the gather reads nothing and every skill is in cooldown.
+     player_state_gather = REMOTE_GATHER(process_handle);
 
-     DWORD result = 0;
-     while(Process32Next(snapshot_handle, &process_entry))
-     {
-          if(_stricmp(process_entry.szExeFile, process_name) == 0)
-          {
-               result = process_entry.th32ProcessID;
-               break;
-          }
-     }
+     skill_resolution_promises.resize(skills.size( ));
+     for(std::promise<bool>& promise : skill_resolution_promises) skill_resolutions.push_back(promise.get_future( ).share( ));
+     resolution_done = resolution_done_promise.get_future( ).share( );
 
-     CloseHandle(snapshot_handle);
-     return result;
+     pointer_resolver = std::thread(&KO_CLIENT::resolve_pointers, this, std::move(resolution_order));
 }
 
-PLAYER_RACE KO_CLIENT::find_player_race(PROCESS_MEMORY& ko_memory_ref, KO_MEMORY_CONFIG& conf)
+KO_CLIENT::~KO_CLIENT( )
 {
-     KO_MEM_ADR result = ko_memory_ref.find_pattern_in_memory(conf.player_nation_identification_byte_pattern, conf.KO_STRING_LENGTH_IN_BYTES);
+     stop_state_poller( );
 
-     result += conf.player_nation_identification_offset_from_pattern;
+     // The pass that is running completes, the passes after it are skipped.
+     is_pointer_resolver_stopping = true;
+     if(pointer_resolver.joinable( )) pointer_resolver.join( );
 
-     KO_MEM_BYTE nation_byte;
-     ReadProcessMemory(process_handle, result, &nation_byte, sizeof(nation_byte), NULL);
+     process_close(process_handle);
+}
+
+PLAYER_RACE KO_CLIENT::find_player_race(const PATTERN_SCAN_TARGET& nation_target, KO_MEMORY_CONFIG& conf)
+{
+     KO_MEM_BYTE nation_byte = 0;
+     if(!nation_target.matches.empty( ))
+     {
+          KO_MEM_ADR result = nation_target.matches.front( ) + conf.player_nation_identification_offset_from_pattern;
+          process_read(process_handle, result, &nation_byte, sizeof(nation_byte));
+     }
 
      switch(nation_byte)
      {
           case conf.player_nation_human: return PLAYER_RACE::EL_MORAD;
           case conf.player_nation_karus: return PLAYER_RACE::KARUS;
           default:
-               assert(1);     // TODO: do something about this.
+               if(nation_target.matches.empty( ))
+               {
+                    SYSLOG_WARNF("The player_nation_identification_byte_pattern signature wasn't found, assuming Karus\n");
+               }
+               else
+               {
+                    SYSLOG_WARNF("Unknown nation byte {} after the player_nation_identification_byte_pattern signature, assuming Karus\n", (uint32_t) nation_byte);
+               }
                return PLAYER_RACE::KARUS;
      }
 }
 
-KO_MEM_ADR KO_CLIENT::find_skill_cooldown_ptr_generic(PROCESS_MEMORY& ko_memory_ref, KO_MEMORY_CONFIG& conf, KO_MEM_BYTE* skill_byte_pattern, size_t byte_pattern_size)
+KO_MEM_ADR KO_CLIENT::find_skill_cooldown_ptr_generic(const PATTERN_SCAN_TARGET& skill_target, const std::string& skill_name, KO_MEMORY_CONFIG& conf)
 {
-     KO_MEM_ADR result = ko_memory_ref.find_pattern_in_memory(skill_byte_pattern, byte_pattern_size);
+     if(skill_target.matches.empty( ))
+     {
+          SYSLOG_WARNF("The signature of the skill {} wasn't found, it won't be used\n", skill_name.c_str( ));
+          return nullptr;
+     }
 
-     KO_MEM_ADR  nation_byte_adr = result + conf.skill_nation_identification_offset_from_pattern;
-     KO_MEM_BYTE nation_byte;
-     ReadProcessMemory(process_handle, nation_byte_adr, &nation_byte, sizeof(nation_byte), NULL);
+     for(KO_MEM_ADR result : skill_target.matches)
+     {
+          KO_MEM_ADR  nation_byte_adr = result + conf.skill_nation_identification_offset_from_pattern;
+          KO_MEM_BYTE nation_byte = 0;
+          process_read(process_handle, nation_byte_adr, &nation_byte, sizeof(nation_byte));
 
-     // If not the first match, then it's the second match.
-     if(nation_byte != (KO_MEM_BYTE) player_race)
-          result = ko_memory_ref.find_pattern_in_memory(skill_byte_pattern, byte_pattern_size, result + 1);
+          if(nation_byte == (KO_MEM_BYTE) player_race.load( )) return result + conf.skill_cooldown_offset_from_pattern;
+     }
 
-     return result + conf.skill_cooldown_offset_from_pattern;
+     // A copy that doesn't identify as the player's nation belongs to the other one, its cooldown isn't the player's.
+     SYSLOG_WARNF("No copy of the skill {} matches the player's nation, it won't be used\n", skill_name.c_str( ));
+     return nullptr;
 }
 
-void KO_CLIENT::assign_player_health_and_mana_ptr(PROCESS_MEMORY& ko_memory_ref, KO_MEMORY_CONFIG& conf)
+void KO_CLIENT::assign_player_health_and_mana_ptr(const PATTERN_SCAN_TARGET& anchor_target, KO_MEMORY_CONFIG& conf)
 {
-     KO_MEM_ADR result = ko_memory_ref.find_pattern_in_memory(conf.mana_hp_anchor_byte_pattern, sizeof(conf.mana_hp_anchor_byte_pattern));
+     if(anchor_target.matches.empty( ))
+     {
+          SYSLOG_WARNF("The mana_hp_anchor_byte_pattern signature wasn't found, the health and mana read as 0\n");
+          return;
+     }
+
+     KO_MEM_ADR result = anchor_target.matches.front( );
 
      player_max_hp_ptr = result + conf.max_hp_offset_from_pattern;
      player_cur_hp_ptr = result + conf.current_hp_offset_from_pattern;
@@ -386,6 +484,341 @@ void KO_CLIENT::assign_player_health_and_mana_ptr(PROCESS_MEMORY& ko_memory_ref,
      player_cur_mp_ptr = result + conf.current_mana_offset_from_pattern;
 }
 
+void KO_CLIENT::resolve_pointers(std::vector<size_t> resolution_order)
+{
+     SYSTRACE_THREAD_NAME("pointer resolver");
+     SYSTRACE_SCOPE("KO_CLIENT::resolve_pointers");
+
+     // Stream the process memory through a small buffer to search for patterns in it
+     double const ko_address_space_heap_starts_at = 0.2;     // GB (via manual inspection using vmmap)
+     double const ko_address_space_heap_size      = 1;       // GB (via manual inspection using vmmap)
+     KO_MEM_ADR   heap_base_address               = (KO_MEM_ADR) GB_TO_BYTES(ko_address_space_heap_starts_at);
+     uint64_t     bytes_to_scan                   = GB_TO_BYTES(ko_address_space_heap_size);
+     size_t const scan_buffer_budget              = MB_TO_BYTES(4);
+     uint32_t     scan_buffer_count               = 4;       // 1 MB chunks, read ahead of the search by a reader thread
+
+     PROCESS_MEMORY_STREAM ko_memory {process_handle, heap_base_address, bytes_to_scan, {scan_buffer_budget, scan_buffer_count}};
+     KO_MEMORY_CONFIG      ko_memory_config;
+
+     enum SCAN_TARGET_INDEX
+     {
+          NATION,
+          HEALTH_AND_MANA,
+          SKILL_TARGETS_BEGIN     // One target per skill of the table, in the order of the table.
+     };
+
+     std::vector<PATTERN_SCAN_TARGET> scan_targets(SKILL_TARGETS_BEGIN);
+     scan_targets[NATION]          = PATTERN_SCAN_TARGET(ko_memory_config.player_nation_identification_byte_pattern);
+     scan_targets[HEALTH_AND_MANA] = PATTERN_SCAN_TARGET(ko_memory_config.mana_hp_anchor_byte_pattern);
+     for(size_t i = 0; i < skills.size( ); i++) scan_targets.emplace_back(skills.patterns[i], 2);     // Both nation copies of the skill pattern are collected.
+
+     // Restore the targets that were already found in this process, and scan the heap only for the others.
+     const char* const ko_address_cache_path = "ko_address_cache.bin";
+     PROCESS_IDENTITY  ko_identity           = get_process_identity(process_handle, process_id);
+     ADDRESS_CACHE     address_cache;
+     address_cache.load(ko_address_cache_path, ko_identity);
+
+     std::vector<size_t> stale_target_indices = address_cache.restore(process_handle, scan_targets);
+
+     std::vector<bool> is_target_scanned(scan_targets.size( ), true);
+     std::vector<bool> is_target_published(scan_targets.size( ), false);
+     for(size_t i : stale_target_indices) is_target_scanned[i] = false;
+
+     // Assigns the pointers of the targets scanned since the last call, and flags them as resolved once the gather reads them.
+     auto publish_scanned_targets = [&]( ) {
+          bool                is_player_published = false;
+          std::vector<size_t> published_skills;
+
+          if(is_target_scanned[HEALTH_AND_MANA] && !is_target_published[HEALTH_AND_MANA])
+          {
+               assign_player_health_and_mana_ptr(scan_targets[HEALTH_AND_MANA], ko_memory_config);
+               is_target_published[HEALTH_AND_MANA] = is_player_published = true;
+          }
+
+          if(is_target_scanned[NATION] && !is_target_published[NATION])
+          {
+               player_race                 = find_player_race(scan_targets[NATION], ko_memory_config);
+               is_target_published[NATION] = true;
+          }
+
+          // Every skill pointer depends on the race.
+          for(size_t i = 0; i < skills.size( ) && is_target_published[NATION]; i++)
+          {
+               const size_t target = SKILL_TARGETS_BEGIN + i;
+               if(!is_target_scanned[target] || is_target_published[target]) continue;
+
+               skills.cooldown_ptrs[i]     = find_skill_cooldown_ptr_generic(scan_targets[target], skills.names[i], ko_memory_config);
+               is_target_published[target] = true;
+               published_skills.push_back(i);
+          }
+
+          if(!is_player_published && published_skills.empty( )) return;
+
+          // The values the rotation polls, coalesced into as few reads as possible.
+          REMOTE_GATHER gather(process_handle);
+          for(size_t i = 0; i < skills.size( ); i++) gather.add(skills.cooldown_ptrs[i], offsetof(PLAYER_STATE, cooldowns) + i * sizeof(float), sizeof(float));
+          gather_player_state_field(gather, max_hp, player_max_hp_ptr);
+          gather_player_state_field(gather, cur_hp, player_cur_hp_ptr);
+          gather_player_state_field(gather, max_mp, player_max_mp_ptr);
+          gather_player_state_field(gather, cur_mp, player_cur_mp_ptr);
+          {
+               std::lock_guard<std::mutex> lock(player_state_gather_mutex);
+               player_state_gather = std::move(gather);
+          }
+
+          if(is_player_published) is_player_ptr_resolved.store(player_max_hp_ptr != nullptr, std::memory_order_release);
+          for(size_t i : published_skills)
+          {
+               const bool is_found = skills.cooldown_ptrs[i] != nullptr;
+               is_skill_ptr_resolved[i].store(is_found, std::memory_order_release);
+               skill_resolution_promises[i].set_value(is_found);
+          }
+     };
+
+     // Scans the heap for a set of stale targets in a single pass, starting from where they were found last time.
+     auto scan_in_one_pass = [&](const std::vector<size_t>& target_indices) {
+          if(target_indices.empty( ) || is_pointer_resolver_stopping) return;
+
+          SYSTRACE_SCOPE("KO_CLIENT::scan_stale_targets");
+          std::vector<PATTERN_SCAN_TARGET> stale_targets;
+          for(size_t i : target_indices) stale_targets.push_back(scan_targets[i]);
+
+          ko_memory.find_patterns_near(stale_targets, address_cache.hints(stale_targets));
+
+          for(size_t i = 0; i < target_indices.size( ); i++)
+          {
+               scan_targets[target_indices[i]].matches = stale_targets[i].matches;
+               is_target_scanned[target_indices[i]]    = true;
+          }
+          publish_scanned_targets( );
+     };
+
+     publish_scanned_targets( );     // The targets restored from the cache.
+
+     // A pass is as long as it takes to find all of its targets, the skills to resolve first don't wait for the others.
+     for(size_t skill : resolution_order)
+     {
+          std::vector<size_t> target_indices;
+          if(!is_target_scanned[NATION]) target_indices.push_back(NATION);
+          if(!is_target_scanned[SKILL_TARGETS_BEGIN + skill]) target_indices.push_back(SKILL_TARGETS_BEGIN + skill);
+          scan_in_one_pass(target_indices);
+     }
+
+     std::vector<size_t> remaining_target_indices;
+     for(size_t i = 0; i < scan_targets.size( ); i++)
+          if(!is_target_scanned[i]) remaining_target_indices.push_back(i);
+     scan_in_one_pass(remaining_target_indices);
+
+     if(!stale_target_indices.empty( ) && !is_pointer_resolver_stopping)
+     {
+          address_cache.store(ko_identity, scan_targets);
+          address_cache.save(ko_address_cache_path);
+     }
+
+     // The skills that were never scanned, if the resolver was stopped, are not found either.
+     for(size_t i = 0; i < skills.size( ); i++)
+          if(!is_target_published[SKILL_TARGETS_BEGIN + i]) skill_resolution_promises[i].set_value(false);
+     resolution_done_promise.set_value( );
+}
+
+PLAYER_STATE KO_CLIENT::read_player_state( ) noexcept
+{
+     if(is_state_poller_running( )) return player_state_snapshot.load( ).state;
+
+     PLAYER_STATE state;
+     gather_player_state(state);
+     return state;
+}
+
+float KO_CLIENT::get_skill_cooldown(size_t skill) const noexcept
+{
+     if(is_state_poller_running( )) return player_state_snapshot.load( ).state.cooldowns[skill];     // Sampled by the poller, no system call
+
+     if(!is_skill_resolved(skill)) return SKILL_TABLE::unresolved_cooldown;
+
+     float cooldown = 0.0f;
+     process_read(process_handle, skills.cooldown_ptrs[skill], &cooldown, sizeof(cooldown));
+     return cooldown;
+}
+
+COOLDOWN_SAMPLE KO_CLIENT::sample_cooldown(size_t skill, std::chrono::steady_clock::time_point first_press_time) noexcept
+{
+     float                                 cooldown;
+     std::chrono::steady_clock::time_point sampled_at;
+     if(is_state_poller_running( ))
+     {
+          const PLAYER_SNAPSHOT snapshot = player_state_snapshot.load( );
+          cooldown                       = snapshot.state.cooldowns[skill];
+          sampled_at                     = snapshot.sampled_at;
+     }
+     else
+     {
+          cooldown = SKILL_TABLE::unresolved_cooldown;
+          if(is_skill_resolved(skill)) process_read(process_handle, skills.cooldown_ptrs[skill], &cooldown, sizeof(cooldown));
+          sampled_at = std::chrono::steady_clock::now( );
+     }
+
+     return {cooldown, std::chrono::duration<float>(sampled_at - first_press_time).count( )};
+}
+
+bool KO_CLIENT::send_skill_until_in_cooldown(size_t skill) noexcept
+{
+     SYSTRACE_SCOPE("KO_CLIENT::send_skill_until_in_cooldown");
+     if(!is_skill_resolved(skill)) return false;     // Its cooldown can't be watched yet
+
+     COOLDOWN_MODEL& cooldown_model = skills.cooldown_models[skill];
+     const float epsilon                       = SKILL_TABLE::ready_cooldown; // Tolerance for floating-point number comparison
+     const int   previous_cooldowns_count      = 3;    // Number of previous cooldowns to consider
+     const int   input_overwhelm_protection_ms = 50;   // Protect against input lag
+     const int   model_sample_period_ms        = 5;    // Time between two samples once the model is trained, about the poller period
+     const int   max_duration_ms               = 3000; // Timeout in ms
+
+     const float trail_duration = previous_cooldowns_count * input_overwhelm_protection_ms / 1000.0f; // Seconds a decreasing trail lasts
+     const auto  start_time     = std::chrono::steady_clock::now( );
+
+     COOLDOWN_SAMPLE current = sample_cooldown(skill, start_time);
+     COOLDOWN_SAMPLE previous;
+     COOLDOWN_SAMPLE decreasing_trail_start;                 // First sample of the decreasing trail
+     int             previous_decreasing_cooldown_count = 0; // Track previous cooldowns
+     COOLDOWN_SAMPLE rise;                                   // First sample where the cooldown was up
+     bool            is_rise_sampled = false;
+
+     if(current.cooldown > epsilon) return false; // If skill is in cooldown, return
+
+     while(true)
+     {
+          // Attempt to activate the skill, the keys are pressed by the injection thread while the cooldown is sampled
+          const INPUT_COMPLETION keys_injected = input_injector.press_keys({skills.pages[skill], skills.keys[skill]});
+
+          if(cooldown_model.is_trained( ))
+          {
+               // Watch the cooldown until the next press is allowed, a single sample that fits the model confirms the activation.
+               const float next_press_at = std::chrono::duration<float>(std::chrono::steady_clock::now( ) - start_time).count( ) + input_overwhelm_protection_ms / 1000.0f;
+               while(true)
+               {
+                    current = sample_cooldown(skill, start_time);
+
+                    const bool is_cooldown_up = current.cooldown > epsilon;
+                    if(!is_cooldown_up) is_rise_sampled = false; // Not activated yet, or a spike that collapsed
+                    else if(!is_rise_sampled || current.cooldown > rise.cooldown)
+                    {
+                         rise            = current; // Dated from the first press, the rise of a later press is judged leniently
+                         is_rise_sampled = true;
+                    }
+                    else
+                    {
+                         const bool is_trail_confirmed = current.seconds_since_press - rise.seconds_since_press >= trail_duration && rise.cooldown - current.cooldown > epsilon;
+                         if(cooldown_model.fits(rise, current) || is_trail_confirmed)
+                         {
+                              cooldown_model.observe(rise, current);
+                              input_injector.press_keys({VK_R});
+                              return true;
+                         }
+                    }
+
+                    if(current.seconds_since_press >= next_press_at && keys_injected.is_done( )) break;
+                    timer_sleep_for(std::chrono::milliseconds(model_sample_period_ms));
+               }
+          }
+          else
+          {
+               previous = current;
+               current  = sample_cooldown(skill, start_time); // Get current cooldown
+
+               timer_sleep_for(std::chrono::milliseconds(input_overwhelm_protection_ms));
+
+               const bool is_previous_cooldown_bigger_than_current_cooldown = previous.cooldown - current.cooldown > epsilon;
+
+               if(is_previous_cooldown_bigger_than_current_cooldown) // Skill is active and cooldown is decreasing
+               {
+                    if(previous_decreasing_cooldown_count == 0) decreasing_trail_start = previous;
+                    previous_decreasing_cooldown_count++; // Track decreasing cooldown count
+               }
+               else
+               {
+                    previous_decreasing_cooldown_count = 0; // If the trail fails, start again
+               }
+
+               bool is_cooldown_consistently_decreasing = previous_decreasing_cooldown_count == previous_cooldowns_count;
+
+               if(is_cooldown_consistently_decreasing) // X amount of previous cooldowns is decreasing
+               {
+                    cooldown_model.observe(decreasing_trail_start, current);
+                    input_injector.press_keys({VK_R});
+                    return true;
+               }
+          }
+
+          auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now( ) - start_time);
+
+          if(elapsed_time.count( ) >= max_duration_ms)
+          {
+               return false;
+          } // Timeout
+     }
+}
+
+void KO_CLIENT::gather_player_state(PLAYER_STATE& state) noexcept
+{
+     state = { };
+     {
+          std::lock_guard<std::mutex> lock(player_state_gather_mutex);
+          player_state_gather.read(&state);
+     }
+
+     for(size_t i = 0; i < skills.size( ); i++)
+          if(!is_skill_resolved(i)) state.cooldowns[i] = SKILL_TABLE::unresolved_cooldown;
+}
+
+void KO_CLIENT::publish_player_state_sample(uint64_t sample_index)
+{
+     SYSTRACE_SCOPE("KO_CLIENT::publish_player_state_sample");
+     PLAYER_SNAPSHOT snapshot;
+     gather_player_state(snapshot.state);
+     snapshot.sampled_at   = std::chrono::steady_clock::now( );
+     snapshot.sample_index = sample_index;
+
+     player_state_snapshot.store(snapshot);
+}
+
+void KO_CLIENT::start_state_poller(std::chrono::microseconds period)
+{
+     stop_state_poller( );
+
+     // The getters switch to the snapshot once it holds a sample.
+     publish_player_state_sample(0);
+     is_state_poller_stopping = false;
+
+     // The gather is only shared with the pointer resolver, which replaces it as the pointers are found.
+     state_poller = std::thread([this, period]( ) {
+          SYSTRACE_THREAD_NAME("state poller");
+          auto next_sample_time = std::chrono::steady_clock::now( );
+          for(uint64_t sample_index = 1; !is_state_poller_stopping.load(std::memory_order_relaxed); sample_index++)
+          {
+               next_sample_time += period;
+
+               // If a read took longer than a period, don't try to catch up with a burst of samples.
+               const auto now = std::chrono::steady_clock::now( );
+               if(next_sample_time < now) next_sample_time = now;
+
+               // A sample a few hundred microseconds late is harmless, it isn't worth spinning a core every period.
+               timer_sleep_until(next_sample_time);
+               publish_player_state_sample(sample_index);
+          }
+     });
+
+     is_state_poller_active.store(true, std::memory_order_release);
+}
+
+void KO_CLIENT::stop_state_poller( )
+{
+     if(!state_poller.joinable( )) return;
+
+     is_state_poller_active.store(false, std::memory_order_release);
+     is_state_poller_stopping = true;
+     state_poller.join( );
+}
+
 inline void KO_CLIENT::print_info( ) const noexcept { std::cout << "Knight Online PID: " << process_id << "\nKnight Online Handle:  " << process_handle << std::endl; }
 
 #endif
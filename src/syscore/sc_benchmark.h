@@ -1,19 +1,38 @@
 #ifndef SYSCORE_BENCHMARK_H
 #define SYSCORE_BENCHMARK_H
+#ifdef _WIN32
 #include  "windows.h"
+#else
+#include <time.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
 /**
  * @class TICTOC
  *
  * @brief A class to create high resolution benchmark timers.
  * 
  * tic starts the timer, toc stops it. There are methods to access the time elapsed between them.
+ * Uses the QueryPerformanceCounter on Windows and the monotonic clock elsewhere.
  */
 class TICTOC
 {
     private:
+#ifdef _WIN32
         LARGE_INTEGER freq; // Frequency of the QuerryPerformanceCounter. Fixed at computer boot.
         LARGE_INTEGER tic_count; // The initial count of the QuerryPerformanceCounter.
         LARGE_INTEGER toc_count; // The final count of the QuerryPerformanceCounter.
+#else
+        timespec tic_time; // The initial time of the monotonic clock.
+        timespec toc_time; // The final time of the monotonic clock.
+#endif
         double time_difference_ms; // Time difference between the initial and final count.
 
     public:
@@ -44,9 +63,113 @@ class TICTOC
         double elapsed_time_in_ns();
 };
 
+/**
+ * @brief How long a benchmark of a BENCHMARK_SUITE is repeated.
+ */
+struct BENCHMARK_CONFIG
+{
+    uint32_t warmup_runs = 3;              // Untimed runs first, to warm up the caches, the page tables and the branch predictors.
+    uint32_t min_repetitions = 10;
+    uint32_t max_repetitions = 100000;
+    double target_relative_error = 0.01;   // Stops once the standard error of the mean is below this fraction of the mean.
+    double max_time_ms = 2000.0;           // Stops once the timed runs took this long, stable or not.
+};
+
+/**
+ * @brief The timings of one benchmark, per call of its body.
+ */
+struct BENCHMARK_RESULT
+{
+    std::string name;
+    uint32_t repetitions = 0;
+    double min_ms = 0.0;
+    double median_ms = 0.0;
+    double p99_ms = 0.0;
+    double mean_ms = 0.0;
+    double relative_error = 0.0;           // Standard error of the mean, as a fraction of the mean.
+    uint64_t bytes_per_call = 0;           // Bytes processed by a call, 0 if the throughput means nothing.
+    bool is_stable = false;                // Whether the target relative error was reached.
+
+    /**
+     * @brief Returns the throughput at the median time, in bytes per second.
+     */
+    double throughput_bytes_per_second() const { return median_ms > 0.0 ? bytes_per_call / (median_ms / 1000.0) : 0.0; }
+};
+
+/**
+ * @brief Keeps the compiler from optimizing away the computation of value.
+ */
+template<typename T>
+inline void benchmark_do_not_optimize(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+/**
+ * @class BENCHMARK_SUITE
+ *
+ * @brief Runs named benchmarks with a TICTOC timer, and reports them as a table, JSON or CSV.
+ *
+ * A benchmark is warmed up, then timed run after run until the mean is known within the target relative error, or the
+ * repetitions or the time budget run out. A run can make several calls of the body, so that a body much shorter than
+ * the resolution of the timer can still be measured; every figure is per call.
+ *
+ * @code
+ *   BENCHMARK_SUITE suite;
+ *   suite.run("memmem/64MB", [&]() { benchmark_do_not_optimize(memmem(haystack, size, needle, 16)); }, size);
+ *   suite.write_json(std::cout);
+ * @endcode
+ */
+class BENCHMARK_SUITE
+{
+    private:
+        BENCHMARK_CONFIG config;
+        TICTOC timer;
+        std::vector<BENCHMARK_RESULT> results;
+
+        static void write_json_string(std::ostream& stream, const std::string& text);
+
+    public:
+        explicit BENCHMARK_SUITE(const BENCHMARK_CONFIG& config = BENCHMARK_CONFIG()) : config(config) {}
+
+        /**
+         * @brief Runs a benchmark and keeps its result.
+         *
+         * @param name Name of the benchmark, e.g. "memmem/avx2".
+         * @param body The code to time.
+         * @param bytes_per_call (Optional) Bytes processed by a call of body, for the throughput.
+         * @param calls_per_run (Optional) Calls of body per timed run.
+         * @return const BENCHMARK_RESULT& The result, valid until the next run.
+         */
+        const BENCHMARK_RESULT& run(const std::string& name, const std::function<void()>& body, uint64_t bytes_per_call = 0, uint32_t calls_per_run = 1);
+
+        const std::vector<BENCHMARK_RESULT>& get_results() const { return results; }
+
+        /**
+         * @brief Writes the results as an array of JSON objects, one per benchmark.
+         */
+        void write_json(std::ostream& stream) const;
+
+        /**
+         * @brief Writes the results as CSV, with a header line.
+         */
+        void write_csv(std::ostream& stream) const;
+
+        /**
+         * @brief Writes the results as an aligned table, for the console.
+         */
+        void write_table(std::ostream& stream) const;
+};
+
 #endif
 
 #ifdef SYSCORE_BENCHMARK_IMPLEMENTATION
+#ifdef _WIN32
     TICTOC::TICTOC()
     {
         QueryPerformanceFrequency(&freq);
@@ -63,6 +186,23 @@ class TICTOC
 
         time_difference_ms = ((double)(toc_count.QuadPart - tic_count.QuadPart) / freq.QuadPart * 1000);
     }
+#else
+    TICTOC::TICTOC()
+    {
+    }
+
+    void inline TICTOC::tic()
+    {
+        clock_gettime(CLOCK_MONOTONIC, &tic_time);
+    }
+
+    void inline TICTOC::toc()
+    {
+        clock_gettime(CLOCK_MONOTONIC, &toc_time);
+
+        time_difference_ms = (double)(toc_time.tv_sec - tic_time.tv_sec) * 1000 + (double)(toc_time.tv_nsec - tic_time.tv_nsec) / 1000000;
+    }
+#endif
 
     double inline TICTOC::elapsed_time_in_ms()
     {
@@ -73,5 +213,125 @@ class TICTOC
         return time_difference_ms * 1000000;
     }
 
+    const BENCHMARK_RESULT& BENCHMARK_SUITE::run(const std::string& name, const std::function<void()>& body, uint64_t bytes_per_call, uint32_t calls_per_run)
+    {
+        calls_per_run = std::max<uint32_t>(1, calls_per_run);
+        for (uint32_t i = 0; i < config.warmup_runs; i++) body();
+
+        BENCHMARK_RESULT result;
+        result.name = name;
+        result.bytes_per_call = bytes_per_call;
+
+        std::vector<double> samples_ms;
+        double total_ms = 0.0, sum = 0.0, sum_of_squares = 0.0;
+        while (samples_ms.size() < config.max_repetitions)
+        {
+            timer.tic();
+            for (uint32_t i = 0; i < calls_per_run; i++) body();
+            timer.toc();
+
+            const double sample_ms = timer.elapsed_time_in_ms() / calls_per_run;
+            samples_ms.push_back(sample_ms);
+            total_ms += timer.elapsed_time_in_ms();
+            sum += sample_ms;
+            sum_of_squares += sample_ms * sample_ms;
+
+            const double count = (double) samples_ms.size();
+            const double mean = sum / count;
+            const double variance = std::max(0.0, (sum_of_squares - count * mean * mean) / std::max(1.0, count - 1.0));
+            result.relative_error = mean > 0.0 ? std::sqrt(variance / count) / mean : 0.0;
+            result.is_stable = samples_ms.size() >= config.min_repetitions && result.relative_error <= config.target_relative_error;
+
+            if (result.is_stable) break;
+            if (samples_ms.size() >= config.min_repetitions && total_ms >= config.max_time_ms) break;
+        }
+
+        // Nearest rank percentiles.
+        std::sort(samples_ms.begin(), samples_ms.end());
+        auto percentile = [&samples_ms](double fraction) { return samples_ms[(size_t) std::ceil(fraction * samples_ms.size()) - 1]; };
+
+        result.repetitions = (uint32_t) samples_ms.size();
+        result.min_ms = samples_ms.front();
+        result.median_ms = percentile(0.5);
+        result.p99_ms = percentile(0.99);
+        result.mean_ms = sum / samples_ms.size();
+
+        results.push_back(result);
+        return results.back();
+    }
+
+    void BENCHMARK_SUITE::write_json_string(std::ostream& stream, const std::string& text)
+    {
+        stream << '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\') stream << '\\';
+            stream << c;
+        }
+        stream << '"';
+    }
+
+    void BENCHMARK_SUITE::write_json(std::ostream& stream) const
+    {
+        const std::streamsize precision = stream.precision(9);
+        stream << "[\n";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const BENCHMARK_RESULT& result = results[i];
+            stream << "  {\"name\": ";
+            write_json_string(stream, result.name);
+            stream << ", \"repetitions\": " << result.repetitions
+                   << ", \"min_ms\": " << result.min_ms
+                   << ", \"median_ms\": " << result.median_ms
+                   << ", \"p99_ms\": " << result.p99_ms
+                   << ", \"mean_ms\": " << result.mean_ms
+                   << ", \"relative_error\": " << result.relative_error
+                   << ", \"is_stable\": " << (result.is_stable ? "true" : "false")
+                   << ", \"bytes_per_call\": " << result.bytes_per_call
+                   << ", \"bytes_per_second\": " << result.throughput_bytes_per_second() << "}"
+                   << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        stream << "]\n";
+        stream.precision(precision);
+    }
+
+    void BENCHMARK_SUITE::write_csv(std::ostream& stream) const
+    {
+        const std::streamsize precision = stream.precision(9);
+        stream << "name,repetitions,min_ms,median_ms,p99_ms,mean_ms,relative_error,is_stable,bytes_per_call,bytes_per_second\n";
+        for (const BENCHMARK_RESULT& result : results)
+        {
+            // The names are quoted, in case they contain a comma.
+            stream << '"' << result.name << "\"," << result.repetitions << ',' << result.min_ms << ',' << result.median_ms << ','
+                   << result.p99_ms << ',' << result.mean_ms << ',' << result.relative_error << ',' << (result.is_stable ? 1 : 0) << ','
+                   << result.bytes_per_call << ',' << result.throughput_bytes_per_second() << '\n';
+        }
+        stream.precision(precision);
+    }
+
+    void BENCHMARK_SUITE::write_table(std::ostream& stream) const
+    {
+        size_t name_width = 4;
+        for (const BENCHMARK_RESULT& result : results) name_width = std::max(name_width, result.name.size());
+
+        // Four significant digits, the times range from nanoseconds to seconds.
+        const std::streamsize precision = stream.precision(4);
+
+        stream << std::string(name_width, ' ').replace(0, 4, "name") << " | reps   | min ms       | median ms    | p99 ms       | MB/s\n";
+        for (const BENCHMARK_RESULT& result : results)
+        {
+            stream << result.name << std::string(name_width - result.name.size(), ' ') << " | ";
+            stream.width(6); stream << result.repetitions << " | ";
+            stream.width(12); stream << result.min_ms << " | ";
+            stream.width(12); stream << result.median_ms << " | ";
+            stream.width(12); stream << result.p99_ms << " | ";
+            if (result.bytes_per_call) stream << result.throughput_bytes_per_second() / 1048576.0;
+            else stream << "-";
+            stream << (result.is_stable ? "" : " (unstable)") << '\n';
+        }
+
+        stream.precision(precision);
+    }
+
 #endif
 
@@ -0,0 +1,357 @@
+#ifndef SYSCORE_FORMAT_H
+#define SYSCORE_FORMAT_H
+#include <algorithm>
+#include <cmath>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+/**
+ * @brief Allocation-free formatting of integers, floats, addresses and byte dumps, with the format string checked at compile time.
+ *
+ * A format string is copied as is, except for its placeholders, which write the arguments in order:
+ * - {}    any argument: integers in decimal, floats with 3 decimals, pointers as 0x hex, HEX_BYTES as "DE AD BE EF".
+ * - {:x}  an integer or a pointer in hex, without the 0x.
+ * - {:.N} a float with N decimals, N from 0 to 9.
+ * - {{ and }} write { and }.
+ *
+ * FORMAT_CHECK(format, arguments...) fails to compile when the format string is malformed, has a placeholder count
+ * different from the argument count, or a placeholder that does not fit the type of its argument. The format string
+ * must then be a string literal.
+ *
+ * format_write writes into a fixed buffer, and only appends what does not fit to an overflow string, if one is given.
+ *
+ * Example usage:
+ * @code
+ *   char buffer[64];
+ *   FORMAT_CHECK("cooldown {:.2} s at {}", cooldown, address);
+ *   FORMAT_OUTPUT output {buffer, sizeof(buffer)};
+ *   format_write(output, "cooldown {:.2} s at {}", cooldown, address);
+ * @endcode
+ */
+
+/**
+ * @brief Bytes written as a hex dump by the {} placeholder.
+ */
+struct HEX_BYTES
+{
+    const void *data;
+    size_t size;
+};
+
+enum class FORMAT_ARGUMENT_KIND : uint8_t
+{
+    UNSUPPORTED,
+    INTEGER,
+    FLOAT,
+    POINTER,
+    STRING,
+    CHARACTER,
+    BOOLEAN,
+    BYTES
+};
+
+template<typename T>
+constexpr FORMAT_ARGUMENT_KIND format_argument_kind()
+{
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same<U, bool>::value) return FORMAT_ARGUMENT_KIND::BOOLEAN;
+    else if constexpr (std::is_same<U, char>::value) return FORMAT_ARGUMENT_KIND::CHARACTER;
+    else if constexpr (std::is_integral<U>::value || std::is_enum<U>::value) return FORMAT_ARGUMENT_KIND::INTEGER;
+    else if constexpr (std::is_floating_point<U>::value) return FORMAT_ARGUMENT_KIND::FLOAT;
+    else if constexpr (std::is_same<U, char *>::value || std::is_same<U, const char *>::value || std::is_same<U, std::string>::value) return FORMAT_ARGUMENT_KIND::STRING;
+    else if constexpr (std::is_pointer<U>::value || std::is_null_pointer<U>::value) return FORMAT_ARGUMENT_KIND::POINTER;
+    else if constexpr (std::is_same<U, HEX_BYTES>::value) return FORMAT_ARGUMENT_KIND::BYTES;
+    else return FORMAT_ARGUMENT_KIND::UNSUPPORTED;
+}
+
+/**
+ * @brief The kinds of a list of arguments, as a type, see format_argument_kinds.
+ */
+template<FORMAT_ARGUMENT_KIND... kinds>
+struct FORMAT_ARGUMENT_KINDS
+{
+    static constexpr size_t count = sizeof...(kinds);
+    static constexpr FORMAT_ARGUMENT_KIND values[count + 1] = {kinds..., FORMAT_ARGUMENT_KIND::UNSUPPORTED};
+};
+
+/**
+ * @brief Only declared, the type of a call gives the kinds of its arguments in an unevaluated context.
+ */
+template<typename... T>
+FORMAT_ARGUMENT_KINDS<format_argument_kind<T>()...> format_argument_kinds(const T&...);
+
+/**
+ * @brief Checks a format string against the kinds of its arguments, see the placeholders above.
+ */
+constexpr bool format_check(const char *format, const FORMAT_ARGUMENT_KIND *kinds, size_t count)
+{
+    size_t argument = 0;
+    for (size_t i = 0; format[i]; i++)
+    {
+        if (format[i] == '}')
+        {
+            if (format[i + 1] != '}') return false;
+            i++;
+            continue;
+        }
+        if (format[i] != '{') continue;
+        if (format[i + 1] == '{')
+        {
+            i++;
+            continue;
+        }
+
+        if (argument >= count) return false;
+        const FORMAT_ARGUMENT_KIND kind = kinds[argument++];
+        if (kind == FORMAT_ARGUMENT_KIND::UNSUPPORTED) return false;
+
+        i++;
+        if (format[i] == ':')
+        {
+            i++;
+            if (format[i] == 'x')
+            {
+                if (kind != FORMAT_ARGUMENT_KIND::INTEGER && kind != FORMAT_ARGUMENT_KIND::POINTER) return false;
+                i++;
+            }
+            else if (format[i] == '.' && format[i + 1] >= '0' && format[i + 1] <= '9')
+            {
+                if (kind != FORMAT_ARGUMENT_KIND::FLOAT) return false;
+                i += 2;
+            }
+            else return false;
+        }
+        if (format[i] != '}') return false;
+    }
+    return argument == count;
+}
+
+#define FORMAT_FIRST_ARGUMENT(...) FORMAT_FIRST_ARGUMENT_INNER(__VA_ARGS__, 0)
+#define FORMAT_FIRST_ARGUMENT_INNER(first, ...) first
+
+// The format string is the first of the arguments, its own kind is skipped.
+#define FORMAT_CHECK(...) \
+    static_assert(format_check(FORMAT_FIRST_ARGUMENT(__VA_ARGS__), decltype(format_argument_kinds(__VA_ARGS__))::values + 1, \
+                               decltype(format_argument_kinds(__VA_ARGS__))::count - 1), \
+                  "The format string does not match its arguments.")
+
+/**
+ * @class FORMAT_OUTPUT
+ *
+ * @brief A fixed buffer written by format_write. What does not fit goes to the overflow string, or is cut if there is none.
+ */
+class FORMAT_OUTPUT
+{
+    private:
+        char *cursor;
+        char *end;
+        std::string *overflow_text;
+
+    public:
+        FORMAT_OUTPUT(char *buffer, size_t size, std::string *overflow_text = nullptr) : cursor(buffer), end(buffer + size), overflow_text(overflow_text) {}
+
+        void write(const char *text, size_t size)
+        {
+            const size_t fitting_size = size < (size_t) (end - cursor) ? size : (size_t) (end - cursor);
+            memcpy(cursor, text, fitting_size);
+            cursor += fitting_size;
+            if (fitting_size < size && overflow_text) overflow_text->append(text + fitting_size, size - fitting_size);
+        }
+
+        void write(char character) { write(&character, 1); }
+
+        /**
+         * @brief End of what was written into the buffer.
+         */
+        char *position() const { return cursor; }
+};
+
+/**
+ * @brief An argument of format_write, with its type erased so that the format string is walked by one function.
+ */
+struct FORMAT_ARGUMENT
+{
+    FORMAT_ARGUMENT_KIND kind = FORMAT_ARGUMENT_KIND::UNSUPPORTED;
+    bool is_negative = false;
+    union
+    {
+        uint64_t integer;   // Magnitude, see is_negative.
+        double floating;
+        const void *pointer;
+        struct
+        {
+            const char *data;
+            size_t size;
+        } string;
+        char character;
+        bool boolean;
+        HEX_BYTES bytes;
+    };
+
+    FORMAT_ARGUMENT() : integer(0) {}
+};
+
+template<typename T>
+inline FORMAT_ARGUMENT format_argument(const T& value)
+{
+    using U = std::decay_t<T>;
+    constexpr FORMAT_ARGUMENT_KIND kind = format_argument_kind<T>();
+    static_assert(kind != FORMAT_ARGUMENT_KIND::UNSUPPORTED, "This type can't be formatted.");
+
+    FORMAT_ARGUMENT argument;
+    argument.kind = kind;
+    if constexpr (kind == FORMAT_ARGUMENT_KIND::BOOLEAN) argument.boolean = value;
+    else if constexpr (kind == FORMAT_ARGUMENT_KIND::CHARACTER) argument.character = value;
+    else if constexpr (kind == FORMAT_ARGUMENT_KIND::INTEGER)
+    {
+        if constexpr (std::is_enum<U>::value) return format_argument((typename std::underlying_type<U>::type) value);
+        else if constexpr (std::is_signed<U>::value)
+        {
+            argument.is_negative = value < 0;
+            argument.integer = argument.is_negative ? 0 - (uint64_t) value : (uint64_t) value;
+        }
+        else argument.integer = value;
+    }
+    else if constexpr (kind == FORMAT_ARGUMENT_KIND::FLOAT) argument.floating = value;
+    else if constexpr (kind == FORMAT_ARGUMENT_KIND::STRING)
+    {
+        if constexpr (std::is_same<U, std::string>::value) argument.string = {value.data(), value.size()};
+        else
+        {
+            const char *text = value;
+            argument.string = {text ? text : "(null)", text ? strlen(text) : 6};
+        }
+    }
+    else if constexpr (kind == FORMAT_ARGUMENT_KIND::POINTER) argument.pointer = (const void *) value;
+    else argument.bytes = value;
+    return argument;
+}
+
+inline void format_write_unsigned(FORMAT_OUTPUT& output, uint64_t value, bool is_hex)
+{
+    char digits[20];
+    size_t count = 0;
+    const uint64_t base = is_hex ? 16 : 10;
+    do
+    {
+        digits[sizeof(digits) - ++count] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value);
+    output.write(digits + sizeof(digits) - count, count);
+}
+
+inline void format_write_float(FORMAT_OUTPUT& output, double value, uint32_t precision)
+{
+    if (std::isnan(value)) return output.write("nan", 3);
+    if (value < 0)
+    {
+        output.write('-');
+        value = -value;
+    }
+    if (std::isinf(value)) return output.write("inf", 3);
+
+    uint64_t scale = 1;
+    for (uint32_t i = 0; i < precision; i++) scale *= 10;
+
+    // Rounded in fixed point while it fits in 64 bits, too large values are rare enough for snprintf.
+    const double scaled = value * (double) scale + 0.5;
+    if (scaled >= 1.8e19)
+    {
+        char text[32];
+        const int size = snprintf(text, sizeof(text), "%.*e", (int) precision, value);
+        return output.write(text, size > 0 ? std::min((size_t) size, sizeof(text) - 1) : 0);
+    }
+
+    const uint64_t fixed_point = (uint64_t) scaled;
+    format_write_unsigned(output, fixed_point / scale, false);
+    if (!precision) return;
+
+    char fraction[10];
+    uint64_t fraction_value = fixed_point % scale;
+    for (uint32_t i = precision; i > 0; i--)
+    {
+        fraction[i - 1] = (char) ('0' + fraction_value % 10);
+        fraction_value /= 10;
+    }
+    output.write('.');
+    output.write(fraction, precision);
+}
+
+inline void format_write_bytes(FORMAT_OUTPUT& output, HEX_BYTES bytes)
+{
+    const uint8_t *data = (const uint8_t *) bytes.data;
+    for (size_t i = 0; i < bytes.size; i++)
+    {
+        const char text[3] = {"0123456789ABCDEF"[data[i] >> 4], "0123456789ABCDEF"[data[i] & 0xF], ' '};
+        output.write(text, i + 1 < bytes.size ? 3 : 2);
+    }
+}
+
+inline void format_write_argument(FORMAT_OUTPUT& output, const FORMAT_ARGUMENT& argument, bool is_hex, uint32_t precision)
+{
+    switch (argument.kind)
+    {
+        case FORMAT_ARGUMENT_KIND::INTEGER:
+            if (argument.is_negative) output.write('-');
+            format_write_unsigned(output, argument.integer, is_hex);
+            break;
+        case FORMAT_ARGUMENT_KIND::FLOAT: format_write_float(output, argument.floating, precision); break;
+        case FORMAT_ARGUMENT_KIND::POINTER:
+            if (!is_hex) output.write("0x", 2);
+            format_write_unsigned(output, (uint64_t) (uintptr_t) argument.pointer, true);
+            break;
+        case FORMAT_ARGUMENT_KIND::STRING: output.write(argument.string.data, argument.string.size); break;
+        case FORMAT_ARGUMENT_KIND::CHARACTER: output.write(argument.character); break;
+        case FORMAT_ARGUMENT_KIND::BOOLEAN: argument.boolean ? output.write("true", 4) : output.write("false", 5); break;
+        case FORMAT_ARGUMENT_KIND::BYTES: format_write_bytes(output, argument.bytes); break;
+        case FORMAT_ARGUMENT_KIND::UNSUPPORTED: break;
+    }
+}
+
+/**
+ * @brief Writes the format string with its arguments, the format string is expected to have passed format_check.
+ */
+inline void format_write_arguments(FORMAT_OUTPUT& output, const char *format, const FORMAT_ARGUMENT *arguments, size_t count)
+{
+    size_t argument = 0;
+    const char *text = format;
+    for (const char *cursor = format; *cursor; cursor++)
+    {
+        if ((*cursor != '{' && *cursor != '}') || !cursor[1]) continue;
+
+        output.write(text, (size_t) (cursor - text));
+        if (cursor[1] == *cursor)
+        {
+            text = ++cursor; // Escaped brace, written with the next text.
+            continue;
+        }
+
+        bool is_hex = false;
+        uint32_t precision = 3;
+        cursor++;
+        if (*cursor == ':')
+        {
+            cursor++;
+            if (*cursor == 'x') is_hex = true;
+            else if (*cursor == '.' && cursor[1]) precision = (uint32_t) (*++cursor - '0');
+            cursor++;
+        }
+        if (argument < count) format_write_argument(output, arguments[argument++], is_hex, precision);
+        if (!*cursor) return;
+        text = cursor + 1;
+    }
+    output.write(text, strlen(text));
+}
+
+template<typename... T>
+inline void format_write(FORMAT_OUTPUT& output, const char *format, const T&... arguments)
+{
+    const FORMAT_ARGUMENT erased_arguments[sizeof...(T) + 1] = {format_argument(arguments)...};
+    format_write_arguments(output, format, erased_arguments, sizeof...(T));
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef SYSCORE_INPUT_H
+#define SYSCORE_INPUT_H
+#include "windows.h"
+#include "sc_spsc_queue.h"
+#include "sc_time.h"
+#include "sc_trace.h"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <initializer_list>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+class INPUT_INJECTOR;
+
+/**
+ * @class INPUT_COMPLETION
+ *
+ * @brief Tells when the keys of a submission to an INPUT_INJECTOR were injected.
+ */
+class INPUT_COMPLETION
+{
+    private:
+        const INPUT_INJECTOR *injector = nullptr;
+        uint64_t ticket = 0;
+
+    public:
+        /**
+         * @brief Construct a completion that is already done.
+         */
+        INPUT_COMPLETION() = default;
+
+        INPUT_COMPLETION(const INPUT_INJECTOR *injector, uint64_t ticket) : injector(injector), ticket(ticket) {}
+
+        /**
+         * @brief Whether the keys were injected, without waiting.
+         */
+        bool is_done() const noexcept;
+
+        /**
+         * @brief Waits until the keys are injected.
+         */
+        void wait() const;
+};
+
+/**
+ * @class INPUT_INJECTOR
+ *
+ * @brief Injects key presses from a dedicated thread, so that the caller doesn't wait for them.
+ *
+ * Submissions go through a lock-free queue to the injection thread, which presses and releases their keys in order.
+ * The release of a key and the press of the next one are due at the same time, so they go in a single SendInput call,
+ * and a sequence without a hold delay is a single call.
+ *
+ * Keys are submitted from one thread only, the queue has a single producer.
+ *
+ * @code
+ *   INPUT_INJECTOR input_injector;
+ *   INPUT_COMPLETION keys_injected = input_injector.press_keys({VK_F1, VK_2});
+ *   // ... read the game state in the meantime ...
+ *   keys_injected.wait();
+ * @endcode
+ */
+class INPUT_INJECTOR
+{
+    public:
+        static constexpr size_t max_keys_per_sequence = 8;
+
+    private:
+        struct KEY_SEQUENCE
+        {
+            uint16_t keys[max_keys_per_sequence];
+            uint8_t key_count;
+            uint8_t key_press_release_delay_in_ms;
+            uint64_t ticket;
+        };
+
+        SPSC_QUEUE<KEY_SEQUENCE, 64> submitted_sequences;
+        HANDLE sequence_submitted;           // Auto reset event, wakes the injection thread up.
+        uint64_t last_submitted_ticket = 0;  // Only used by the submitting thread.
+
+        std::atomic<uint64_t> last_injected_ticket {0};
+        mutable std::mutex injected_mutex;   // Only taken to wait for a completion, never to submit.
+        mutable std::condition_variable sequence_injected;
+
+        std::atomic<bool> is_stopping {false};
+        std::thread injection_thread;
+
+        static INPUT key_input(uint16_t key, DWORD flags);
+        void inject(const KEY_SEQUENCE& sequence);
+        void run();
+
+    public:
+        /**
+         * @brief Construct a new INPUT_INJECTOR and start its injection thread.
+         */
+        INPUT_INJECTOR();
+
+        /**
+         * @brief Injects the keys still queued, then stops the injection thread.
+         */
+        ~INPUT_INJECTOR();
+
+        INPUT_INJECTOR(const INPUT_INJECTOR&) = delete;
+        INPUT_INJECTOR& operator=(const INPUT_INJECTOR&) = delete;
+
+        /**
+         * @brief Queues the press and release of each key, one after the other, and returns at once.
+         *
+         * @param keys Virtual key codes, at most max_keys_per_sequence.
+         * @param key_press_release_delay_in_ms How long each key is held down.
+         * @return INPUT_COMPLETION Done once the last key is released.
+         */
+        INPUT_COMPLETION press_keys(std::initializer_list<uint16_t> keys, uint8_t key_press_release_delay_in_ms = 10);
+
+        /**
+         * @brief Whether the submission with this ticket was injected.
+         */
+        bool is_injected(uint64_t ticket) const noexcept { return last_injected_ticket.load(std::memory_order_acquire) >= ticket; }
+
+        /**
+         * @brief Waits until the submission with this ticket is injected.
+         */
+        void wait_injected(uint64_t ticket) const;
+};
+
+#endif
+
+#ifdef SYSCORE_INPUT_IMPLEMENTATION
+    bool INPUT_COMPLETION::is_done() const noexcept
+    {
+        return !injector || injector->is_injected(ticket);
+    }
+
+    void INPUT_COMPLETION::wait() const
+    {
+        if (injector) injector->wait_injected(ticket);
+    }
+
+    INPUT_INJECTOR::INPUT_INJECTOR()
+    {
+        sequence_submitted = CreateEvent(NULL, FALSE, FALSE, NULL);
+        injection_thread = std::thread(&INPUT_INJECTOR::run, this);
+    }
+
+    INPUT_INJECTOR::~INPUT_INJECTOR()
+    {
+        is_stopping.store(true, std::memory_order_release);
+        SetEvent(sequence_submitted);
+        injection_thread.join();
+        CloseHandle(sequence_submitted);
+    }
+
+    INPUT_COMPLETION INPUT_INJECTOR::press_keys(std::initializer_list<uint16_t> keys, uint8_t key_press_release_delay_in_ms)
+    {
+        assert(keys.size() <= max_keys_per_sequence);
+
+        KEY_SEQUENCE sequence = {};
+        for (uint16_t key : keys)
+        {
+            if (sequence.key_count == max_keys_per_sequence) break;
+            sequence.keys[sequence.key_count++] = key;
+        }
+        sequence.key_press_release_delay_in_ms = key_press_release_delay_in_ms;
+        sequence.ticket = ++last_submitted_ticket;
+
+        // The queue only fills up if keys are submitted much faster than they can be pressed.
+        while (!submitted_sequences.try_push(sequence)) Sleep(1);
+        SetEvent(sequence_submitted);
+
+        return INPUT_COMPLETION(this, sequence.ticket);
+    }
+
+    void INPUT_INJECTOR::wait_injected(uint64_t ticket) const
+    {
+        std::unique_lock<std::mutex> lock(injected_mutex);
+        sequence_injected.wait(lock, [this, ticket]() { return is_injected(ticket); });
+    }
+
+    INPUT INPUT_INJECTOR::key_input(uint16_t key, DWORD flags)
+    {
+        INPUT input = {};
+        input.type = INPUT_KEYBOARD;
+        input.ki.wScan = MapVirtualKey(key, 0); // Knight Online reads scan codes.
+        input.ki.dwFlags = KEYEVENTF_SCANCODE | flags;
+        return input;
+    }
+
+    void INPUT_INJECTOR::inject(const KEY_SEQUENCE& sequence)
+    {
+        SYSTRACE_SCOPE("INPUT_INJECTOR::inject");
+        INPUT events[2 * max_keys_per_sequence];
+        UINT event_count = 0;
+
+        for (uint8_t i = 0; i < sequence.key_count; i++)
+        {
+            if (i > 0) events[event_count++] = key_input(sequence.keys[i - 1], KEYEVENTF_KEYUP);
+            events[event_count++] = key_input(sequence.keys[i], 0);
+
+            if (sequence.key_press_release_delay_in_ms)
+            {
+                SendInput(event_count, events, sizeof(INPUT));
+                event_count = 0;
+                precise_sleep_for(std::chrono::milliseconds(sequence.key_press_release_delay_in_ms));
+            }
+        }
+        if (sequence.key_count) events[event_count++] = key_input(sequence.keys[sequence.key_count - 1], KEYEVENTF_KEYUP);
+
+        if (event_count) SendInput(event_count, events, sizeof(INPUT));
+    }
+
+    void INPUT_INJECTOR::run()
+    {
+        SYSTRACE_THREAD_NAME("input injector");
+        while (true)
+        {
+            KEY_SEQUENCE sequence;
+            while (submitted_sequences.try_pop(sequence))
+            {
+                inject(sequence);
+                {
+                    std::lock_guard<std::mutex> lock(injected_mutex);
+                    last_injected_ticket.store(sequence.ticket, std::memory_order_release);
+                }
+                sequence_injected.notify_all();
+            }
+
+            // The queue is drained before stopping, so that no submitted key is lost.
+            if (is_stopping.load(std::memory_order_acquire)) return;
+            WaitForSingleObject(sequence_submitted, INFINITE);
+        }
+    }
+
+#endif
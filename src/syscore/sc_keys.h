@@ -2,6 +2,8 @@
 #define SC_KEYS_H
 
 #include "windows.h"
+#include "sc_time.h"
+#include "sc_trace.h"
 
 #include <stdint.h>
 #include <utility>
@@ -54,34 +56,6 @@ constexpr int VK_X = 0x58;
 constexpr int VK_Y = 0x59;
 constexpr int VK_Z = 0x5A;
 
-/**
- * @brief Virtual key codes for various skills.
- *
- * These constants represent virtual key codes for different in-game skills.
- * Each constant is associated with a specific skill action in the game.
- * These will be read from a config file when implemented.
- *
- * @note These constants are defined as compile-time constants (constexpr).
- */
-constexpr int spike_key   = VK_2;
-constexpr int spike_page  = VK_F1;
-constexpr int thrust_key  = VK_3;
-constexpr int thrust_page = VK_F1;
-constexpr int pierce_key  = VK_4;
-constexpr int pierce_page = VK_F1;
-constexpr int cut_key     = VK_5;
-constexpr int cut_page    = VK_F1;
-constexpr int shock_key   = VK_6;
-constexpr int shock_page  = VK_F1;
-constexpr int jab_key     = VK_7;
-constexpr int jab_page    = VK_F1;
-constexpr int stab_key    = VK_8;
-constexpr int stab_page   = VK_F1;
-constexpr int stab2_key   = VK_9;
-constexpr int stab2_page  = VK_F1;
-constexpr int stroke_key  = VK_0;
-constexpr int stroke_page = VK_F1;
-
 /**
  * @brief Simulates the press of multiple keys using the `send_raw_key` function.
  *
@@ -147,6 +121,7 @@ void send_multiple_keys(Keys&&... keys)
 
 void send_raw_key(const uint16_t& key, const uint8_t& key_press_release_delay_in_ms)
 {
+     SYSTRACE_SCOPE("send_raw_key");
 
      //Translating virtual-code to scan code for Knight Online.
      uint16_t scan_code = MapVirtualKey(key, 0);
@@ -171,7 +146,7 @@ void send_raw_key(const uint16_t& key, const uint8_t& key_press_release_delay_in
      }
 
      //Time it takes to relase the key
-     Sleep(key_press_release_delay_in_ms);
+     precise_sleep_for(std::chrono::milliseconds(key_press_release_delay_in_ms));
 
      // Simulate key release
      KEYBDINPUT key_up;
@@ -188,6 +163,6 @@ void send_raw_key(const uint16_t& key, const uint8_t& key_press_release_delay_in
           // SYSLOG_ERROR("Key_up event failed with error code: " << GetLastError() << "\nFailed Scan Code: " << scan_code << "\nFailed Virtual Key: " << key);
           return;
      }
-     Sleep(1);
+     precise_sleep_for(std::chrono::milliseconds(1));
 }
 #endif
\ No newline at end of file
@@ -1,5 +1,12 @@
-#include <iostream>
-#include <sstream>
+#ifndef SYSCORE_LOG_H
+#define SYSCORE_LOG_H
+#include "sc_format.h"
+
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <streambuf>
+#include <string>
 
 
 
@@ -29,12 +36,27 @@
  *       SYSLOG_ERROR("This is an error message.");
  *       SYSLOG_DEBUG("This is a debug message.");
  *       SYSLOG_SUCCESS("This is a success message.");
+ *       SYSLOG_INFOF("Cooldown {:.2} s at {}\n", cooldown, address); // (Format string checked at compile time.)
  *       return 0;
  *   }
  * @endcode
  *
  * The output will be formatted with ANSI escape codes for colors, making it
  * visually distinguishable based on the log level.
+ *
+ * Each macro has an F variant (SYSLOG_INFOF, ...) that takes a format string and its arguments instead of a stream
+ * expression, see sc_format.h for the placeholders. The format string is checked against the arguments at compile time,
+ * and the arguments are written without iostream and without allocating, which suits the hot loops.
+ *
+ * The messages are written by a background thread, so that logging never waits on the console. A macro formats its
+ * message into a fixed buffer of the calling thread, and pushes it as a record into a lock-free ring shared by every
+ * thread. The writer thread drains the ring, and writes the records to the console and to the log file of LOG_CONFIG
+ * in one batch. Only a message longer than LOG_RECORD::text_capacity allocates: its end is kept in a string of the thread,
+ * and pushed as continuation records. When the ring is full, the message is dropped and counted (LOG_FULL_POLICY::DROP,
+ * the default), or the caller waits for a free record (LOG_FULL_POLICY::BLOCK).
+ *
+ * Define SYSCORE_LOG_IMPLEMENTATION in one translation unit. The records still queued at exit are written out, call
+ * log_flush() before writing to std::cout directly, so that the outputs stay in order.
  */
 
 #define ANSI_COLOR_RESET   "\x1b[0m"
@@ -45,11 +67,154 @@
 #define ANSI_COLOR_MAGENTA "\x1b[35m"
 #define ANSI_COLOR_BLUE    "\x1b[36m"
 
+/**
+ * @brief What a caller does when the ring of records is full.
+ */
+enum class LOG_FULL_POLICY : uint8_t
+{
+    DROP,   // Drops the message, the writer reports how many were dropped.
+    BLOCK   // Waits for the writer to free a record.
+};
+
+/**
+ * @brief Where the writer thread writes the records, see log_configure.
+ */
+struct LOG_CONFIG
+{
+    LOG_FULL_POLICY full_policy = LOG_FULL_POLICY::DROP;
+    bool to_console = true;
+    const char *file_path = nullptr;    // Also appended to this file without the colours, if set.
+};
+
+/**
+ * @brief A formatted message, as pushed into the ring.
+ */
+struct LOG_RECORD
+{
+    static constexpr size_t text_capacity = 238;
+
+    const char *level;      // String literals, only their addresses are kept. Empty for a continuation record.
+    const char *colour;
+    uint16_t length;
+    char text[text_capacity];
+};
+
+/**
+ * @class LOG_FORMATTER
+ *
+ * @brief What a thread formats its messages with, writing straight into a LOG_RECORD so that nothing is allocated.
+ *
+ * The part of a message that does not fit in the record goes to overflow_text, which keeps its capacity from one
+ * message to the next.
+ */
+class LOG_FORMATTER : private std::streambuf
+{
+    private:
+        LOG_RECORD record;
+        std::string overflow_text;
+
+        int_type overflow(int_type character) override
+        {
+            if (!traits_type::eq_int_type(character, traits_type::eof())) overflow_text.push_back(traits_type::to_char_type(character));
+            return traits_type::not_eof(character);
+        }
+
+        std::streamsize xsputn(const char *text, std::streamsize size) override
+        {
+            FORMAT_OUTPUT output {pptr(), (size_t) (epptr() - pptr()), &overflow_text};
+            output.write(text, (size_t) size);
+            pbump((int) (output.position() - pptr()));
+            return size;
+        }
+
+    public:
+        std::ostream stream {this};
+
+        /**
+         * @brief Starts a new message, with the default formatting of a new stream.
+         */
+        void begin(const char *level, const char *colour)
+        {
+            record.level = level;
+            record.colour = colour;
+            overflow_text.clear();
+            setp(record.text, record.text + LOG_RECORD::text_capacity);
+
+            stream.clear();
+            stream.flags(std::ios::dec | std::ios::skipws);
+            stream.precision(6);
+            stream.width(0);
+            stream.fill(' ');
+        }
+
+        /**
+         * @brief Writes a format string and its arguments, see format_write.
+         */
+        template<typename... T>
+        void write(const char *format, const T&... arguments)
+        {
+            FORMAT_OUTPUT output {pptr(), (size_t) (epptr() - pptr()), &overflow_text};
+            format_write(output, format, arguments...);
+            pbump((int) (output.position() - pptr()));
+        }
+
+        /**
+         * @brief Returns the record of the message formatted since begin.
+         */
+        const LOG_RECORD& finish()
+        {
+            record.length = (uint16_t) (pptr() - pbase());
+            return record;
+        }
+
+        /**
+         * @brief Returns the end of the message that did not fit in the record.
+         */
+        const std::string& get_overflow_text() const { return overflow_text; }
+};
+
+/**
+ * @brief Returns the formatter of the calling thread.
+ */
+LOG_FORMATTER& this_thread_log_formatter();
+
+/**
+ * @brief Pushes the message of a formatter for the writer thread, following the LOG_FULL_POLICY when the ring is full.
+ */
+void log_submit(LOG_FORMATTER& formatter);
+
+/**
+ * @brief Sets where the records are written and the full ring policy. Records already queued may be written with the new config.
+ *
+ * @return false if the log file can't be opened, the console output is applied anyway.
+ */
+bool log_configure(const LOG_CONFIG& config);
+
+/**
+ * @brief Waits until every record pushed before the call is written.
+ */
+void log_flush();
+
+/**
+ * @brief Number of messages dropped because the ring was full.
+ */
+uint64_t log_dropped_count();
+
 #define LOG_FORMAT(level, colour, ...) \
 do { \
-    std::ostringstream oss; \
-    oss << colour ANSI_BOLD level << __VA_ARGS__; \
-    std::cout << oss.str() << ANSI_COLOR_RESET; \
+    LOG_FORMATTER& log_formatter = this_thread_log_formatter(); \
+    log_formatter.begin(level, colour); \
+    log_formatter.stream << __VA_ARGS__; \
+    log_submit(log_formatter); \
+} while(0)
+
+#define LOG_FORMAT_CHECKED(level, colour, ...) \
+do { \
+    FORMAT_CHECK(__VA_ARGS__); \
+    LOG_FORMATTER& log_formatter = this_thread_log_formatter(); \
+    log_formatter.begin(level, colour); \
+    log_formatter.write(__VA_ARGS__); \
+    log_submit(log_formatter); \
 } while(0)
 
 
@@ -59,28 +224,255 @@ do { \
 
 #if LOGGING_LEVEL <= 1
     #define SYSLOG_INFO(...)  LOG_FORMAT("[INFO] ", ANSI_COLOR_MAGENTA, __VA_ARGS__)
+    #define SYSLOG_INFOF(...) LOG_FORMAT_CHECKED("[INFO] ", ANSI_COLOR_MAGENTA, __VA_ARGS__)
 #else
     #define SYSLOG_INFO(...) {}
+    #define SYSLOG_INFOF(...) {}
 #endif
 
 #if LOGGING_LEVEL <= 2
     #define SYSLOG_WARN(...)  LOG_FORMAT("[WARN] ", ANSI_COLOR_YELLOW, __VA_ARGS__ )
+    #define SYSLOG_WARNF(...) LOG_FORMAT_CHECKED("[WARN] ", ANSI_COLOR_YELLOW, __VA_ARGS__)
 #else
     #define SYSLOG_WARN(...) {}
+    #define SYSLOG_WARNF(...) {}
 #endif
 
 #if LOGGING_LEVEL <= 3
     #define SYSLOG_ERROR(...) LOG_FORMAT("[ERROR] ", ANSI_COLOR_RED, __VA_ARGS__)
+    #define SYSLOG_ERRORF(...) LOG_FORMAT_CHECKED("[ERROR] ", ANSI_COLOR_RED, __VA_ARGS__)
 #else
     #define SYSLOG_ERROR(...) {}
+    #define SYSLOG_ERRORF(...) {}
 #endif
 
 
 #ifdef DEBUG
      #define SYSLOG_DEBUG(...) LOG_FORMAT("[DEBUG] ", ANSI_COLOR_BLUE, __VA_ARGS__)
+     #define SYSLOG_DEBUGF(...) LOG_FORMAT_CHECKED("[DEBUG] ", ANSI_COLOR_BLUE, __VA_ARGS__)
 #else
      #define SYSLOG_DEBUG(...) {}
+     #define SYSLOG_DEBUGF(...) {}
 #endif
 
 
 #define SYSLOG_SUCCESS(...) LOG_FORMAT("[OK] ", ANSI_COLOR_GREEN, __VA_ARGS__)
+#define SYSLOG_SUCCESSF(...) LOG_FORMAT_CHECKED("[OK] ", ANSI_COLOR_GREEN, __VA_ARGS__)
+
+#endif
+
+#ifdef SYSCORE_LOG_IMPLEMENTATION
+#pragma once
+#include "sc_mpsc_queue.h"
+#include "sc_trace.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+    struct LOG_BACKEND
+    {
+        static constexpr size_t capacity = 1 << 10;
+        static constexpr std::chrono::milliseconds idle_wait {50};  // Bounds the wake up of a push that raced with the writer going idle.
+
+        MPSC_QUEUE<LOG_RECORD, capacity> records;
+        std::atomic<LOG_FULL_POLICY> full_policy {LOG_FULL_POLICY::DROP};
+        std::atomic<uint64_t> dropped_count {0};
+        std::atomic<bool> is_writer_idle {false};
+        std::atomic<bool> is_stopped {false};   // Set once the writer exited, the records are then written by their callers.
+
+        std::mutex mutex;                       // Guards the outputs, the written count and the idle wait.
+        std::condition_variable wake_writer;
+        std::condition_variable wake_flushers;
+        bool to_console = true;
+        std::ofstream file;
+        uint64_t written_count = 0;
+        bool is_stopping = false;
+        std::thread writer;
+
+        LOG_BACKEND() : writer(&LOG_BACKEND::run, this) {}
+
+        void append(std::string& text, const LOG_RECORD& record, bool is_coloured)
+        {
+            if (is_coloured) text.append(record.colour).append(ANSI_BOLD);
+            text.append(record.level).append(record.text, record.length);
+            if (is_coloured) text.append(ANSI_COLOR_RESET);
+        }
+
+        void write(const std::string& console_text, const std::string& file_text)
+        {
+            if (to_console && !console_text.empty())
+            {
+                std::cout.write(console_text.data(), (std::streamsize) console_text.size());
+                std::cout.flush();
+            }
+            if (file.is_open() && !file_text.empty())
+            {
+                file.write(file_text.data(), (std::streamsize) file_text.size());
+                file.flush();
+            }
+        }
+
+        void run()
+        {
+            SYSTRACE_THREAD_NAME("log writer");
+            std::string console_text, file_text;
+            LOG_RECORD record;
+            uint64_t popped_count = 0, reported_dropped_count = 0;
+
+            while (true)
+            {
+                console_text.clear();
+                file_text.clear();
+                uint64_t batch_count = 0;
+                while (batch_count < capacity && records.try_pop(record))
+                {
+                    append(console_text, record, true);
+                    append(file_text, record, false);
+                    batch_count++;
+                }
+                popped_count += batch_count;
+
+                const uint64_t current_dropped_count = dropped_count.load(std::memory_order_relaxed);
+                if (current_dropped_count != reported_dropped_count)
+                {
+                    LOG_RECORD dropped_record {"[WARN] ", ANSI_COLOR_YELLOW, 0, {}};
+                    std::string message = std::to_string(current_dropped_count - reported_dropped_count) + " log messages dropped, the log ring was full.\n";
+                    dropped_record.length = (uint16_t) message.copy(dropped_record.text, LOG_RECORD::text_capacity);
+                    append(console_text, dropped_record, true);
+                    append(file_text, dropped_record, false);
+                    reported_dropped_count = current_dropped_count;
+                }
+
+                std::unique_lock<std::mutex> lock(mutex);
+                write(console_text, file_text);
+                written_count = popped_count;
+                wake_flushers.notify_all();
+                if (batch_count > 0) continue;
+                if (is_stopping && records.push_count() == popped_count) break;
+
+                is_writer_idle.store(true);
+                wake_writer.wait_for(lock, idle_wait, [&]() { return is_stopping || records.push_count() != popped_count; });
+                is_writer_idle.store(false);
+            }
+        }
+
+        void wake()
+        {
+            if (!is_writer_idle.load()) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            wake_writer.notify_one();
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                is_stopping = true;
+                wake_writer.notify_one();
+            }
+            writer.join();
+            is_stopped.store(true, std::memory_order_release);
+
+            // The records published while the writer exited, a push still in flight is lost.
+            std::string console_text, file_text;
+            LOG_RECORD record;
+            while (records.try_pop(record))
+            {
+                append(console_text, record, true);
+                append(file_text, record, false);
+            }
+            write(console_text, file_text);
+        }
+    };
+
+    // Never destroyed, so that the threads still logging during the exit find it. Its guard writes the queued records out at exit.
+    static LOG_BACKEND& log_backend()
+    {
+        static LOG_BACKEND *backend = new LOG_BACKEND();
+        static struct LOG_BACKEND_GUARD
+        {
+            ~LOG_BACKEND_GUARD() { backend->stop(); }
+        } guard;
+        return *backend;
+    }
+
+    LOG_FORMATTER& this_thread_log_formatter()
+    {
+        thread_local LOG_FORMATTER formatter;
+        return formatter;
+    }
+
+    static bool log_push(LOG_BACKEND& backend, const LOG_RECORD& record)
+    {
+        while (!backend.records.try_push(record))
+        {
+            if (backend.full_policy.load(std::memory_order_relaxed) == LOG_FULL_POLICY::DROP)
+            {
+                backend.dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            backend.wake();
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void log_submit(LOG_FORMATTER& formatter)
+    {
+        LOG_BACKEND& backend = log_backend();
+        const LOG_RECORD& record = formatter.finish();
+        const std::string& overflow_text = formatter.get_overflow_text();
+        if (backend.is_stopped.load(std::memory_order_acquire))
+        {
+            std::cout << record.colour << ANSI_BOLD << record.level;
+            std::cout.write(record.text, record.length);
+            std::cout << overflow_text << ANSI_COLOR_RESET;
+            return;
+        }
+
+        // The end of a long message follows in records of its own, another thread may push its records in between.
+        bool is_pushed = log_push(backend, record);
+        LOG_RECORD continuation {"", record.colour, 0, {}};
+        for (size_t offset = 0; is_pushed && offset < overflow_text.size(); offset += continuation.length)
+        {
+            continuation.length = (uint16_t) overflow_text.copy(continuation.text, LOG_RECORD::text_capacity, offset);
+            is_pushed = log_push(backend, continuation);
+        }
+        backend.wake();
+    }
+
+    bool log_configure(const LOG_CONFIG& config)
+    {
+        LOG_BACKEND& backend = log_backend();
+        backend.full_policy.store(config.full_policy, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(backend.mutex);
+        backend.to_console = config.to_console;
+        if (backend.file.is_open()) backend.file.close();
+        if (!config.file_path) return true;
+
+        backend.file.open(config.file_path, std::ios::app);
+        return backend.file.is_open();
+    }
+
+    void log_flush()
+    {
+        LOG_BACKEND& backend = log_backend();
+        const uint64_t pushed_count = backend.records.push_count();
+
+        std::unique_lock<std::mutex> lock(backend.mutex);
+        backend.wake_writer.notify_one();
+        backend.wake_flushers.wait(lock, [&]() { return backend.written_count >= pushed_count || backend.is_stopping; });
+    }
+
+    uint64_t log_dropped_count()
+    {
+        return log_backend().dropped_count.load(std::memory_order_relaxed);
+    }
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef SYSCORE_MPSC_QUEUE_H
+#define SYSCORE_MPSC_QUEUE_H
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+/**
+ * @class MPSC_QUEUE
+ *
+ * @brief A bounded queue from any number of producer threads to one consumer thread, without locks.
+ *
+ * Every slot of the ring carries a sequence number that tells whose turn it is (the bounded queue of D. Vyukov). A
+ * producer claims the next slot with a compare and swap of the tail, fills it, then publishes it by advancing its
+ * sequence, so the producers never wait for each other to finish copying. The consumer pops the slots in order, and
+ * waits for a claimed slot to be published before it moves past it.
+ *
+ * @code
+ *   MPSC_QUEUE<RECORD, 1024> queue;
+ *   queue.try_push(record);                 // Any thread.
+ *   RECORD next;
+ *   if (queue.try_pop(next)) { ... }        // Consumer thread.
+ * @endcode
+ */
+template<typename T, size_t capacity>
+class MPSC_QUEUE
+{
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "MPSC_QUEUE capacity must be a power of two.");
+    static_assert(std::is_trivially_copyable<T>::value, "MPSC_QUEUE items are copied in and out of the ring.");
+
+    private:
+        static constexpr size_t cache_line_size = 64;
+        static constexpr size_t index_mask = capacity - 1;
+
+        struct SLOT
+        {
+            std::atomic<size_t> sequence; // Equal to the push index when free, to the push index + 1 once published.
+            T item;
+        };
+
+        alignas(cache_line_size) std::atomic<size_t> tail {0}; // Next push index, claimed by the producers.
+        alignas(cache_line_size) size_t head = 0;               // Next pop index, only used by the consumer.
+        alignas(cache_line_size) SLOT slots[capacity];
+
+    public:
+        MPSC_QUEUE()
+        {
+            for (size_t i = 0; i < capacity; i++) slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        MPSC_QUEUE(const MPSC_QUEUE&) = delete;
+        MPSC_QUEUE& operator=(const MPSC_QUEUE&) = delete;
+
+        /**
+         * @brief Adds an item. Can be called from any thread.
+         *
+         * @return false if the queue is full.
+         */
+        bool try_push(const T& item) noexcept
+        {
+            size_t position = tail.load(std::memory_order_relaxed);
+            SLOT *slot;
+            while (true)
+            {
+                slot = &slots[position & index_mask];
+                const intptr_t distance = (intptr_t) slot->sequence.load(std::memory_order_acquire) - (intptr_t) position;
+                if (distance == 0)
+                {
+                    if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                }
+                else if (distance < 0) return false; // The slot still holds the item of the previous lap.
+                else position = tail.load(std::memory_order_relaxed);
+            }
+
+            slot->item = item;
+            slot->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Removes the oldest item. Must only be called by the consumer thread.
+         *
+         * @return false if the queue is empty, or if the oldest item is claimed but not published yet.
+         */
+        bool try_pop(T& item) noexcept
+        {
+            SLOT& slot = slots[head & index_mask];
+            if (slot.sequence.load(std::memory_order_acquire) != head + 1) return false;
+
+            item = slot.item;
+            slot.sequence.store(head + capacity, std::memory_order_release);
+            head++;
+            return true;
+        }
+
+        /**
+         * @brief Number of items pushed so far.
+         */
+        size_t push_count() const noexcept { return tail.load(std::memory_order_acquire); }
+};
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef SYSCORE_SCHEDULER_H
+#define SYSCORE_SCHEDULER_H
+#include "sc_time.h"
+#include "sc_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @class SKILL_SCHEDULER
+ *
+ * @brief Sends skills when their cooldown runs out, and sleeps in between.
+ *
+ * Every skill is given a predicted ready time: the remaining cooldown it had in the last sample of the state, added to
+ * the time of that sample. The skills wait in a queue ordered by that time, and the scheduler sleeps until the earliest
+ * one is due, instead of polling all of them in a loop. Among the skills that are ready together, the one with the
+ * highest priority is sent first.
+ *
+ * A skill whose send fails is backed off for retry_delay, and the next ready skill is sent instead, so that a skill that
+ * can't be used (out of mana, no target) doesn't starve the others.
+ *
+ * A rotation can be set to send the skills in a fixed order instead: the scheduler then only waits for the next skill
+ * of the rotation.
+ *
+ * @code
+ *   SKILL_SCHEDULER<PLAYER_STATE> scheduler {sample_player_state, SKILL_TABLE::ready_cooldown};
+ *   scheduler.add_skill({"spike", 0, send_spike, 2});      // Cooldown in state.cooldowns[0].
+ *   scheduler.add_skill({"thrust", 1, send_thrust, 1});
+ *   while(1) scheduler.run_once();
+ * @endcode
+ */
+template<typename STATE>
+class SKILL_SCHEDULER
+{
+    public:
+        using CLOCK = std::chrono::steady_clock;
+
+        struct SKILL
+        {
+            const char *name;
+            size_t cooldown_index;          // Index of the remaining cooldown of the skill in STATE::cooldowns, in seconds.
+            std::function<bool()> send;     // Presses the skill, returns true once it went into cooldown.
+            int32_t priority = 0;           // Among the skills that are ready together, the highest is sent first.
+        };
+
+        // Fills the state, and the time it was sampled at.
+        using SAMPLE_FUNC = std::function<void(STATE& state, CLOCK::time_point& sampled_at)>;
+
+    private:
+        struct QUEUED_SKILL
+        {
+            CLOCK::time_point ready_at;
+            int32_t priority;
+            size_t skill_index;
+        };
+
+        // Earliest ready time on top, then highest priority.
+        struct IS_READY_LATER
+        {
+            bool operator()(const QUEUED_SKILL& a, const QUEUED_SKILL& b) const
+            {
+                if (a.ready_at != b.ready_at) return a.ready_at > b.ready_at;
+                if (a.priority != b.priority) return a.priority < b.priority;
+                return a.skill_index > b.skill_index;
+            }
+        };
+
+        // Highest priority on top, then the skill that has been ready the longest.
+        struct HAS_LOWER_PRIORITY
+        {
+            bool operator()(const QUEUED_SKILL& a, const QUEUED_SKILL& b) const
+            {
+                if (a.priority != b.priority) return a.priority < b.priority;
+                if (a.ready_at != b.ready_at) return a.ready_at > b.ready_at;
+                return a.skill_index > b.skill_index;
+            }
+        };
+
+        SAMPLE_FUNC sample;
+        float ready_cooldown;      // A cooldown under this means the skill can be used.
+        CLOCK::duration max_sleep; // Upper bound of a sleep, so that cooldowns that change unexpectedly are noticed.
+        CLOCK::duration min_sleep; // Lower bound of a sleep, while waiting for a sample newer than a predicted ready time.
+        CLOCK::duration retry_delay; // How long a skill whose send failed waits before it is sent again.
+
+        std::vector<SKILL> skills;
+        std::vector<CLOCK::time_point> retry_at; // Per skill, the end of its back off after a failed send.
+        std::vector<size_t> rotation; // Skill indices, in the order they are sent. Empty to send by priority.
+        size_t rotation_step = 0;
+
+        std::priority_queue<QUEUED_SKILL, std::vector<QUEUED_SKILL>, IS_READY_LATER> waiting_skills;
+        std::priority_queue<QUEUED_SKILL, std::vector<QUEUED_SKILL>, HAS_LOWER_PRIORITY> ready_skills;
+
+        // Queues a skill as ready, or as waiting until the later of its predicted ready time and the end of its back off.
+        void queue_skill(const STATE& state, CLOCK::time_point sampled_at, size_t skill_index)
+        {
+            const SKILL& skill = skills[skill_index];
+            const float cooldown = state.cooldowns[skill.cooldown_index];
+            const auto remaining = std::chrono::duration_cast<CLOCK::duration>(std::chrono::duration<float>(std::max(cooldown, 0.0f)));
+
+            if (cooldown <= ready_cooldown && retry_at[skill_index] <= sampled_at) ready_skills.push({sampled_at, skill.priority, skill_index});
+            else waiting_skills.push({std::max(sampled_at + remaining, retry_at[skill_index]), skill.priority, skill_index});
+        }
+
+        // Queues the skills that can be sent next from a sample of the state: the ready ones by priority, the others by ready time.
+        void queue_skills(const STATE& state, CLOCK::time_point sampled_at)
+        {
+            waiting_skills = {};
+            ready_skills = {};
+
+            if (!rotation.empty()) queue_skill(state, sampled_at, rotation[rotation_step]);
+            else for (size_t i = 0; i < skills.size(); i++) queue_skill(state, sampled_at, i);
+        }
+
+    public:
+        /**
+         * @param sample Called once per run_once to get the cooldowns. Should be cheap, such as a load of a published snapshot.
+         * @param ready_cooldown A cooldown under this means the skill can be used, the threshold of the source of the cooldowns.
+         * @param max_sleep Longest the scheduler sleeps without a new sample.
+         * @param min_sleep Shortest sleep, used when a skill is past its predicted ready time but the sample doesn't show it yet.
+         * @param retry_delay Back off of a skill whose send failed.
+         */
+        explicit SKILL_SCHEDULER(SAMPLE_FUNC sample, float ready_cooldown, CLOCK::duration max_sleep = std::chrono::milliseconds(50),
+                                 CLOCK::duration min_sleep = std::chrono::milliseconds(1), CLOCK::duration retry_delay = std::chrono::milliseconds(250))
+            : sample(std::move(sample)), ready_cooldown(ready_cooldown), max_sleep(max_sleep), min_sleep(min_sleep), retry_delay(retry_delay) {}
+
+        /**
+         * @brief Adds a skill to the scheduler.
+         *
+         * @return size_t The index of the skill, to define a rotation with.
+         */
+        size_t add_skill(SKILL skill)
+        {
+            skills.push_back(std::move(skill));
+            retry_at.push_back(CLOCK::time_point::min());
+            return skills.size() - 1;
+        }
+
+        /**
+         * @brief Sends the skills in the given order, each one as soon as it is ready, regardless of their priority.
+         *
+         * A send that fails doesn't hold the rotation, the skill is backed off and the rotation moves on to the next
+         * skill. An empty rotation goes back to sending by priority.
+         *
+         * @param skill_indices Indices returned by add_skill. A skill can appear more than once.
+         */
+        void set_rotation(std::vector<size_t> skill_indices)
+        {
+            rotation = std::move(skill_indices);
+            rotation_step = 0;
+        }
+
+        [[nodiscard]] const std::vector<SKILL>& get_skills() const noexcept { return skills; }
+
+        /**
+         * @brief Samples the state, then either sends the skill that is due or sleeps until the earliest one is.
+         *
+         * The ready skills are tried by priority until one is sent. Those that fail are backed off for retry_delay.
+         *
+         * @return size_t The index of the skill that was sent, SIZE_MAX if the scheduler slept instead.
+         */
+        size_t run_once()
+        {
+            SYSTRACE_SCOPE("SKILL_SCHEDULER::run_once");
+            STATE state {};
+            CLOCK::time_point sampled_at;
+            sample(state, sampled_at);
+            queue_skills(state, sampled_at);
+
+            while (!ready_skills.empty())
+            {
+                const size_t skill_index = ready_skills.top().skill_index;
+                ready_skills.pop();
+
+                const bool is_sent = skills[skill_index].send();
+                if (!rotation.empty()) rotation_step = (rotation_step + 1) % rotation.size();
+                if (is_sent) return skill_index;
+
+                // Every failure backs a skill off, so this ends once each ready skill was tried.
+                retry_at[skill_index] = CLOCK::now() + retry_delay;
+                waiting_skills.push({retry_at[skill_index], skills[skill_index].priority, skill_index});
+                if (!rotation.empty()) queue_skill(state, sampled_at, rotation[rotation_step]);
+            }
+
+            const CLOCK::time_point now = CLOCK::now();
+            CLOCK::time_point wake_up_at = now + max_sleep;
+            if (!waiting_skills.empty())
+                wake_up_at = std::min(wake_up_at, std::max(waiting_skills.top().ready_at, now + min_sleep));
+
+            precise_sleep_until(wake_up_at);
+            return SIZE_MAX;
+        }
+};
+
+#endif
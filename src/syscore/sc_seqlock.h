@@ -0,0 +1,80 @@
+#ifndef SYSCORE_SEQLOCK_H
+#define SYSCORE_SEQLOCK_H
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+/**
+ * @class SEQLOCK
+ *
+ * @brief Publishes a value from one writer thread to any number of reader threads, without locks.
+ *
+ * The writer never waits. Readers retry while a store is in progress, so they always get a whole value from a
+ * single store, never a mix of two. Meant for small, frequently updated snapshots that are read more than written.
+ *
+ * The value is kept as relaxed atomic words, and ordered with fences around the sequence counter (the seqlock of
+ * H. Boehm, "Can Seqlocks Get Along With Programming Language Memory Models?"), so there is no data race.
+ *
+ * @code
+ *   SEQLOCK<PLAYER_STATE> state;
+ *   state.store(sampled_state);            // Writer thread.
+ *   PLAYER_STATE current = state.load();   // Any thread.
+ * @endcode
+ */
+template<typename T>
+class SEQLOCK
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SEQLOCK values are copied byte by byte.");
+
+    private:
+        static constexpr size_t word_count = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        std::atomic<uint32_t> sequence {0}; // Odd while a store is in progress.
+        std::atomic<uint64_t> words[word_count] = {};
+
+    public:
+        /**
+         * @brief Publishes a new value. Must only be called by one thread.
+         */
+        void store(const T& value) noexcept
+        {
+            uint64_t value_words[word_count] = {};
+            memcpy(value_words, &value, sizeof(T));
+
+            const uint32_t current_sequence = sequence.load(std::memory_order_relaxed);
+            sequence.store(current_sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for(size_t i = 0; i < word_count; i++) words[i].store(value_words[i], std::memory_order_relaxed);
+
+            sequence.store(current_sequence + 2, std::memory_order_release);
+        }
+
+        /**
+         * @brief Returns the last published value, or a zero value if nothing was published yet.
+         */
+        T load() const noexcept
+        {
+            uint64_t value_words[word_count];
+            uint32_t sequence_before, sequence_after;
+            do
+            {
+                sequence_before = sequence.load(std::memory_order_acquire);
+                for(size_t i = 0; i < word_count; i++) value_words[i] = words[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                sequence_after = sequence.load(std::memory_order_relaxed);
+            } while((sequence_before & 1) || sequence_before != sequence_after);
+
+            T value;
+            memcpy(&value, value_words, sizeof(T));
+            return value;
+        }
+
+        /**
+         * @brief Number of values published so far.
+         */
+        uint32_t version() const noexcept { return sequence.load(std::memory_order_acquire) / 2; }
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef SYSCORE_SPSC_QUEUE_H
+#define SYSCORE_SPSC_QUEUE_H
+#include <atomic>
+#include <stddef.h>
+#include <type_traits>
+
+/**
+ * @class SPSC_QUEUE
+ *
+ * @brief A bounded queue between one producer thread and one consumer thread, without locks.
+ *
+ * The items live in a ring of capacity slots. The producer only writes the tail and the consumer only writes the head,
+ * each on its own cache line, and each side keeps a copy of the other's index so that it only reads the shared one when
+ * the ring looks full or empty.
+ *
+ * @code
+ *   SPSC_QUEUE<REQUEST, 64> queue;
+ *   queue.try_push(request);               // Producer thread.
+ *   REQUEST next;
+ *   if (queue.try_pop(next)) { ... }        // Consumer thread.
+ * @endcode
+ */
+template<typename T, size_t capacity>
+class SPSC_QUEUE
+{
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "SPSC_QUEUE capacity must be a power of two.");
+    static_assert(std::is_trivially_copyable<T>::value, "SPSC_QUEUE items are copied in and out of the ring.");
+
+    private:
+        static constexpr size_t cache_line_size = 64;
+        static constexpr size_t index_mask = capacity - 1;
+
+        alignas(cache_line_size) std::atomic<size_t> head {0}; // Next slot to pop, written by the consumer.
+        size_t cached_tail = 0;                                 // Consumer's copy of the tail.
+
+        alignas(cache_line_size) std::atomic<size_t> tail {0}; // Next slot to push, written by the producer.
+        size_t cached_head = 0;                                 // Producer's copy of the head.
+
+        alignas(cache_line_size) T slots[capacity];
+
+    public:
+        /**
+         * @brief Adds an item. Must only be called by the producer thread.
+         *
+         * @return false if the queue is full.
+         */
+        bool try_push(const T& item) noexcept
+        {
+            const size_t current_tail = tail.load(std::memory_order_relaxed);
+            if (current_tail - cached_head == capacity)
+            {
+                cached_head = head.load(std::memory_order_acquire);
+                if (current_tail - cached_head == capacity) return false;
+            }
+
+            slots[current_tail & index_mask] = item;
+            tail.store(current_tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Removes the oldest item. Must only be called by the consumer thread.
+         *
+         * @return false if the queue is empty.
+         */
+        bool try_pop(T& item) noexcept
+        {
+            const size_t current_head = head.load(std::memory_order_relaxed);
+            if (current_head == cached_tail)
+            {
+                cached_tail = tail.load(std::memory_order_acquire);
+                if (current_head == cached_tail) return false;
+            }
+
+            item = slots[current_head & index_mask];
+            head.store(current_head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Whether the queue looks empty. Exact from the consumer thread, a hint from any other.
+         */
+        bool is_empty() const noexcept { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+};
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef SYSCORE_TIME_H
+#define SYSCORE_TIME_H
+#include "windows.h"
+#include "sc_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdint.h>
+
+/**
+ * @brief How late the sleeps of a PRECISE_SLEEPER woke up.
+ */
+struct SLEEP_STATISTICS
+{
+    uint64_t sleep_count = 0;
+    double total_overshoot_us = 0.0;  // Sum of the time past each deadline.
+    double max_overshoot_us = 0.0;
+    double spin_margin_us = 0.0;      // Current calibrated spin before each deadline.
+
+    double mean_overshoot_us() const { return sleep_count ? total_overshoot_us / sleep_count : 0.0; }
+};
+
+/**
+ * @class PRECISE_SLEEPER
+ *
+ * @brief Sleeps until a deadline with an accuracy well under a millisecond, without spinning for the whole sleep.
+ *
+ * Sleep() wakes up at the next tick of the system timer, 15.6 ms apart by default. This sleeper waits on a high
+ * resolution waitable timer instead, until a margin before the deadline, then spins for the rest of it. The margin is
+ * calibrated from how late the timer actually wakes up: its mean lateness plus three mean deviations, so that nearly
+ * every wake up lands before the deadline and the spin stays short.
+ *
+ * Where high resolution timers are not supported (before Windows 10 1803), the system timer resolution is raised to
+ * 1 ms with timeBeginPeriod, and a regular waitable timer is used.
+ *
+ * The spin is worth it for the few sleeps whose timing is visible, such as key holds. A periodic loop that only needs to
+ * run roughly on time, such as a poller, should use timer_sleep_until or timer_sleep_for instead, which wait on the
+ * timer until the deadline and never spin.
+ *
+ * A sleeper owns a timer and must only be used by one thread, precise_sleep_for and precise_sleep_until use one sleeper
+ * per thread.
+ *
+ * @code
+ *   precise_sleep_for(std::chrono::milliseconds(10));
+ *   SLEEP_STATISTICS statistics = this_thread_sleeper().get_statistics();
+ * @endcode
+ */
+class PRECISE_SLEEPER
+{
+    private:
+        using CLOCK = std::chrono::steady_clock;
+
+        static constexpr double calibration_rate = 0.1; // Weight of a new wake up in the lateness estimates.
+        static constexpr double min_spin_margin_ns = 50000.0;
+
+        HANDLE timer;
+        double max_spin_margin_ns;            // The timer lateness estimates are clamped to it.
+        double timer_lateness_ns;             // Moving mean of how late the timer woke up.
+        double timer_lateness_deviation_ns;   // Moving mean of the distance to the mean.
+        SLEEP_STATISTICS statistics;
+
+        CLOCK::duration spin_margin() const;
+        void calibrate(double lateness_ns);
+
+        // Waits on the timer until timer_deadline, and updates now. Returns false if the timer could not be waited on.
+        bool wait_timer(CLOCK::time_point timer_deadline, CLOCK::time_point& now);
+        void record_wake_up(CLOCK::time_point deadline, CLOCK::time_point now);
+
+    public:
+        /**
+         * @brief Construct a new PRECISE_SLEEPER and create its timer.
+         */
+        PRECISE_SLEEPER();
+
+        ~PRECISE_SLEEPER();
+
+        PRECISE_SLEEPER(const PRECISE_SLEEPER&) = delete;
+        PRECISE_SLEEPER& operator=(const PRECISE_SLEEPER&) = delete;
+
+        /**
+         * @brief Sleeps until the deadline. Returns at once if it is past.
+         */
+        void sleep_until(CLOCK::time_point deadline);
+
+        /**
+         * @brief Sleeps for the duration.
+         */
+        void sleep_for(CLOCK::duration duration) { sleep_until(CLOCK::now() + duration); }
+
+        /**
+         * @brief Sleeps until the deadline on the timer alone, without spinning. Wakes up as late as the timer does.
+         */
+        void timer_sleep_until(CLOCK::time_point deadline);
+
+        /**
+         * @brief Sleeps for the duration on the timer alone, without spinning.
+         */
+        void timer_sleep_for(CLOCK::duration duration) { timer_sleep_until(CLOCK::now() + duration); }
+
+        /**
+         * @brief Returns the overshoot statistics of the sleeps so far.
+         */
+        SLEEP_STATISTICS get_statistics() const;
+
+        void reset_statistics() { statistics = {}; }
+};
+
+/**
+ * @brief Returns the sleeper of the calling thread.
+ */
+PRECISE_SLEEPER& this_thread_sleeper();
+
+/**
+ * @brief Sleeps until the deadline, with the sleeper of the calling thread.
+ */
+inline void precise_sleep_until(std::chrono::steady_clock::time_point deadline) { this_thread_sleeper().sleep_until(deadline); }
+
+/**
+ * @brief Sleeps for the duration, with the sleeper of the calling thread.
+ */
+template<typename REP, typename PERIOD>
+inline void precise_sleep_for(std::chrono::duration<REP, PERIOD> duration) { this_thread_sleeper().sleep_for(std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration)); }
+
+/**
+ * @brief Sleeps until the deadline without spinning, with the sleeper of the calling thread.
+ */
+inline void timer_sleep_until(std::chrono::steady_clock::time_point deadline) { this_thread_sleeper().timer_sleep_until(deadline); }
+
+/**
+ * @brief Sleeps for the duration without spinning, with the sleeper of the calling thread.
+ */
+template<typename REP, typename PERIOD>
+inline void timer_sleep_for(std::chrono::duration<REP, PERIOD> duration) { this_thread_sleeper().timer_sleep_for(std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration)); }
+
+#endif
+
+#ifdef SYSCORE_TIME_IMPLEMENTATION
+    PRECISE_SLEEPER::PRECISE_SLEEPER()
+    {
+        timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        max_spin_margin_ns = 2000000.0;
+        timer_lateness_ns = 500000.0;
+
+        if (!timer)
+        {
+            // Raised once for the whole process, Windows restores the resolution when it exits.
+            static const UINT raised_timer_resolution = timeBeginPeriod(1);
+            (void) raised_timer_resolution;
+
+            timer = CreateWaitableTimer(NULL, FALSE, NULL);
+            max_spin_margin_ns = 4000000.0;
+            timer_lateness_ns = 1000000.0;
+        }
+        timer_lateness_deviation_ns = timer_lateness_ns / 2;
+        statistics.spin_margin_us = std::chrono::duration<double, std::micro>(spin_margin()).count();
+    }
+
+    PRECISE_SLEEPER::~PRECISE_SLEEPER()
+    {
+        if (timer) CloseHandle(timer);
+    }
+
+    PRECISE_SLEEPER::CLOCK::duration PRECISE_SLEEPER::spin_margin() const
+    {
+        const double margin_ns = std::min(std::max(timer_lateness_ns + 3 * timer_lateness_deviation_ns, min_spin_margin_ns), max_spin_margin_ns);
+        return std::chrono::duration_cast<CLOCK::duration>(std::chrono::duration<double, std::nano>(margin_ns));
+    }
+
+    void PRECISE_SLEEPER::calibrate(double lateness_ns)
+    {
+        // A wake up that was preempted for long says nothing about the timer, it only widens the margin up to its bound.
+        lateness_ns = std::min(lateness_ns, max_spin_margin_ns);
+
+        timer_lateness_ns += calibration_rate * (lateness_ns - timer_lateness_ns);
+        timer_lateness_deviation_ns += calibration_rate * (std::abs(lateness_ns - timer_lateness_ns) - timer_lateness_deviation_ns);
+    }
+
+    bool PRECISE_SLEEPER::wait_timer(CLOCK::time_point timer_deadline, CLOCK::time_point& now)
+    {
+        if (!timer || timer_deadline <= now) return false;
+
+        LARGE_INTEGER due_time;
+        due_time.QuadPart = -(LONGLONG) (std::chrono::duration_cast<std::chrono::nanoseconds>(timer_deadline - now).count() / 100); // Relative, in 100 ns units.
+        if (!SetWaitableTimer(timer, &due_time, 0, NULL, NULL, FALSE) || WaitForSingleObject(timer, INFINITE) != WAIT_OBJECT_0) return false;
+
+        now = CLOCK::now();
+        calibrate(std::chrono::duration<double, std::nano>(now - timer_deadline).count());
+        return true;
+    }
+
+    void PRECISE_SLEEPER::record_wake_up(CLOCK::time_point deadline, CLOCK::time_point now)
+    {
+        const double overshoot_us = std::max(std::chrono::duration<double, std::micro>(now - deadline).count(), 0.0);
+        statistics.sleep_count++;
+        statistics.total_overshoot_us += overshoot_us;
+        statistics.max_overshoot_us = std::max(statistics.max_overshoot_us, overshoot_us);
+    }
+
+    void PRECISE_SLEEPER::sleep_until(CLOCK::time_point deadline)
+    {
+        SYSTRACE_SCOPE("precise_sleep");
+        CLOCK::time_point now = CLOCK::now();
+        if (deadline <= now) return;
+
+        // Wait on the timer until the margin before the deadline.
+        wait_timer(deadline - spin_margin(), now);
+
+        // Then spin for the rest of it.
+        while (now < deadline)
+        {
+            YieldProcessor();
+            now = CLOCK::now();
+        }
+        record_wake_up(deadline, now);
+    }
+
+    void PRECISE_SLEEPER::timer_sleep_until(CLOCK::time_point deadline)
+    {
+        SYSTRACE_SCOPE("timer_sleep");
+        CLOCK::time_point now = CLOCK::now();
+        if (deadline <= now) return;
+
+        if (!wait_timer(deadline, now))
+        {
+            Sleep((DWORD) std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+            now = CLOCK::now();
+        }
+        record_wake_up(deadline, now);
+    }
+
+    SLEEP_STATISTICS PRECISE_SLEEPER::get_statistics() const
+    {
+        SLEEP_STATISTICS current = statistics;
+        current.spin_margin_us = std::chrono::duration<double, std::micro>(spin_margin()).count();
+        return current;
+    }
+
+    PRECISE_SLEEPER& this_thread_sleeper()
+    {
+        thread_local PRECISE_SLEEPER sleeper;
+        return sleeper;
+    }
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef SYSCORE_TRACE_H
+#define SYSCORE_TRACE_H
+
+/**
+ * @brief Scoped tracing zones, exported as Chrome trace_event JSON that opens in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Tracing is compiled in when SYSCORE_TRACING is defined, and every macro expands to nothing otherwise.
+ *
+ * - SYSTRACE_SCOPE(name): times the enclosing scope. The name must be a string literal.
+ * - SYSTRACE_THREAD_NAME(name): names the calling thread in the trace.
+ * - SYSTRACE_FLUSH(path): appends the zones recorded since the last flush to the JSON file.
+ * - SYSTRACE_FLUSH_IN_BACKGROUND(path, period): starts a thread that flushes once per period, for loops that never return.
+ *
+ * A zone is recorded once, when its scope exits, as a complete event: its start on the monotonic clock and its duration.
+ * Each thread pushes its zones into a lock-free ring of its own, so recording takes two reads of the clock and a push,
+ * and never waits for another thread. When a ring is full the zones are dropped, and counted, until the next flush drains it.
+ *
+ * The flush drains the rings straight into the file, so it only costs the zones that are new, and nothing is kept in
+ * memory besides the rings. The file is in the JSON array format of the trace_event spec, whose closing bracket is
+ * optional: it is valid after every flush, and grows by about 100 bytes per zone for as long as the process traces.
+ * The first flush to a path truncates it, the next ones append to it. The dropped zones are reported as a counter.
+ *
+ * Example usage:
+ * @code
+ *   #define SYSCORE_TRACING 1
+ *   #include "syscore.h"
+ *
+ *   void scan() {
+ *       SYSTRACE_SCOPE("scan");
+ *       ...
+ *   }
+ *
+ *   int main() {
+ *       scan();
+ *       SYSTRACE_FLUSH("trace.json");
+ *   }
+ * @endcode
+ */
+
+#ifdef SYSCORE_TRACING
+#include "sc_spsc_queue.h"
+
+#include <chrono>
+#include <stdint.h>
+
+/**
+ * @brief A zone, as recorded by the thread that ran it.
+ */
+struct TRACE_EVENT
+{
+    const char *name;       // String literal, only its address is kept.
+    uint64_t start_ns;      // On the steady clock.
+    uint64_t duration_ns;
+};
+
+/**
+ * @brief The ring of zones of one thread, and what the flush needs to know about the thread.
+ */
+struct TRACE_THREAD_BUFFER
+{
+    static constexpr size_t capacity = 1 << 14;
+
+    SPSC_QUEUE<TRACE_EVENT, capacity> events;   // Pushed by the thread, popped by the flush.
+    std::atomic<uint64_t> dropped_count {0};
+    std::atomic<const char *> thread_name {nullptr};
+    uint32_t thread_index = 0;
+};
+
+/**
+ * @brief Returns the ring of the calling thread, registered on the first call.
+ */
+TRACE_THREAD_BUFFER& this_thread_trace_buffer();
+
+/**
+ * @brief Returns the time of the steady clock, in ns.
+ */
+inline uint64_t trace_now_ns()
+{
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Records a zone into the ring of the calling thread.
+ */
+inline void trace_record(const char *name, uint64_t start_ns, uint64_t end_ns)
+{
+    TRACE_THREAD_BUFFER& buffer = this_thread_trace_buffer();
+    if (!buffer.events.try_push({name, start_ns, end_ns - start_ns})) buffer.dropped_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Drains the rings of every thread, and appends their zones to a JSON file.
+ *
+ * A flush to another path than the previous one starts a new file, with the zones recorded since the previous flush.
+ *
+ * @return true on success. On failure, the zones stay in the rings.
+ */
+bool trace_flush(const char *path);
+
+/**
+ * @brief Starts a detached thread that calls trace_flush(path) once per period, so that the traced threads never write the file.
+ */
+void trace_flush_in_background(const char *path, std::chrono::steady_clock::duration period);
+
+/**
+ * @class TRACE_SCOPE
+ *
+ * @brief Records a zone from its construction to its destruction, see SYSTRACE_SCOPE.
+ */
+class TRACE_SCOPE
+{
+    private:
+        const char *name;
+        uint64_t start_ns;
+
+    public:
+        explicit TRACE_SCOPE(const char *name) : name(name), start_ns(trace_now_ns()) {}
+        ~TRACE_SCOPE() { trace_record(name, start_ns, trace_now_ns()); }
+
+        TRACE_SCOPE(const TRACE_SCOPE&) = delete;
+        TRACE_SCOPE& operator=(const TRACE_SCOPE&) = delete;
+};
+
+#define SYSTRACE_CONCAT_INNER(a, b) a##b
+#define SYSTRACE_CONCAT(a, b) SYSTRACE_CONCAT_INNER(a, b)
+
+#define SYSTRACE_SCOPE(name) TRACE_SCOPE SYSTRACE_CONCAT(trace_scope_, __LINE__) {name}
+#define SYSTRACE_THREAD_NAME(name) this_thread_trace_buffer().thread_name.store(name, std::memory_order_release)
+#define SYSTRACE_FLUSH(path) trace_flush(path)
+#define SYSTRACE_FLUSH_IN_BACKGROUND(path, period) trace_flush_in_background(path, period)
+
+#else
+
+#define SYSTRACE_SCOPE(name) do {} while(0)
+#define SYSTRACE_THREAD_NAME(name) do {} while(0)
+#define SYSTRACE_FLUSH(path) do {} while(0)
+#define SYSTRACE_FLUSH_IN_BACKGROUND(path, period) do {} while(0)
+
+#endif
+
+#endif
+
+#if defined(SYSCORE_TRACE_IMPLEMENTATION) && defined(SYSCORE_TRACING)
+#pragma once
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+    // Every ring ever registered. The rings outlive their threads, so that the zones of a thread that exited are still flushed.
+    struct TRACE_REGISTRY
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<TRACE_THREAD_BUFFER>> buffers;
+        uint64_t origin_ns = trace_now_ns();            // Times are written relative to it, so that they stay readable.
+        uint64_t dropped_count = 0;
+
+        // The file the flushes append to, and what was written to it.
+        std::string path;
+        bool has_written_event = false;
+        std::vector<const char *> written_thread_names; // Per ring, the name of its metadata event in the file.
+    };
+
+    static TRACE_REGISTRY& trace_registry()
+    {
+        static TRACE_REGISTRY registry;
+        return registry;
+    }
+
+    TRACE_THREAD_BUFFER& this_thread_trace_buffer()
+    {
+        thread_local TRACE_THREAD_BUFFER *buffer = nullptr;
+        if (!buffer)
+        {
+            TRACE_REGISTRY& registry = trace_registry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.buffers.push_back(std::unique_ptr<TRACE_THREAD_BUFFER>(new TRACE_THREAD_BUFFER()));
+            buffer = registry.buffers.back().get();
+            buffer->thread_index = (uint32_t) registry.buffers.size();
+        }
+        return *buffer;
+    }
+
+    bool trace_flush(const char *path)
+    {
+        TRACE_REGISTRY& registry = trace_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        const bool is_new_file = registry.path != path;
+        std::ofstream file(path, is_new_file ? std::ios::trunc : std::ios::app);
+        if (!file) return false;
+
+        if (is_new_file)
+        {
+            registry.path = path;
+            registry.has_written_event = false;
+            registry.written_thread_names.clear();
+            file << "[";
+        }
+        registry.written_thread_names.resize(registry.buffers.size(), nullptr);
+
+        auto separator = [&registry]() {
+            const char *separator = registry.has_written_event ? ",\n" : "\n";
+            registry.has_written_event = true;
+            return separator;
+        };
+
+        file.setf(std::ios::fixed);
+        file.precision(3);
+
+        // Only the flush pops, under the lock, so every ring keeps a single consumer.
+        uint64_t dropped_count = 0;
+        for (const std::unique_ptr<TRACE_THREAD_BUFFER>& buffer : registry.buffers)
+        {
+            // A thread can be named after its first zones, the latest metadata event wins.
+            const char *thread_name = buffer->thread_name.load(std::memory_order_acquire);
+            const char *&written_thread_name = registry.written_thread_names[buffer->thread_index - 1];
+            if (is_new_file || thread_name != written_thread_name)
+            {
+                file << separator() << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << buffer->thread_index << ", \"args\": {\"name\": \"";
+                if (thread_name) file << thread_name;
+                else file << "thread " << buffer->thread_index;
+                file << "\"}}";
+                written_thread_name = thread_name;
+            }
+
+            TRACE_EVENT event;
+            while (buffer->events.try_pop(event))
+            {
+                file << separator() << "{\"ph\": \"X\", \"name\": \"" << event.name << "\", \"pid\": 1, \"tid\": " << buffer->thread_index
+                     << ", \"ts\": " << (int64_t)(event.start_ns - registry.origin_ns) / 1000.0 << ", \"dur\": " << event.duration_ns / 1000.0 << "}";
+            }
+            dropped_count += buffer->dropped_count.exchange(0, std::memory_order_relaxed);
+        }
+
+        if (dropped_count)
+        {
+            registry.dropped_count += dropped_count;
+            file << separator() << "{\"ph\": \"C\", \"name\": \"dropped_events\", \"pid\": 1, \"ts\": " << (int64_t)(trace_now_ns() - registry.origin_ns) / 1000.0
+                 << ", \"args\": {\"count\": " << registry.dropped_count << "}}";
+        }
+        file.flush();
+        return (bool) file;
+    }
+
+    void trace_flush_in_background(const char *path, std::chrono::steady_clock::duration period)
+    {
+        std::thread([path = std::string(path), period]() {
+            while (1)
+            {
+                std::this_thread::sleep_for(period);
+                trace_flush(path.c_str());
+            }
+        }).detach();
+    }
+
+#endif
@@ -3,12 +3,24 @@
 // SYCORE
 #include "syscore.h"
 
+#define SYSCORE_LOG_IMPLEMENTATION 1
+#include "sc_log.h"
+
 #define SYSCORE_BENCHMARK_IMPLEMENTATION 1
 #include "sc_benchmark.h"
 
+#define SYSCORE_TIME_IMPLEMENTATION 1
+#include "sc_time.h"
+
 #define SYSCORE_KEYS_IMPLEMENTATION 1
 #include "sc_keys.h"
 
+#define SYSCORE_INPUT_IMPLEMENTATION 1
+#include "sc_input.h"
+
+#define SYSCORE_TRACE_IMPLEMENTATION 1
+#include "sc_trace.h"
+
 // COMPONENTS
 #define KO_CLIENT_IMPLEMENTATION 1
 #include "../ko_client/ko_client.h"
@@ -22,14 +34,32 @@ namespace global
 
 int main( )
 {
-     while(1)
+     // Cooldowns and HP/MP are sampled in the background, the scheduler only reads local memory.
+     global::ko_client.start_state_poller( );
+
+     SKILL_SCHEDULER<PLAYER_STATE> scheduler {[](PLAYER_STATE& state, std::chrono::steady_clock::time_point& sampled_at) {
+          const PLAYER_SNAPSHOT snapshot = global::ko_client.get_player_snapshot( );
+          state                          = snapshot.state;
+          sampled_at                     = snapshot.sampled_at;
+     }, SKILL_TABLE::ready_cooldown};
+
+     // Skills that are ready together are sent by priority, as set in the skill table. Skills of priority 0 are not sent.
+     // The pointers are still being resolved in the background, a skill reads as in cooldown until its own pointer is found.
+     // Call scheduler.set_rotation to send them in a fixed order instead.
+     const SKILL_TABLE& skills = global::ko_client.get_skill_table( );
+     for(size_t i = 0; i < skills.size( ); i++)
      {
-          global::ko_client.send_spike_until_in_cooldown( );
-          global::ko_client.send_thrust_until_in_cooldown( );
-          global::ko_client.send_pierce_until_in_cooldown( );
-          global::ko_client.send_cut_until_in_cooldown( );
-          global::ko_client.send_shock_until_in_cooldown( );
-          global::ko_client.send_jab_until_in_cooldown( );
+          if(skills.priorities[i] <= 0) continue;
+          scheduler.add_skill({skills.names[i].c_str( ), i, [i]( ) { return global::ko_client.send_skill_until_in_cooldown(i); }, skills.priorities[i]});
      }
+
+     // With SYSCORE_TRACING, the zones of the hot paths are appended to the trace every few seconds, by a thread of its own.
+     // When the bot is stopped, the trace holds everything up to the last flush.
+     SYSTRACE_FLUSH_IN_BACKGROUND("syscore_trace.json", std::chrono::seconds(5));
+
+     // Sleeps until the next skill is predicted to be ready, instead of polling every skill in a loop.
+     SYSTRACE_THREAD_NAME("rotation");
+     while(1) scheduler.run_once( );
+
      return 0;
 }
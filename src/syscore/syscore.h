@@ -2,4 +2,9 @@
 #define LOGGING_LEVEL 0
 #include "sc_log.h"
 #include "sc_benchmark.h"
+#include "sc_time.h"
 #include "sc_keys.h"
+#include "sc_input.h"
+#include "sc_scheduler.h"
+#include "sc_seqlock.h"
+#include "sc_trace.h"
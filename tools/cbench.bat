@@ -0,0 +1,47 @@
+@echo off
+cls
+set PROJECT_DIR=%~dp0..
+set BUILD_DIR=%PROJECT_DIR%\build
+set SRC_DIR=%PROJECT_DIR%\src
+
+setlocal EnableDelayedExpansion
+
+if not exist %BUILD_DIR% mkdir %BUILD_DIR%
+
+@REM The benchmarks read the skill table next to their executable (see synthetic_heap.h)
+copy /Y %SRC_DIR%\ko_client\config\ardream_world_skills.cfg %BUILD_DIR% >nul
+
+echo ^+----------------------------------------------------------------------------------------------------------------------------+
+echo ^|                                                       BENCHMARK                                
+echo ^+----------------------------------------------------------------------------------------------------------------------------+
+
+@REM Compiler Flags
+set COMPILER_FLAGS=-O2 -Wall -std=c++17 -Wno-unused-variable
+
+echo ^|  Flags:              ^| !COMPILER_FLAGS!
+echo ^+----------------------------------------------------------------------------------------------------------------------------+
+
+@REM SCAN BENCHMARK
+g++ !COMPILER_FLAGS! %SRC_DIR%\benchmark\scan_benchmark.cpp -o %BUILD_DIR%\scan_benchmark.exe 2>&1
+if %errorlevel% neq 0 goto :compiled
+
+@REM MICRO BENCHMARKS
+g++ !COMPILER_FLAGS! %SRC_DIR%\benchmark\micro_benchmark.cpp -o %BUILD_DIR%\micro_benchmark.exe 2>&1
+
+:compiled
+
+@REM Check if compilation was successful
+if %errorlevel% neq 0 (
+    echo ^+----------------------------------------------------------------------------------------------------------------------------+
+    echo ^|  Compilation Status: ^| Failed, Check the error messages above for details
+    echo ^+----------------------------------------------------------------------------------------------------------------------------+
+    goto :end
+) else (
+    echo ^|  Compilation Status: ^| Successful
+    echo ^+----------------------------------------------------------------------------------------------------------------------------+
+)
+
+%BUILD_DIR%\scan_benchmark.exe
+%BUILD_DIR%\micro_benchmark.exe --json %BUILD_DIR%\micro_benchmark.json --csv %BUILD_DIR%\micro_benchmark.csv
+
+:end
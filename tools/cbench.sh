@@ -0,0 +1,22 @@
+#!/bin/sh
+# Builds and runs the benchmarks on Linux, see cbench.bat. The first argument picks the benchmark, the others are passed to it:
+#   tools/cbench.sh scan [<pid> <heap base address in hex> <heap size in MB> [dump path] | <dump path>]
+#   tools/cbench.sh micro [--json <path>] [--csv <path>] [--heap-mb <size>]
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD_DIR="$PROJECT_DIR/build"
+SRC_DIR="$PROJECT_DIR/src"
+
+BENCHMARK="${1:-scan}"
+[ $# -gt 0 ] && shift
+
+mkdir -p "$BUILD_DIR"
+
+COMPILER_FLAGS="-O2 -g -Wall -std=c++17 -Wno-unused-variable -pthread"
+echo "Flags: $COMPILER_FLAGS"
+
+g++ $COMPILER_FLAGS "$SRC_DIR/benchmark/${BENCHMARK}_benchmark.cpp" -o "$BUILD_DIR/${BENCHMARK}_benchmark" || { echo "Compilation failed, check the error messages above for details"; exit 1; }
+
+# The benchmarks read the skill table next to their executable (see synthetic_heap.h)
+cp "$SRC_DIR/ko_client/config/ardream_world_skills.cfg" "$BUILD_DIR/"
+
+"$BUILD_DIR/${BENCHMARK}_benchmark" "$@"
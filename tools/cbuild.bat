@@ -24,19 +24,25 @@ if %DEBUG% EQU 1 (
     echo ^+----------------------------------------------------------------------------------------------------------------------------+
 )
 
+@REM Define TRACE variable, 1 writes a Chrome trace of the hot paths to syscore_trace.json (see sc_trace.h)
+set TRACE=0
+
 @REM Compiler Flags
-set COMPILER_FLAGS=-g -Wall -std=c++11 -Wno-unused-variable
+set COMPILER_FLAGS=-g -Wall -std=c++17 -Wno-unused-variable
 if %DEBUG% EQU 1 (
     set COMPILER_FLAGS=!COMPILER_FLAGS! -DDEBUG
 ) else (
     set "COMPILER_FLAGS=!COMPILER_FLAGS!        "
 )
+if %TRACE% EQU 1 (
+    set COMPILER_FLAGS=!COMPILER_FLAGS! -DSYSCORE_TRACING
+)
 
 echo ^|  Flags:              ^| !COMPILER_FLAGS!
 echo ^+----------------------------------------------------------------------------------------------------------------------------+
 
 @REM LAUNCHER
-g++ !COMPILER_FLAGS! %SRC_DIR%\syscore\syscore.cpp -o %BUILD_DIR%\syscore.exe 2>&1
+g++ !COMPILER_FLAGS! %SRC_DIR%\syscore\syscore.cpp -o %BUILD_DIR%\syscore.exe -lwinmm 2>&1
 
 @REM Check if compilation was successful
 if %errorlevel% neq 0 (
@@ -49,6 +55,9 @@ if %errorlevel% neq 0 (
     echo ^+----------------------------------------------------------------------------------------------------------------------------+
 )
 
+@REM The skill table is read from the working directory of the client (see kc_skill_table.h)
+copy /Y %SRC_DIR%\ko_client\config\ardream_world_skills.cfg %BUILD_DIR% >nul
+
 @REM CALCULATE ELAPSED TIME
 set "endTime=%time: =0%"
 rem Get elapsed time: